@@ -3,44 +3,123 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
-#include <regex>
+#include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <limits>
+#include <thread>
+
+#include "../core/lexer.h"
+
+namespace {
+
+	// calls given function for all indices in [0, count) on a pool of worker threads (including the calling one);
+	// the exception thrown for the lowest index, if any, is rethrown in the calling thread
+	template<typename TFunc>
+	void Parallel_For(size_t count, TFunc func) {
+
+		const size_t workerCount = std::min<size_t>(count, std::max(1u, std::thread::hardware_concurrency()));
+
+		std::atomic<size_t> next{ 0 };
+		std::vector<std::exception_ptr> errors(count);
+
+		auto worker = [&]() {
+			for (size_t i = next++; i < count; i = next++) {
+				try {
+					func(i);
+				}
+				catch (...) {
+					errors[i] = std::current_exception();
+				}
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < workerCount; i++) {
+			threads.emplace_back(worker);
+		}
+
+		worker();
+
+		for (auto& t : threads) {
+			t.join();
+		}
+
+		for (auto& ex : errors) {
+			if (ex) {
+				std::rethrow_exception(ex);
+			}
+		}
+	}
+}
 
 CAssembler::CAssembler(TAssembly_Input& input)
 	: mInput(input) {
-	//
+
+	mCurrent_Section = mSection_Names.Intern("data");
+	mSections.resize(mSection_Names.Size());
 }
 
-bool CAssembler::Assemble_File(const std::string& path) {
+std::vector<sarch32::TString_Id> CAssembler::Sorted_By_Name(const sarch32::CString_Pool& pool) {
+
+	std::vector<sarch32::TString_Id> ids(pool.Size());
+	for (sarch32::TString_Id i = 0; i < ids.size(); i++) {
+		ids[i] = i;
+	}
+
+	std::sort(ids.begin(), ids.end(), [&pool](auto a, auto b) { return pool.Get(a) < pool.Get(b); });
+
+	return ids;
+}
+
+bool CAssembler::Assemble_File(const std::string& path, TAssembly_Unit& unit, std::string_view initialSection) {
 
 	Log(NLog_Level::Basic, "Assembling", path, "...");
 
-	// regex to detect empty lines (possibly containing comments)
-	std::regex emptylineregex{ "^[\\s]{0,}(;.*)?$", std::regex::ECMAScript };
 	std::string tmp;
 
-	std::string line;
-	std::ifstream iss(path);
+	unit.currentSection = unit.sectionNames.Intern(initialSection);
+	unit.sections.resize(unit.sectionNames.Size());
+
+	// the source is mapped and parsed in place, the lines are never copied
+	sarch32::CMapped_Text_File source;
+	if (!source.Open(path)) {
+		unit.diagnostics << "Could not open input file: " << path << std::endl;
+		return false;
+	}
+
+	// the encoded contents are usually several times smaller than the source text
+	unit.reserveHint = source.Get_Text().size() / 4;
+
+	uint32_t lineNumber = 0;
+
+	std::string_view line;
 	// for each line...
-	while (std::getline(iss, line)) {
+	while (source.Next_Line(line)) {
+		lineNumber++;
 		try
 		{
 			// is this an empty line? ignore
-			std::smatch sm;
-			if (std::regex_match(line, sm, emptylineregex)) {
+			if (sarch32::CLine_Lexer{ line }.Accept_Trailer()) {
 				continue;
 			}
 
 			// is this a section directive? (.section abcd)
 			if (Parse_Section_Directive(line, tmp)) {
 				Log(NLog_Level::Extended, "Switch to section", tmp);
-				mCurrent_Section = tmp;
+				unit.currentSection = unit.sectionNames.Intern(tmp);
+				unit.sections.resize(unit.sectionNames.Size());
 				continue;
 			}
 			// is this a label directive? ($labelname:)
 			else if (Parse_Label_Directive(line, tmp)) {
-				Log(NLog_Level::Extended, "Found label", tmp, "at offset", mSection_Offsets[mCurrent_Section], "in section", mCurrent_Section);
-				mLabel_Refs[tmp].section = mCurrent_Section;
-				mLabel_Refs[tmp].byteOffset = mSection_Offsets[mCurrent_Section];
+				const auto offset = unit.sections[unit.currentSection].offset;
+				Log(NLog_Level::Extended, "Found label", tmp, "at offset", offset, "in section", unit.sectionNames.Get(unit.currentSection), "of", path);
+
+				const auto symbol = unit.symbolNames.Intern(tmp);
+				unit.labelRefs.resize(unit.symbolNames.Size());
+				unit.labelRefs[symbol] = { unit.currentSection, offset, true };
 				continue;
 			}
 
@@ -53,120 +132,336 @@ bool CAssembler::Assemble_File(const std::string& path) {
 				r = CInstruction::Build_From_String(line);
 			}
 
-			// on success - store it
-			if (r) {
+			// on success - encode it right away...
+			if (r && mInput.Stream_Emission) {
+				Emit_Instruction(unit, *r, lineNumber);
+			}
+			// ...or store it
+			else if (r) {
 				auto instrLen = r->Get_Length(); // size of instruction or data
 
+				auto& section = unit.sections[unit.currentSection];
+
 				// does this line need a symbol resolution?
 				if (r->Get_Resolve_Request(tmp)) {
-					mResolve_Requests.push_back({ tmp, mCurrent_Section, mSections[mCurrent_Section].size() });
+					unit.resolveRequests.push_back({ unit.symbolNames.Intern(tmp), unit.currentSection, static_cast<uint32_t>(section.instructions.size()) });
 				}
 
 				// add instrction and move section offset
-				mSections[mCurrent_Section].push_back(std::move(r));
-				mSection_Offsets[mCurrent_Section] += instrLen;
+				section.instructions.push_back(std::move(r));
+				section.sourceLocations.push_back({ unit.fileIndex, lineNumber });
+				section.offset += instrLen;
 			}
 		}
 		catch (const std::exception& ex) {
-			std::cerr << "Exception: " << ex.what() << std::endl;
+			unit.diagnostics << "Exception: " << ex.what() << std::endl;
 		}
 	}
 
 	return true;
 }
 
-bool CAssembler::Load_Linker_File(const std::string& path) {
+void CAssembler::Emit_Instruction(TAssembly_Unit& unit, CInstruction& instr, uint32_t lineNumber) {
 
-	Log(NLog_Level::Full, "Loading linker file:", path);
+	auto& section = unit.sections[unit.currentSection];
 
-	// open linker file
-	std::ifstream lf(path);
-	if (!lf.is_open()) {
-		return false;
+	const uint32_t length = instr.Get_Length();
+	const uint32_t offset = static_cast<uint32_t>(section.offset);
+
+	// symbol reference is encoded as zero and patched later
+	std::string symbol;
+	const bool isReference = instr.Get_Resolve_Request(symbol);
+	const auto kind = isReference ? instr.Get_Relocation_Kind() : NRelocation_Kind::None;
+
+	if (isReference) {
+		if (kind == NRelocation_Kind::None) {
+			unit.diagnostics << "Reference to symbol " << symbol << " cannot be relocated" << std::endl;
+			return;
+		}
+		instr.Resolve_Symbol(0);
 	}
 
-	// section definition regex
-	std::regex sdefregex("[\\s]{0,}(section)[\\s]{0,}([a-zA-Z0-9_]+)\\((0x[0-9a-zA-Z]+|[0-9])\\)", std::regex::ECMAScript | std::regex::icase);
+	const bool isSpace = dynamic_cast<const CPseudo_Instruction_Space*>(&instr) != nullptr;
 
-	// for each line...
-	std::string line;
-	while (std::getline(lf, line)) {
+	if (isSpace) {
+		// reserved space is materialized only in sections with some data
+		if (!section.zeroFill) {
+			section.data.resize(section.data.size() + length, 0);
+		}
+	}
+	else {
+		// encode to the scratch buffer first, so the section is left intact if the encoding fails
+		unit.scratch.clear();
+		if (instr.Is_Pseudo_Instruction()) {
+			instr.Generate_Additional_Data(unit.scratch);
+		}
+		else {
+			Word_To_Bytes(instr.Generate_Binary(), unit.scratch);
+		}
 
-		Log(NLog_Level::Full, "Parsing line:", line);
+		if (section.zeroFill) {
+			section.data.reserve(std::max(unit.reserveHint, section.offset + unit.scratch.size()));
+			section.data.assign(section.offset, 0);
+			section.zeroFill = false;
+		}
+		section.data.insert(section.data.end(), unit.scratch.begin(), unit.scratch.end());
+	}
 
-		std::smatch sm;
-		if (std::regex_match(line, sm, sdefregex) && sm.size() == 4) {
+	if (isReference) {
+		unit.fixups.push_back({ unit.symbolNames.Intern(symbol), unit.currentSection, offset, kind });
+	}
+	if (mInput.Debug_Info && length > 0) {
+		section.lines.push_back({ offset, length, { unit.fileIndex, lineNumber } });
+	}
 
-			const auto& sname = sm[2];
-			const auto& reloc = sm[3];
+	section.offset += length;
+	section.itemCount++;
+}
 
-			Log(NLog_Level::Extended, "Section", sname, "relocate to", reloc);
+void CAssembler::Merge_Unit(TAssembly_Unit& unit) {
 
-			uint32_t relocAddr = 0;
+	// the file continues the section the previous one ended with
+	const auto inherited = mCurrent_Section;
 
-			try {
+	// merged section of every unit section and the start of the unit section within it - byte offset and instruction index
+	struct TSection_Base {
+		sarch32::TString_Id section = 0;
+		size_t offset = 0;
+		size_t index = 0;
+	};
 
-				// hexa format
-				if (reloc.str().starts_with("0x") || reloc.str().starts_with("0X")) {
-					relocAddr = std::stol(reloc.str(), nullptr, 16);
-				}
-				// dec format
-				else {
-					relocAddr = std::stol(reloc.str(), nullptr, 10);
-				}
+	std::vector<TSection_Base> bases(unit.sections.size());
+
+	// the unnamed section is interned first, so it is appended before the same section is named explicitly in the file
+	for (sarch32::TString_Id i = 0; i < unit.sections.size(); i++) {
+
+		const auto& name = unit.sectionNames.Get(i);
+		const auto target = name.empty() ? inherited : mSection_Names.Intern(name);
+		mSections.resize(mSection_Names.Size());
+
+		auto& us = unit.sections[i];
+		auto& merged = mSections[target];
 
-				Log(NLog_Level::Full, "Section definition of", sname, "loaded");
+		bases[i] = { target, merged.offset, merged.instructions.size() };
 
-				mLinker_Section_Defs[sname.str()] = {
-					sname.str(),
-					relocAddr,
-					0 // TODO: limit
-				};
+		std::move(us.instructions.begin(), us.instructions.end(), std::back_inserter(merged.instructions));
+		merged.sourceLocations.insert(merged.sourceLocations.end(), us.sourceLocations.begin(), us.sourceLocations.end());
+
+		// encoded contents are concatenated; reserved space is materialized once there are some data
+		if (!us.zeroFill) {
+			if (merged.zeroFill) {
+				merged.data.assign(merged.offset, 0);
+				merged.zeroFill = false;
+			}
+
+			if (merged.data.empty()) {
+				merged.data = std::move(us.data);
 			}
-			catch (std::exception& /*ex*/) {
-				std::cerr << "Cannot parse relocation address: " << reloc << std::endl;
+			else {
+				merged.data.insert(merged.data.end(), us.data.begin(), us.data.end());
 			}
 		}
+		else if (!merged.zeroFill) {
+			merged.data.resize(merged.offset + us.offset, 0);
+		}
+
+		for (auto& line : us.lines) {
+			merged.lines.push_back({ static_cast<uint32_t>(merged.offset + line.offset), line.size, line.location });
+		}
+		merged.itemCount += us.itemCount;
+
+		merged.offset += us.offset;
+	}
+
+	// unit symbol IDs mapped to the merged ones
+	std::vector<sarch32::TString_Id> symbols(unit.symbolNames.Size());
+	for (sarch32::TString_Id i = 0; i < symbols.size(); i++) {
+		symbols[i] = mSymbol_Names.Intern(unit.symbolNames.Get(i));
+	}
+	mLabel_Refs.resize(mSymbol_Names.Size());
 
+	// later label definition overrides the previous one, just like when the files were assembled one after another
+	for (sarch32::TString_Id i = 0; i < unit.labelRefs.size(); i++) {
+		const auto& lr = unit.labelRefs[i];
+		if (lr.defined) {
+			mLabel_Refs[symbols[i]] = { bases[lr.section].section, bases[lr.section].offset + lr.byteOffset, true };
+		}
 	}
 
+	for (auto& rr : unit.resolveRequests) {
+		mResolve_Requests.push_back({
+			symbols[rr.symbol],
+			bases[rr.section].section,
+			static_cast<uint32_t>(bases[rr.section].index + rr.instructionIndex)
+		});
+	}
+
+	for (auto& fx : unit.fixups) {
+		mFixups.push_back({
+			symbols[fx.symbol],
+			bases[fx.section].section,
+			static_cast<uint32_t>(bases[fx.section].offset + fx.offset),
+			fx.kind
+		});
+	}
+
+	mCurrent_Section = bases[unit.currentSection].section;
+}
+
+bool CAssembler::Load_Linker_File(const std::string& path) {
+
+	Log(NLog_Level::Full, "Loading linker file:", path);
+
+	if (!sarch32::Load_Linker_File(path, mLinker_Section_Defs)) {
+		return false;
+	}
+
+	for (auto& sd : mLinker_Section_Defs) {
+		Log(NLog_Level::Extended, "Section", sd.first, "relocate to", sd.second.startAddr);
+
+		const auto id = mSection_Names.Intern(sd.first);
+		mSection_Defs.resize(mSection_Names.Size(), nullptr);
+		mSection_Defs[id] = &sd.second;
+	}
+
+	mSections.resize(mSection_Names.Size());
+
 	return true;
 }
 
-bool CAssembler::Resolve_Symbols() {
+bool CAssembler::Resolve_Address(sarch32::TString_Id symbol, int32_t& addr, std::string& error) const {
 
-	Log(NLog_Level::Basic, "Resolving symbols...");
+	// find the respective label reference (actual locations)
+	const auto& sym = mLabel_Refs[symbol];
 
-	// go through all resolution requests
-	for (auto& rr : mResolve_Requests) {
+	// no such label? report unresolved symbol
+	if (!sym.defined) {
+		error = "Unresolved symbol: " + mSymbol_Names.Get(symbol);
+		return false;
+	}
 
-		// find the respective label reference (actual locations)
-		auto sym = mLabel_Refs.find(rr.symbol);
+	// find a section in which the symbol resides
+	const auto* slink = Get_Section_Def(sym.section);
+	if (!slink) {
+		error = "Unknown section '" + mSection_Names.Get(sym.section) + "' for symbol: " + mSymbol_Names.Get(symbol);
+		return false;
+	}
 
-		// no such label? report unresolved symbol
-		if (sym == mLabel_Refs.end()) {
-			std::cerr << "Unresolved symbol: " << rr.symbol << std::endl;
-			return false;
+	// actual address = section starting address + symbol offset
+	addr = static_cast<int32_t>(slink->startAddr + sym.byteOffset);
+
+	return true;
+}
+
+bool CAssembler::Resolve_Symbols() {
+
+	Log(NLog_Level::Basic, "Resolving symbols...");
+
+	const bool streamed = mInput.Stream_Emission;
+
+	// resolve requests (or fixups of encoded contents) sorted to sections they patch - every section is then resolved
+	// by a single worker
+	struct TSection_Requests {
+		std::vector<size_t> requests;
+		// index of the first failed request and the reason
+		size_t failedRequest = std::numeric_limits<size_t>::max();
+		std::string error;
+	};
+
+	std::vector<TSection_Requests> bySection(mSections.size());
+	if (streamed) {
+		for (size_t i = 0; i < mFixups.size(); i++) {
+			bySection[mFixups[i].section].requests.push_back(i);
+		}
+	}
+	else {
+		for (size_t i = 0; i < mResolve_Requests.size(); i++) {
+			bySection[mResolve_Requests[i].section].requests.push_back(i);
 		}
+	}
 
-		// find a section in which the symbol resides
-		auto slink = mLinker_Section_Defs.find(sym->second.section);
-		if (slink == mLinker_Section_Defs.end()) {
-			std::cerr << "Unknown section '" << sym->second.section << "' for symbol: " << rr.symbol << std::endl;
-			return false;
+	std::vector<sarch32::TString_Id> groups;
+	for (sarch32::TString_Id i = 0; i < bySection.size(); i++) {
+		if (!bySection[i].requests.empty()) {
+			groups.push_back(i);
 		}
+	}
+
+	Parallel_For(groups.size(), [this, &groups, &bySection, streamed](size_t g) {
+
+		auto& group = bySection[groups[g]];
+		auto& contents = mSections[groups[g]];
 
-		// actual address = section starting address + symbol offset
-		const auto addr = static_cast<int32_t>(slink->second.startAddr + sym->second.byteOffset);
+		// go through all resolution requests of the section
+		for (const size_t i : group.requests) {
 
-		Log(NLog_Level::Extended, "Resolving symbol", rr.symbol, "to", addr);
+			const auto symbol = streamed ? mFixups[i].symbol : mResolve_Requests[i].symbol;
 
-		mSections[rr.section][rr.instructionIndex]->Resolve_Symbol(addr);
+			int32_t addr = 0;
+			if (!Resolve_Address(symbol, addr, group.error)) {
+				group.failedRequest = i;
+				return;
+			}
+
+			Log(NLog_Level::Extended, "Resolving symbol", mSymbol_Names.Get(symbol), "to", addr);
+
+			if (!streamed) {
+				contents.instructions[mResolve_Requests[i].instructionIndex]->Resolve_Symbol(addr);
+				continue;
+			}
+
+			// patch the encoded field in place
+			const auto& fx = mFixups[i];
+			try {
+				Apply_Relocation(fx.kind, std::span<uint8_t>(contents.data).subspan(fx.offset, Get_Relocation_Size(fx.kind)), addr);
+			}
+			catch (const std::exception& ex) {
+				group.failedRequest = i;
+				group.error = std::string("Exception: ") + ex.what() + " (symbol " + mSymbol_Names.Get(symbol) + ")";
+				return;
+			}
+		}
+	});
+
+	// report the failure that comes first in the source order
+	auto failed = std::min_element(groups.begin(), groups.end(), [&bySection](auto a, auto b) { return bySection[a].failedRequest < bySection[b].failedRequest; });
+	if (failed != groups.end() && !bySection[*failed].error.empty()) {
+		std::cerr << bySection[*failed].error << std::endl;
+		return false;
 	}
 
 	return true;
 }
 
+void CAssembler::Generate_Section(std::vector<std::unique_ptr<CInstruction>>& instructions, TGenerated_Section& target) {
+
+	// sections consisting of reserved space only are stored as zero-filled - just the size is recorded
+	target.zeroFill = !instructions.empty() && std::all_of(instructions.begin(), instructions.end(), [](const auto& instr) {
+		return dynamic_cast<const CPseudo_Instruction_Space*>(instr.get()) != nullptr;
+	});
+
+	if (target.zeroFill) {
+		for (auto& instr : instructions) {
+			target.size += instr->Get_Length();
+		}
+		return;
+	}
+
+	// generate all instruction and pseudoinstruction-related data
+	for (auto& instr : instructions) {
+
+		// is pseudo-instruction? ask for the additional data (as it might not be aligned to 4 bytes)
+		if (instr->Is_Pseudo_Instruction()) {
+			instr->Generate_Additional_Data(target.data);
+		}
+		else {
+			Word_To_Bytes(instr->Generate_Binary(), target.data);
+		}
+	}
+
+	target.size = static_cast<uint32_t>(target.data.size());
+}
+
 bool CAssembler::Generate_Binary() {
 
 	Log(NLog_Level::Basic, "Generating output...");
@@ -174,26 +469,47 @@ bool CAssembler::Generate_Binary() {
 	// create object file
 	SObj::CSObj_File output;
 
-	// put all sections
-	for (auto& s : mSections) {
+	// generated contents of a section
+	struct TSection_Output {
+		const std::string* name = nullptr;
+		TSection_Contents* contents = nullptr;
+		TGenerated_Section generated;
+	};
+
+	std::vector<TSection_Output> sections;
+	for (sarch32::TString_Id i = 0; i < mSections.size(); i++) {
+		if (mSections[i].Has_Contents()) {
+			sections.push_back({ &mSection_Names.Get(i), &mSections[i], {} });
+		}
+	}
 
-		std::vector<uint8_t> dest;
+	if (mInput.Stream_Emission) {
+		// the contents are already encoded and patched
+		for (auto& so : sections) {
+			so.generated.zeroFill = so.contents->zeroFill;
+			so.generated.size = static_cast<uint32_t>(so.contents->offset);
+			so.generated.data = std::move(so.contents->data);
+		}
+	}
+	else {
+		// sections are generated independently of each other
+		Parallel_For(sections.size(), [&sections](size_t i) {
+			Generate_Section(sections[i].contents->instructions, sections[i].generated);
+		});
+	}
 
-		// generate all instruction and pseudoinstruction-related data
-		for (auto& instr : s.second) {
+	// put all sections
+	for (auto& so : sections) {
 
-			// is pseudo-instruction? ask for the additional data (as it might not be aligned to 4 bytes)
-			if (instr->Is_Pseudo_Instruction()) {
-				instr->Generate_Additional_Data(dest);
-			}
-			else {
-				Word_To_Bytes(instr->Generate_Binary(), dest);
-			}
+		if (so.generated.zeroFill) {
+			Log(NLog_Level::Extended, "Section", *so.name, "is zero-filled,", so.generated.size, "bytes");
 
+			output.Put_Zero_Fill_To_Section(*so.name, so.generated.size);
+			continue;
 		}
 
 		// place into section
-		output.Put_To_Section(s.first, dest);
+		output.Put_To_Section(*so.name, so.generated.data);
 
 		// TODO: check section limit
 	}
@@ -201,24 +517,334 @@ bool CAssembler::Generate_Binary() {
 	// relocate all sections (just set starting address to allow loader to put it to a correct place in memory)
 	for (auto& sr : mLinker_Section_Defs) {
 		output.Relocate_Section(sr.second.section, sr.second.startAddr);
+
+		uint32_t flags = sr.second.flags;
+		// keep the flags given by the contents (zero-filled sections)
+		if (auto itr = output.Get_Sections().find(sr.second.section); itr != output.Get_Sections().end()) {
+			flags |= itr->second.flags;
+		}
+		if (mInput.Compressed_Sections.contains(sr.second.section)) {
+			flags |= static_cast<uint32_t>(SObj::NSection_Flag::Compressed);
+		}
+
+		output.Set_Section_Flags(sr.second.section, flags);
 	}
 
-	return output.Save_To_File(mInput.Output_File);
+	if (mInput.Debug_Info) {
+		// v1 has no section flags, the tables would be loaded to memory
+		if (mInput.Output_Version == SObj::NVersion::V1) {
+			std::cerr << "Debug info is not supported by SObj v1 format, skipping" << std::endl;
+		}
+		else {
+			Generate_Debug_Info(output);
+		}
+	}
+
+	return output.Save_To_File(mInput.Output_File, mInput.Output_Version);
+}
+
+void CAssembler::Generate_Debug_Info(SObj::CSObj_File& output) {
+
+	Log(NLog_Level::Extended, "Generating debug info...");
+
+	// labels sorted to sections by offset - every label spans up to the next one (or to the end of section)
+	std::vector<std::vector<std::pair<size_t, sarch32::TString_Id>>> sectionLabels(mSections.size());
+	for (sarch32::TString_Id i = 0; i < mLabel_Refs.size(); i++) {
+		if (mLabel_Refs[i].defined) {
+			sectionLabels[mLabel_Refs[i].section].push_back({ mLabel_Refs[i].byteOffset, i });
+		}
+	}
+
+	// the tables are emitted in the order of section and label names, regardless of the order the names were interned in
+	const auto sectionOrder = Sorted_By_Name(mSection_Names);
+
+	std::vector<sarch32::TSymbol> symbols;
+
+	for (const auto section : sectionOrder) {
+
+		// labels in sections not placed by the linker file have no address
+		const auto* slink = Get_Section_Def(section);
+		if (!slink) {
+			continue;
+		}
+
+		auto& labels = sectionLabels[section];
+		std::sort(labels.begin(), labels.end(), [this](const auto& a, const auto& b) {
+			return (a.first != b.first) ? (a.first < b.first) : (mSymbol_Names.Get(a.second) < mSymbol_Names.Get(b.second));
+		});
+
+		const size_t sectionEnd = mSections[section].offset;
+
+		for (size_t i = 0; i < labels.size(); i++) {
+			const size_t end = (i + 1 < labels.size()) ? labels[i + 1].first : sectionEnd;
+
+			symbols.push_back({
+				static_cast<uint32_t>(slink->startAddr + labels[i].first),
+				static_cast<uint32_t>(end - labels[i].first),
+				mSymbol_Names.Get(labels[i].second)
+			});
+		}
+	}
+
+	// every instruction or data item spans its generated bytes
+	std::vector<sarch32::TSource_Line> lines;
+
+	for (const auto section : sectionOrder) {
+
+		const auto* slink = Get_Section_Def(section);
+		if (!slink) {
+			continue;
+		}
+
+		const auto& contents = mSections[section];
+
+		for (auto& line : contents.lines) {
+			lines.push_back({ slink->startAddr + line.offset, line.size, line.location.line, line.location.fileIndex });
+		}
+
+		uint32_t offset = 0;
+		for (size_t i = 0; i < contents.instructions.size(); i++) {
+			const uint32_t len = contents.instructions[i]->Get_Length();
+			if (len > 0) {
+				lines.push_back({ slink->startAddr + offset, len, contents.sourceLocations[i].line, contents.sourceLocations[i].fileIndex });
+			}
+			offset += len;
+		}
+	}
+
+	Log(NLog_Level::Extended, "Emitting", symbols.size(), "symbols and", lines.size(), "line records");
+
+	const uint32_t flags = static_cast<uint32_t>(SObj::NSection_Flag::Metadata);
+
+	output.Put_To_Section(SObj::Symbol_Table_Section, sarch32::CSymbol_Index::Serialize_Symbol_Table(std::move(symbols)));
+	output.Set_Section_Flags(SObj::Symbol_Table_Section, flags);
+
+	output.Put_To_Section(SObj::Line_Table_Section, sarch32::CSymbol_Index::Serialize_Line_Table(std::move(lines), mSource_Files));
+	output.Set_Section_Flags(SObj::Line_Table_Section, flags);
+}
+
+bool CAssembler::Generate_Object(TAssembly_Unit& unit, const std::string& path, uint64_t sourceHash) {
+
+	sarch32::TRelocatable_Object object;
+	object.sourceHash = sourceHash;
+
+	// offsets of instructions and data within their sections
+	std::vector<std::vector<uint32_t>> offsets(unit.sections.size());
+	for (sarch32::TString_Id i = 0; i < unit.sections.size(); i++) {
+		uint32_t offset = 0;
+		for (auto& instr : unit.sections[i].instructions) {
+			offsets[i].push_back(offset);
+			offset += instr->Get_Length();
+		}
+	}
+
+	// every symbol reference is left to the linker; the field is generated as zero and patched when linked
+	for (auto& fx : unit.fixups) {
+		object.relocations.push_back({ unit.symbolNames.Get(fx.symbol), unit.sectionNames.Get(fx.section), fx.offset, fx.kind });
+	}
+
+	for (auto& rr : unit.resolveRequests) {
+		auto& instr = unit.sections[rr.section].instructions[rr.instructionIndex];
+
+		const auto kind = instr->Get_Relocation_Kind();
+		if (kind == NRelocation_Kind::None) {
+			unit.diagnostics << "Reference to symbol " << unit.symbolNames.Get(rr.symbol) << " cannot be relocated" << std::endl;
+			return false;
+		}
+
+		object.relocations.push_back({ unit.symbolNames.Get(rr.symbol), unit.sectionNames.Get(rr.section), offsets[rr.section][rr.instructionIndex], kind });
+		instr->Resolve_Symbol(0);
+	}
+
+	// sections and symbols are stored sorted by name, so the object does not depend on the order of interning
+	const auto sectionOrder = Sorted_By_Name(unit.sectionNames);
+
+	try {
+		for (const auto section : sectionOrder) {
+			auto& contents = unit.sections[section];
+			if (!contents.Has_Contents()) {
+				continue;
+			}
+
+			TGenerated_Section generated;
+			if (mInput.Stream_Emission) {
+				generated.zeroFill = contents.zeroFill;
+				generated.size = static_cast<uint32_t>(contents.offset);
+				generated.data = std::move(contents.data);
+			}
+			else {
+				Generate_Section(contents.instructions, generated);
+			}
+			object.sections.push_back({ unit.sectionNames.Get(section), generated.size, generated.zeroFill, std::move(generated.data) });
+		}
+	}
+	catch (const std::exception& ex) {
+		unit.diagnostics << "Exception: " << ex.what() << std::endl;
+		return false;
+	}
+
+	for (const auto symbol : Sorted_By_Name(unit.symbolNames)) {
+		if (symbol < unit.labelRefs.size() && unit.labelRefs[symbol].defined) {
+			const auto& lr = unit.labelRefs[symbol];
+			object.symbols.push_back({ unit.symbolNames.Get(symbol), unit.sectionNames.Get(lr.section), static_cast<uint32_t>(lr.byteOffset) });
+		}
+	}
+
+	if (mInput.Debug_Info) {
+		object.flags |= static_cast<uint32_t>(SObj::NObject_Flag::Debug_Info);
+		object.files.push_back(mInput.Input_Files[unit.fileIndex]);
+
+		for (const auto section : sectionOrder) {
+			const auto& contents = unit.sections[section];
+
+			for (auto& line : contents.lines) {
+				object.lines.push_back({ unit.sectionNames.Get(section), line.offset, line.size, line.location.line, 0 });
+			}
+
+			for (size_t i = 0; i < contents.instructions.size(); i++) {
+				const uint32_t len = contents.instructions[i]->Get_Length();
+				if (len > 0) {
+					object.lines.push_back({ unit.sectionNames.Get(section), offsets[section][i], len, contents.sourceLocations[i].line, 0 });
+				}
+			}
+		}
+	}
+
+	if (!sarch32::Save_Relocatable_Object(path, object)) {
+		unit.diagnostics << "Could not write object file: " << path << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool CAssembler::Assemble_Objects() {
+
+	const uint32_t objectFlags = mInput.Debug_Info ? static_cast<uint32_t>(SObj::NObject_Flag::Debug_Info) : 0;
+
+	std::error_code ec;
+	std::filesystem::create_directories(mInput.Output_File, ec);
+	if (ec) {
+		std::cerr << "Could not create output directory " << mInput.Output_File << ": " << ec.message() << std::endl;
+		return false;
+	}
+
+	// every source is assembled to an object of the same name in the output directory
+	std::vector<std::string> objectPaths;
+	std::set<std::string> usedPaths;
+	for (auto& inputFile : mInput.Input_Files) {
+		auto objectPath = (std::filesystem::path(mInput.Output_File) / std::filesystem::path(inputFile).filename().replace_extension(".o")).string();
+		if (!usedPaths.insert(objectPath).second) {
+			std::cerr << "Input file " << inputFile << " would overwrite object " << objectPath << " of another input file" << std::endl;
+			return false;
+		}
+		objectPaths.push_back(std::move(objectPath));
+	}
+
+	std::vector<TAssembly_Unit> units(mInput.Input_Files.size());
+	Parallel_For(units.size(), [this, &units, &objectPaths, objectFlags](size_t i) {
+
+		auto& unit = units[i];
+		unit.fileIndex = static_cast<uint32_t>(i);
+
+		uint64_t sourceHash = 0;
+		{
+			sarch32::CMapped_Text_File source;
+			if (!source.Open(mInput.Input_Files[i])) {
+				unit.diagnostics << "Could not open input file: " << mInput.Input_Files[i] << std::endl;
+				return;
+			}
+
+			const auto text = source.Get_Text();
+			sourceHash = SObj::Hash_FNV1a_64(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(text.data()), text.size()));
+		}
+
+		// the object is up to date, if it was assembled from the very same source with the same options
+		SObj::TObject_Info info;
+		if (sarch32::Read_Relocatable_Object_Info(objectPaths[i], info) && info.sourceHash == sourceHash && info.flags == objectFlags) {
+			Log(NLog_Level::Basic, "Up to date:", objectPaths[i]);
+			unit.success = true;
+			return;
+		}
+
+		// every object starts in the default section, as there is no previous file to continue
+		if (!Assemble_File(mInput.Input_Files[i], unit, mSection_Names.Get(mCurrent_Section))) {
+			return;
+		}
+
+		// the literal pools are a part of the object, the linker just patches the loads
+		Place_Literal_Pools(unit.sections, unit.sectionNames, unit.symbolNames, unit.labelRefs, unit.resolveRequests);
+
+		// objects of sources with errors are never up to date, so the errors are reported again next time
+		const bool clean = unit.diagnostics.view().empty();
+
+		unit.success = Generate_Object(unit, objectPaths[i], clean ? sourceHash : 0);
+	});
+
+	for (auto& unit : units) {
+		std::cerr << unit.diagnostics.str();
+		if (!unit.success)
+			return false;
+	}
+
+	return true;
 }
 
 bool CAssembler::Assemble() {
 
+	// relocatable objects are not linked at all
+	if (mInput.Object_Output) {
+		return Assemble_Objects();
+	}
+
 	// 1) load linker file
 	if (!Load_Linker_File(mInput.Linker_File)) {
 		std::cerr << "Could not load linker file" << std::endl;
 		return false;
 	}
 
-	// 2) assemble all input files
-	for (auto& inputFile : mInput.Input_Files) {
-		const bool result = Assemble_File(inputFile);
-		if (!result)
+	// 2) assemble all input files, each one on its own
+	mSource_Files = mInput.Input_Files;
+
+	std::vector<TAssembly_Unit> units(mInput.Input_Files.size());
+	Parallel_For(units.size(), [this, &units](size_t i) {
+		units[i].fileIndex = static_cast<uint32_t>(i);
+		units[i].success = Assemble_File(mInput.Input_Files[i], units[i], {});
+	});
+
+	// ...and merge them in the command line order, so the result is the same as if the files were assembled one after another
+	for (auto& unit : units) {
+		std::cerr << unit.diagnostics.str();
+		if (!unit.success)
 			return false;
+
+		Merge_Unit(unit);
+	}
+
+	// profile-guided layout of the code, before anything is placed after it
+	if (!mInput.Profile_File.empty() && !mInput.Stream_Emission && !Reorder_By_Profile()) {
+		return false;
+	}
+
+	// unreachable code and data are dropped before anything is placed for them
+	if (mInput.Remove_Unreachable && !mInput.Stream_Emission && !Remove_Unreachable()) {
+		return false;
+	}
+
+	// constants loaded from literal pools are placed after the contents of their sections
+	if (const size_t entries = Place_Literal_Pools(mSections, mSection_Names, mSymbol_Names, mLabel_Refs, mResolve_Requests); entries > 0) {
+		Log(NLog_Level::Extended, "Placed", entries, "literal pool entries");
+	}
+
+	// optional peephole rewrites, before the symbols are resolved to the final layout
+	if (mInput.Optimize) {
+		Optimize();
+	}
+
+	// branches to labels and constant loads are encoded in a form that reaches the label (the encoded contents of
+	// streaming emission cannot grow)
+	if (!mInput.Stream_Emission && !Relax_Layout()) {
+		return false;
 	}
 
 	// 3) resolve all symbols (basically "link")
@@ -4,12 +4,19 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <map>
+#include <set>
 #include <memory>
+#include <mutex>
 #include <iostream>
 
 #include "../core/isa.h"
 #include "../core/sobjfile.h"
+#include "../core/symbols.h"
+#include "../core/linker_file.h"
+#include "../core/relocatable.h"
+#include "../core/string_pool.h"
 
 #include "pseudoinstruction.h"
 
@@ -35,6 +42,24 @@ struct TAssembly_Input {
 	std::string Output_File;
 	// desired log level
 	NLog_Level Log_Level = NLog_Level::Basic;
+	// output object file format version
+	SObj::NVersion Output_Version = SObj::NVersion::V2;
+	// sections to be compressed in the output file
+	std::set<std::string> Compressed_Sections;
+	// emit symbol and line tables to the output file
+	bool Debug_Info = false;
+	// assemble every input file to a relocatable object in the output directory instead of linking them
+	bool Object_Output = false;
+	// encode instructions to bytes as soon as they are parsed; symbol references are patched in place afterwards
+	bool Stream_Emission = false;
+	// apply peephole rewrites to the assembled code
+	bool Optimize = false;
+	// execution profile (dumped by the emulator) to lay out the code by; empty for none
+	std::string Profile_File;
+	// drop instructions and data not reachable from the reset vector, the IVT or exported labels
+	bool Remove_Unreachable = false;
+	// labels kept by the reachability pass, along with everything they refer to
+	std::set<std::string> Exported_Symbols;
 };
 
 /*
@@ -48,62 +73,213 @@ class CAssembler {
 
 		// label reference for linkage
 		struct TLabel_Ref {
-			std::string section{};
+			sarch32::TString_Id section = 0;
 			size_t byteOffset = 0;
+			// the symbol may be just referenced, not defined
+			bool defined = false;
 		};
 
-		// assembled instructions and data, sorted to sections
-		std::map<std::string, std::vector<std::unique_ptr<CInstruction>>> mSections;
-		// cached section offsets for linkage
-		std::map<std::string, size_t> mSection_Offsets;
-		// cached label references for linkage
-		std::map<std::string, TLabel_Ref> mLabel_Refs;
+		// source location of assembled instruction or data
+		struct TSource_Location {
+			uint32_t fileIndex = 0;
+			uint32_t line = 0;
+		};
+
+		// line record of a streamed instruction or data item
+		struct TLine_Record {
+			uint32_t offset = 0;
+			uint32_t size = 0;
+			TSource_Location location;
+		};
+
+		// assembled instructions and data of a single section
+		struct TSection_Contents {
+			std::vector<std::unique_ptr<CInstruction>> instructions;
+			// source locations of assembled instructions and data (in the same order as instructions)
+			std::vector<TSource_Location> sourceLocations;
+			// cached section offset (size of the contents) for linkage
+			size_t offset = 0;
+
+			// streaming emission - the instructions are not kept, just the encoded contents and their line records
+			// (only with debug info)
+			std::vector<uint8_t> data;
+			std::vector<TLine_Record> lines;
+			// the encoded contents consist of reserved space only so far (data are not materialized)
+			bool zeroFill = true;
+			// count of encoded instructions and data items
+			size_t itemCount = 0;
+
+			// are there any instructions or data in the section?
+			bool Has_Contents() const {
+				return !instructions.empty() || itemCount > 0;
+			}
+		};
 
 		// resolve request for linkage - the linker then uses this request to resolve each symbol
 		struct TResolve_Request {
-			std::string symbol;
-			std::string section;
-			size_t instructionIndex;
+			sarch32::TString_Id symbol;
+			sarch32::TString_Id section;
+			uint32_t instructionIndex;
+		};
+
+		// interned section names; section IDs index mSections and mSection_Defs
+		sarch32::CString_Pool mSection_Names;
+		// interned symbol names; symbol IDs index mLabel_Refs
+		sarch32::CString_Pool mSymbol_Names;
+
+		// assembled instructions and data, sorted to sections
+		std::vector<TSection_Contents> mSections;
+		// cached label references for linkage
+		std::vector<TLabel_Ref> mLabel_Refs;
+
+		// assembled source files, indexed by TSource_Location::fileIndex
+		std::vector<std::string> mSource_Files;
+
+		// symbol reference in encoded contents (streaming emission) - the field is patched once the symbol address is known
+		struct TFixup {
+			sarch32::TString_Id symbol;
+			sarch32::TString_Id section;
+			uint32_t offset;
+			NRelocation_Kind kind;
 		};
 
 		// stored resolve requests
 		std::vector<TResolve_Request> mResolve_Requests;
+		// stored fixups (streaming emission)
+		std::vector<TFixup> mFixups;
 
-		// current section the assembler is assembling into
-		std::string mCurrent_Section = "data";
+		// current section the assembler is assembling into (the section the last merged file ended with)
+		sarch32::TString_Id mCurrent_Section = 0;
 
-		// definition of linker section (from the linker file)
-		struct TLinker_Section_Def {
-			std::string section{};
-			uint32_t startAddr = 0;
-			uint32_t limit = 0;
+		// file-local assembly unit - everything assembled from a single input file, before it is merged with the other files
+		// NOTE: the names are interned to pools of the unit (the files are assembled in parallel), so the unit IDs have to be
+		//       mapped when merged; the section with an empty name collects everything placed before the first section
+		//       directive of the file, it continues the section the previous file ended with; offsets and indices are relative
+		//       to the unit section
+		struct TAssembly_Unit {
+			uint32_t fileIndex = 0;
+			sarch32::CString_Pool sectionNames;
+			sarch32::CString_Pool symbolNames;
+			std::vector<TSection_Contents> sections;
+			std::vector<TLabel_Ref> labelRefs;
+			std::vector<TResolve_Request> resolveRequests;
+			std::vector<TFixup> fixups;
+			// streaming emission - buffer for a single encoded instruction and the size reserved for encoded contents
+			// of every section up front (estimated from the source size)
+			std::vector<uint8_t> scratch;
+			size_t reserveHint = 0;
+			// section the file currently assembles into
+			sarch32::TString_Id currentSection = 0;
+			// diagnostics, printed when the unit is merged (so they appear in the command line order)
+			std::ostringstream diagnostics;
+			bool success = false;
+		};
+
+		// generated contents of a section
+		struct TGenerated_Section {
+			// the section consists of reserved space only (no data are generated)
+			bool zeroFill = false;
+			uint32_t size = 0;
+			std::vector<uint8_t> data;
 		};
 
 		// stored linker sections from linker file
-		std::map<std::string, TLinker_Section_Def> mLinker_Section_Defs;
+		std::map<std::string, sarch32::TLinker_Section_Def> mLinker_Section_Defs;
+		// linker section definitions indexed by section ID (null for sections not placed by the linker file)
+		std::vector<const sarch32::TLinker_Section_Def*> mSection_Defs;
+
+		// retrieves linker section definition of given section; null if the section is not placed by the linker file
+		const sarch32::TLinker_Section_Def* Get_Section_Def(sarch32::TString_Id section) const {
+			return (section < mSection_Defs.size()) ? mSection_Defs[section] : nullptr;
+		}
+
+		// retrieves IDs of all sections of given pool sorted by name (for the output, which must not depend on the order of interning)
+		static std::vector<sarch32::TString_Id> Sorted_By_Name(const sarch32::CString_Pool& pool);
+
+		// label-delimited block of section contents (instruction indices)
+		struct TContents_Block {
+			size_t first = 0;
+			size_t last = 0;
+			// labels the block starts with
+			std::vector<sarch32::TString_Id> labels;
+		};
+
+		// splits contents of a section to blocks starting at labels (the first block starts at the section start, unless
+		// there is a label); labels defined in the section are stored along with the index of the instruction they precede
+		std::vector<TContents_Block> Split_To_Blocks(sarch32::TString_Id section, const std::vector<size_t>& starts,
+			std::vector<std::pair<size_t, sarch32::TString_Id>>& labels) const;
 
 	protected:
 
-		// assembles a given file
-		bool Assemble_File(const std::string& path);
+		// assembles a given file into a file-local unit, starting in given section (empty to continue the section
+		// of the previous file); may be called from multiple threads at once
+		bool Assemble_File(const std::string& path, TAssembly_Unit& unit, std::string_view initialSection);
+		// encodes an instruction or data item to the current section of the unit (streaming emission)
+		void Emit_Instruction(TAssembly_Unit& unit, CInstruction& instr, uint32_t lineNumber);
+		// merges a file-local unit after all the previously merged ones
+		void Merge_Unit(TAssembly_Unit& unit);
 
 		// loads a linker file
 		bool Load_Linker_File(const std::string& path);
 
+		// applies peephole rewrites to all sections placed by the linker file; returns the number of removed instructions
+		size_t Optimize();
+		// applies peephole rewrites to a single section; offsets of labels and instruction indices of resolve requests
+		// within the section are updated; returns the number of removed instructions
+		static size_t Optimize_Section(TSection_Contents& contents, const std::vector<size_t*>& labelOffsets, const std::vector<uint32_t*>& requestIndices);
+
+		// does the code of the section depend on its placement? (reads PC, branches relatively by an immediate value or
+		// a register, or is a target of an absolute branch by an immediate value)
+		bool Is_Position_Dependent(sarch32::TString_Id section) const;
+
+		// moves label-delimited blocks of the text section by execution counts of given profile - the hot ones to the start
+		// of the section, the ones never executed to the text_cold section (if placed by the linker file; to the end of
+		// the section otherwise); the first block stays in place, branches are added where the blocks fell through
+		bool Reorder_By_Profile();
+
+		// drops label-delimited blocks of the placed sections that are not reachable from the block at the reset vector,
+		// the blocks of the IVT and the exported labels by symbol references, by falling through or by following reachable
+		// data to its unreferenced labels (tables may be read past their interior labels); position dependent sections are
+		// kept whole
+		bool Remove_Unreachable();
+
+		// places literal pools of constant loads to the end of their sections; every distinct value is stored once per section
+		// under a label named after the section and the value; returns the number of pool entries
+		static size_t Place_Literal_Pools(std::vector<TSection_Contents>& sections, const sarch32::CString_Pool& sectionNames, sarch32::CString_Pool& symbolNames,
+			std::vector<TLabel_Ref>& labelRefs, std::vector<TResolve_Request>& resolveRequests);
+
+		// picks the first fitting form of every branch to a label (absolute, relative or long) and every constant load from
+		// a literal pool (pool or sequence); label offsets are updated as the instructions grow; fails if a label is out of
+		// reach of any form
+		bool Relax_Layout();
+
+		// resolves address of given symbol; on failure, the reason is stored to error
+		bool Resolve_Address(sarch32::TString_Id symbol, int32_t& addr, std::string& error) const;
 		// resolves symbols in all assembled files and sections
 		bool Resolve_Symbols();
 
+		// generates contents of a section
+		static void Generate_Section(std::vector<std::unique_ptr<CInstruction>>& instructions, TGenerated_Section& target);
 		// generates output binary given all assembling went OK
 		bool Generate_Binary();
+		// generates relocatable object of a file-local unit
+		bool Generate_Object(TAssembly_Unit& unit, const std::string& path, uint64_t sourceHash);
+		// assembles every input file to its own relocatable object; unchanged sources are skipped
+		bool Assemble_Objects();
+		// puts symbol and line tables to the output object file
+		void Generate_Debug_Info(SObj::CSObj_File& output);
 
 		// parses section directive in assembly file
-		bool Parse_Section_Directive(const std::string& line, std::string& sectionName) const;
+		bool Parse_Section_Directive(std::string_view line, std::string& sectionName) const;
 		// parses label directive in assembly file
-		bool Parse_Label_Directive(const std::string& line, std::string& labelName) const;
-		// parses a pseudoinstruction (data - db, dw, asciz)
-		std::unique_ptr<CInstruction> Parse_Pseudo_Instruction(const std::string& line) const;
+		bool Parse_Label_Directive(std::string_view line, std::string& labelName) const;
+		// parses a pseudoinstruction (data - db, dw, asciz; reserved space - .space; load constant - ldc)
+		std::unique_ptr<CInstruction> Parse_Pseudo_Instruction(std::string_view line) const;
 
 	protected:
+		// serializes log output of the worker threads
+		std::mutex mLog_Mtx;
+
 		// internal log method - single parameter output
 		template<typename T1>
 		void Log_Internal(const T1& val) {
@@ -124,6 +300,8 @@ class CAssembler {
 			if (static_cast<int>(ll) > static_cast<int>(mInput.Log_Level))
 				return;
 
+			std::unique_lock<std::mutex> lck(mLog_Mtx);
+
 			Log_Internal(args...);
 			std::cout << std::endl;
 		}
@@ -0,0 +1,467 @@
+#include "assembler.h"
+
+#include "../core/profile.h"
+#include "../core/machine.h"
+
+#include <algorithm>
+
+namespace {
+
+	// section hot code stays in and the section cold code is moved to
+	constexpr const char* Hot_Section_Name = "text";
+	constexpr const char* Cold_Section_Name = "text_cold";
+
+	// does the instruction always transfer control elsewhere? (unconditional branch or return)
+	bool Is_Unconditional_Transfer(const CInstruction& instr) {
+
+		if (instr.Get_Condition() != NCondition::always && instr.Get_Condition() != NCondition::unspecified) {
+			return false;
+		}
+
+		if (instr.Get_Opcode() == NOpcode::bi || instr.Get_Opcode() == NOpcode::br) {
+			return true;
+		}
+
+		std::string symbol;
+		if (instr.Is_Pseudo_Instruction() || instr.Get_Resolve_Request(symbol)) {
+			return false;
+		}
+
+		uint32_t word = 0;
+		try {
+			word = instr.Generate_Binary();
+		}
+		catch (const std::exception&) {
+			return false;
+		}
+
+		// mov pc, rX; pop pc
+		return (instr.Get_Opcode() == NOpcode::mov && static_cast<NRegister>((word >> 12) & 0xF) == NRegister::PC)
+			|| (instr.Get_Opcode() == NOpcode::pop && static_cast<NRegister>((word >> 8) & 0xF) == NRegister::PC);
+	}
+
+	// offsets of all instructions within the contents, followed by the size of the contents
+	std::vector<size_t> Instruction_Starts(const std::vector<std::unique_ptr<CInstruction>>& instructions) {
+		std::vector<size_t> starts(instructions.size() + 1, 0);
+		for (size_t i = 0; i < instructions.size(); i++) {
+			starts[i + 1] = starts[i] + instructions[i]->Get_Length();
+		}
+		return starts;
+	}
+
+	// does the execution continue past the last instruction of given range? data and reserved space never fall through;
+	// neither does code ending with an unconditional branch or return
+	bool Falls_Through(const std::vector<std::unique_ptr<CInstruction>>& instructions, size_t first, size_t last) {
+		for (size_t i = last; i > first; i--) {
+			const auto& instr = *instructions[i - 1];
+			if (instr.Get_Length() == 0) {
+				continue;
+			}
+			return (!instr.Is_Pseudo_Instruction() || dynamic_cast<const CRelaxable_Instruction*>(&instr)) && !Is_Unconditional_Transfer(instr);
+		}
+		return false;
+	}
+
+	// does the range hold data (or reserved space) rather than code? decided by its first non-empty instruction
+	bool Is_Data(const std::vector<std::unique_ptr<CInstruction>>& instructions, size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) {
+			const auto& instr = *instructions[i];
+			if (instr.Get_Length() == 0) {
+				continue;
+			}
+			return instr.Is_Pseudo_Instruction() && !dynamic_cast<const CRelaxable_Instruction*>(&instr);
+		}
+		return false;
+	}
+}
+
+std::vector<CAssembler::TContents_Block> CAssembler::Split_To_Blocks(sarch32::TString_Id section, const std::vector<size_t>& starts,
+	std::vector<std::pair<size_t, sarch32::TString_Id>>& labels) const {
+
+	const size_t count = mSections[section].instructions.size();
+
+	labels.clear();
+	for (sarch32::TString_Id i = 0; i < mLabel_Refs.size(); i++) {
+		if (mLabel_Refs[i].defined && mLabel_Refs[i].section == section) {
+			const auto index = static_cast<size_t>(std::lower_bound(starts.begin(), starts.end(), mLabel_Refs[i].byteOffset) - starts.begin());
+			labels.push_back({ index, i });
+		}
+	}
+	std::sort(labels.begin(), labels.end());
+
+	std::vector<TContents_Block> blocks(1);
+	for (auto& l : labels) {
+		if (l.first >= count) {
+			continue;
+		}
+		if (l.first != blocks.back().first) {
+			blocks.back().last = l.first;
+			blocks.push_back({ l.first, l.first, {} });
+		}
+		blocks.back().labels.push_back(l.second);
+	}
+	blocks.back().last = count;
+
+	if (blocks.front().first == blocks.front().last) {
+		blocks.erase(blocks.begin());
+	}
+
+	return blocks;
+}
+
+bool CAssembler::Reorder_By_Profile() {
+
+	Log(NLog_Level::Basic, "Reordering code by profile...");
+
+	sarch32::TProfile_Counts profile;
+	if (!sarch32::Load_Profile(mInput.Profile_File, profile)) {
+		std::cerr << "Could not load profile: " << mInput.Profile_File << std::endl;
+		return false;
+	}
+
+	sarch32::TString_Id text = 0;
+	if (!mSection_Names.Find(Hot_Section_Name, text) || text >= mSections.size() || mSections[text].instructions.empty() || !Get_Section_Def(text)) {
+		Log(NLog_Level::Basic, "No placed", Hot_Section_Name, "section to reorder");
+		return true;
+	}
+
+	if (Is_Position_Dependent(text)) {
+		Log(NLog_Level::Basic, "Section", Hot_Section_Name, "contains position dependent code, not reordered");
+		return true;
+	}
+
+	// cold code goes to its own section, if the linker file places it
+	sarch32::TString_Id cold = 0;
+	const bool hasColdSection = mSection_Names.Find(Cold_Section_Name, cold) && Get_Section_Def(cold);
+
+	auto& contents = mSections[text];
+	const size_t count = contents.instructions.size();
+
+	const auto starts = Instruction_Starts(contents.instructions);
+
+	// 1) split the section to blocks starting at labels; the first block starts at the section start
+	std::vector<std::pair<size_t, sarch32::TString_Id>> labels;
+	const auto blocks = Split_To_Blocks(text, starts, labels);
+
+	// 2) count executed instructions of every block - by the symbol counts, if the profile has them for the block labels,
+	//    by the address counts otherwise (these require the profiled image to have the same layout)
+	const auto startAddr = Get_Section_Def(text)->startAddr;
+	std::vector<uint64_t> executed(blocks.size(), 0);
+
+	for (size_t i = 0; i < blocks.size(); i++) {
+		const auto& b = blocks[i];
+
+		bool bySymbol = false;
+		for (auto label : b.labels) {
+			if (auto itr = profile.symbols.find(mSymbol_Names.Get(label)); itr != profile.symbols.end()) {
+				executed[i] += itr->second;
+				bySymbol = true;
+			}
+		}
+
+		if (!bySymbol) {
+			auto first = profile.addresses.lower_bound(static_cast<uint32_t>(startAddr + starts[b.first]));
+			auto last = profile.addresses.lower_bound(static_cast<uint32_t>(startAddr + starts[b.last]));
+			for (auto itr = first; itr != last; ++itr) {
+				executed[i] += itr->second;
+			}
+		}
+	}
+
+	// 3) the first block keeps the section entry, hot blocks follow from the most executed one, cold blocks keep their order
+	std::vector<size_t> order(blocks.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin() + 1, order.end(), [&executed](size_t a, size_t b) {
+		return executed[a] > executed[b];
+	});
+
+	const size_t hotEnd = std::find_if(order.begin() + 1, order.end(), [&executed](size_t i) { return executed[i] == 0; }) - order.begin();
+
+	// new placement of the blocks - section and position in the new order of the section
+	std::vector<std::pair<sarch32::TString_Id, size_t>> placement(blocks.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		const bool toCold = hasColdSection && i >= hotEnd;
+		placement[order[i]] = { toCold ? cold : text, toCold ? (i - hotEnd) : i };
+	}
+
+	// 4) move the instructions; a block that fell through to the following one branches there, unless it still precedes it
+	std::vector<std::unique_ptr<CInstruction>> oldInstructions = std::move(contents.instructions);
+	std::vector<TSource_Location> oldLocations = std::move(contents.sourceLocations);
+	contents.instructions.clear();
+	contents.sourceLocations.clear();
+	contents.offset = 0;
+
+	// new section and index of every moved instruction
+	std::vector<std::pair<sarch32::TString_Id, uint32_t>> moved(count);
+	std::vector<std::pair<sarch32::TString_Id, size_t>> blockStarts(blocks.size());
+	size_t addedBranches = 0;
+
+	for (const auto bi : order) {
+
+		const auto& b = blocks[bi];
+		auto& target = mSections[placement[bi].first];
+
+		blockStarts[bi] = { placement[bi].first, target.offset };
+
+		const bool fallsThrough = Falls_Through(oldInstructions, b.first, b.last);
+
+		for (size_t i = b.first; i < b.last; i++) {
+			moved[i] = { placement[bi].first, static_cast<uint32_t>(target.instructions.size()) };
+			target.offset += oldInstructions[i]->Get_Length();
+			target.instructions.push_back(std::move(oldInstructions[i]));
+			target.sourceLocations.push_back(oldLocations[i]);
+		}
+
+		if (bi + 1 >= blocks.size()) {
+			continue;
+		}
+
+		const bool adjacent = placement[bi + 1].first == placement[bi].first && placement[bi + 1].second == placement[bi].second + 1;
+
+		if (!adjacent && fallsThrough) {
+			const auto next = blocks[bi + 1].labels.front();
+
+			mResolve_Requests.push_back({ next, placement[bi].first, static_cast<uint32_t>(target.instructions.size()) });
+			target.instructions.push_back(std::make_unique<CPseudo_Instruction_Branch>(NCondition::always, mSymbol_Names.Get(next)));
+			target.sourceLocations.push_back(target.sourceLocations.back());
+			target.offset += target.instructions.back()->Get_Length();
+
+			addedBranches++;
+		}
+	}
+
+	// 5) labels and resolve requests follow the instructions
+	for (auto& l : labels) {
+		auto& lr = mLabel_Refs[l.second];
+		if (l.first >= count) {
+			// labels at the very end of the section stay there
+			lr.byteOffset = contents.offset;
+			continue;
+		}
+
+		const auto block = static_cast<size_t>(std::upper_bound(blocks.begin(), blocks.end(), l.first, [](size_t index, const TContents_Block& b) { return index < b.first; }) - blocks.begin()) - 1;
+		lr.section = blockStarts[block].first;
+		lr.byteOffset = blockStarts[block].second;
+	}
+
+	for (size_t i = 0; i < mResolve_Requests.size() - addedBranches; i++) {
+		auto& rr = mResolve_Requests[i];
+		if (rr.section == text) {
+			rr.section = moved[rr.instructionIndex].first;
+			rr.instructionIndex = moved[rr.instructionIndex].second;
+		}
+	}
+
+	Log(NLog_Level::Extended, "Reordered", blocks.size(), "blocks,", order.size() - hotEnd, "never executed moved to", hasColdSection ? Cold_Section_Name : "the end of section",
+		"and", addedBranches, "branches added");
+
+	return true;
+}
+
+bool CAssembler::Remove_Unreachable() {
+
+	Log(NLog_Level::Basic, "Removing unreachable code and data...");
+
+	constexpr size_t No_Block = static_cast<size_t>(-1);
+
+	// 1) split all sections to blocks starting at labels, note the block every label starts (labels at the very end
+	//    of a section start no block)
+	std::vector<std::vector<size_t>> starts(mSections.size());
+	std::vector<std::vector<TContents_Block>> blocks(mSections.size());
+	std::vector<std::pair<sarch32::TString_Id, size_t>> labelBlocks(mLabel_Refs.size(), { 0, No_Block });
+
+	for (sarch32::TString_Id i = 0; i < mSections.size(); i++) {
+
+		starts[i] = Instruction_Starts(mSections[i].instructions);
+
+		std::vector<std::pair<size_t, sarch32::TString_Id>> labels;
+		blocks[i] = Split_To_Blocks(i, starts[i], labels);
+
+		size_t block = 0;
+		for (auto& l : labels) {
+			if (l.first >= mSections[i].instructions.size()) {
+				continue;
+			}
+			while (blocks[i][block].last <= l.first) {
+				block++;
+			}
+			labelBlocks[l.second] = { i, block };
+		}
+	}
+
+	// symbols referred to by the instructions of every section (instruction index, symbol)
+	std::vector<std::vector<std::pair<uint32_t, sarch32::TString_Id>>> references(mSections.size());
+	std::vector<bool> referenced(mLabel_Refs.size(), false);
+	for (auto& rr : mResolve_Requests) {
+		references[rr.section].push_back({ rr.instructionIndex, rr.symbol });
+		if (rr.symbol < referenced.size()) {
+			referenced[rr.symbol] = true;
+		}
+	}
+	for (auto& r : references) {
+		std::sort(r.begin(), r.end());
+	}
+
+	std::vector<std::vector<bool>> reachable(mSections.size());
+	std::vector<std::pair<sarch32::TString_Id, size_t>> pending;
+
+	auto reach = [&reachable, &pending](sarch32::TString_Id section, size_t block) {
+		if (!reachable[section][block]) {
+			reachable[section][block] = true;
+			pending.push_back({ section, block });
+		}
+	};
+
+	// 2) the roots - blocks at the reset vector and in the IVT, blocks of exported labels; sections not placed by the linker
+	//    file or depending on their placement are kept whole
+	constexpr uint32_t IVT_End = Get_IVT_Vector_Address(NIVT_Entry::Supervisor_Call) + sizeof(uint32_t);
+
+	for (sarch32::TString_Id i = 0; i < mSections.size(); i++) {
+
+		reachable[i].resize(blocks[i].size(), false);
+
+		const auto* slink = Get_Section_Def(i);
+		const bool whole = !slink || Is_Position_Dependent(i);
+
+		for (size_t j = 0; j < blocks[i].size(); j++) {
+			if (whole) {
+				reach(i, j);
+				continue;
+			}
+
+			const uint32_t first = slink->startAddr + static_cast<uint32_t>(starts[i][blocks[i][j].first]);
+			const uint32_t last = slink->startAddr + static_cast<uint32_t>(starts[i][blocks[i][j].last]);
+
+			if ((sarch32::Reset_Vector >= first && sarch32::Reset_Vector < last) || (first < IVT_End && last > IVT_Address)) {
+				reach(i, j);
+			}
+		}
+	}
+
+	for (auto& name : mInput.Exported_Symbols) {
+		sarch32::TString_Id id = 0;
+		if (!mSymbol_Names.Find(name, id) || !mLabel_Refs[id].defined) {
+			std::cerr << "Exported label is not defined: " << name << std::endl;
+			return false;
+		}
+
+		if (labelBlocks[id].second != No_Block) {
+			reach(labelBlocks[id].first, labelBlocks[id].second);
+		}
+	}
+
+	if (pending.empty()) {
+		std::cerr << "Nothing is placed at the reset vector or exported, unreachable code not removed" << std::endl;
+		return true;
+	}
+
+	// 3) follow the symbol references and the execution falling through to the next block; data may be read past its
+	//    interior labels (a table indexed from its first label), so a reachable data block keeps the following data block
+	//    unless a label of that one is referred to on its own
+	while (!pending.empty()) {
+
+		const auto [section, block] = pending.back();
+		pending.pop_back();
+
+		const auto& b = blocks[section][block];
+		const auto& refs = references[section];
+
+		for (auto itr = std::lower_bound(refs.begin(), refs.end(), std::make_pair(static_cast<uint32_t>(b.first), sarch32::TString_Id{ 0 }));
+			itr != refs.end() && itr->first < b.last; ++itr) {
+
+			// undefined labels are left to the symbol resolution to report
+			if (itr->second < labelBlocks.size() && labelBlocks[itr->second].second != No_Block) {
+				reach(labelBlocks[itr->second].first, labelBlocks[itr->second].second);
+			}
+		}
+
+		if (block + 1 < blocks[section].size()) {
+			const auto& instructions = mSections[section].instructions;
+			const auto& next = blocks[section][block + 1];
+
+			// labels nothing refers to are interior labels of the data before them (e.g., of a table indexed from its first label)
+			const bool interior = std::none_of(next.labels.begin(), next.labels.end(), [&referenced](sarch32::TString_Id l) { return referenced[l]; });
+
+			if (Falls_Through(instructions, b.first, b.last)
+				|| (interior && Is_Data(instructions, b.first, b.last) && Is_Data(instructions, next.first, next.last))) {
+				reach(section, block + 1);
+			}
+		}
+	}
+
+	// 4) drop the unreachable blocks and compact the rest; labels of the dropped blocks are no longer defined
+	size_t removedBlocks = 0, removedBytes = 0;
+
+	for (sarch32::TString_Id i = 0; i < mSections.size(); i++) {
+
+		if (std::find(reachable[i].begin(), reachable[i].end(), false) == reachable[i].end()) {
+			continue;
+		}
+
+		auto& contents = mSections[i];
+
+		std::vector<std::unique_ptr<CInstruction>> oldInstructions = std::move(contents.instructions);
+		std::vector<TSource_Location> oldLocations = std::move(contents.sourceLocations);
+		contents.instructions.clear();
+		contents.sourceLocations.clear();
+		contents.offset = 0;
+
+		// new index of every kept instruction, new offset of every kept block
+		std::vector<uint32_t> moved(oldInstructions.size(), 0);
+		std::vector<size_t> blockStarts(blocks[i].size(), 0);
+
+		for (size_t j = 0; j < blocks[i].size(); j++) {
+			const auto& b = blocks[i][j];
+
+			if (!reachable[i][j]) {
+				removedBlocks++;
+				removedBytes += starts[i][b.last] - starts[i][b.first];
+				continue;
+			}
+
+			blockStarts[j] = contents.offset;
+
+			for (size_t k = b.first; k < b.last; k++) {
+				moved[k] = static_cast<uint32_t>(contents.instructions.size());
+				contents.offset += oldInstructions[k]->Get_Length();
+				contents.instructions.push_back(std::move(oldInstructions[k]));
+				contents.sourceLocations.push_back(oldLocations[k]);
+			}
+		}
+
+		for (sarch32::TString_Id l = 0; l < mLabel_Refs.size(); l++) {
+			auto& lr = mLabel_Refs[l];
+			if (!lr.defined || lr.section != i) {
+				continue;
+			}
+
+			if (labelBlocks[l].second == No_Block) {
+				// labels at the very end of the section stay there
+				lr.byteOffset = contents.offset;
+			}
+			else if (reachable[i][labelBlocks[l].second]) {
+				lr.byteOffset = blockStarts[labelBlocks[l].second];
+			}
+			else {
+				lr.defined = false;
+			}
+		}
+
+		// requests of the dropped instructions go along with them (the kept instructions were moved out already)
+		std::erase_if(mResolve_Requests, [i, &oldInstructions](const TResolve_Request& rr) {
+			return rr.section == i && oldInstructions[rr.instructionIndex] != nullptr;
+		});
+
+		for (auto& rr : mResolve_Requests) {
+			if (rr.section == i) {
+				rr.instructionIndex = moved[rr.instructionIndex];
+			}
+		}
+	}
+
+	Log(NLog_Level::Extended, "Removed", removedBlocks, "unreachable blocks,", removedBytes, "bytes");
+
+	return true;
+}
@@ -27,6 +27,9 @@ static bool Parse_CLI_Args(int argc, char** argv, TAssembly_Input& target) {
 		lfile,
 		ofile,
 		loglevel,
+		compress,
+		profile,
+		exported,
 	};
 
 	// current mode
@@ -50,6 +53,48 @@ static bool Parse_CLI_Args(int argc, char** argv, TAssembly_Input& target) {
 		else if (args[i] == "-ll") {
 			mode = NMode::loglevel;
 		}
+		// legacy output format
+		else if (args[i] == "-v1") {
+			target.Output_Version = SObj::NVersion::V1;
+			mode = NMode::none;
+		}
+		// section compression
+		else if (args[i] == "-z") {
+			mode = NMode::compress;
+		}
+		// symbol and line tables
+		else if (args[i] == "-g") {
+			target.Debug_Info = true;
+			mode = NMode::none;
+		}
+		// relocatable objects (the output is a directory)
+		else if (args[i] == "-c") {
+			target.Object_Output = true;
+			mode = NMode::none;
+		}
+		// peephole optimization
+		else if (args[i] == "-O") {
+			target.Optimize = true;
+			mode = NMode::none;
+		}
+		// profile-guided code layout
+		else if (args[i] == "-profile") {
+			mode = NMode::profile;
+		}
+		// removal of unreachable code and data
+		else if (args[i] == "-gc") {
+			target.Remove_Unreachable = true;
+			mode = NMode::none;
+		}
+		// labels kept by the removal of unreachable code
+		else if (args[i] == "-export") {
+			mode = NMode::exported;
+		}
+		// streaming emission (instructions are encoded right away)
+		else if (args[i] == "-stream") {
+			target.Stream_Emission = true;
+			mode = NMode::none;
+		}
 		// we have some mode set
 		else if (mode != NMode::none) {
 
@@ -85,6 +130,18 @@ static bool Parse_CLI_Args(int argc, char** argv, TAssembly_Input& target) {
 					}
 					mode = NMode::none;
 					break;
+				case NMode::compress:
+					target.Compressed_Sections.insert(args[i]);
+					mode = NMode::none;
+					break;
+				case NMode::profile:
+					target.Profile_File = args[i];
+					mode = NMode::none;
+					break;
+				case NMode::exported:
+					// the label may be given with or without the dollar sign
+					target.Exported_Symbols.insert((args[i].starts_with('$')) ? args[i].substr(1) : args[i]);
+					break;
 			}
 
 		}
@@ -119,6 +176,29 @@ static bool Parse_CLI_Args(int argc, char** argv, TAssembly_Input& target) {
 		return false;
 	}
 
+	// the rewrites need all instructions and the final placement of sections
+	if (target.Optimize && (target.Object_Output || target.Stream_Emission)) {
+		std::cerr << "Peephole optimization is not applied to relocatable objects and in streaming mode" << std::endl;
+	}
+
+	// the blocks are moved within all the assembled code
+	if (!target.Profile_File.empty() && (target.Object_Output || target.Stream_Emission)) {
+		std::cerr << "Profile-guided layout is not applied to relocatable objects and in streaming mode" << std::endl;
+	}
+
+	// reachability is given by all the assembled code
+	if (target.Remove_Unreachable && (target.Object_Output || target.Stream_Emission)) {
+		std::cerr << "Removal of unreachable code is not applied to relocatable objects and in streaming mode" << std::endl;
+	}
+
+	// relocatable objects are placed by the linker
+	if (target.Object_Output) {
+		if (target.Output_Version == SObj::NVersion::V1 || !target.Compressed_Sections.empty()) {
+			std::cerr << "Output format and section compression do not apply to relocatable objects, pass them to the linker" << std::endl;
+		}
+		return true;
+	}
+
 	// there must be a linker file specified
 	if (target.Linker_File.empty()) {
 		std::cerr << "No linker file specified" << std::endl;
@@ -1,61 +1,194 @@
 #include "assembler.h"
 
-#include <regex>
+#include "../core/lexer.h"
 
-bool CAssembler::Parse_Section_Directive(const std::string& line, std::string& sectionName) const {
+#include <algorithm>
 
-	// regex that matches a section directive (e.g., ".section abcd"), possibly containing a comment
-	std::regex sectionregex{ "^[\\s]{0,}\\.section[\\s]*([a-zA-Z]+)[\\s]*(;.*)?$", std::regex::ECMAScript };
+namespace {
 
-	std::smatch sm;
-	if (!std::regex_match(line, sm, sectionregex) || sm.size() < 2)
+	// is the character allowed within a label name?
+	bool Is_Label_Char(char c) {
+		return sarch32::Is_Alnum(c) || c == '_';
+	}
+
+	// is the character allowed within a data immediate?
+	bool Is_Data_Immediate_Char(char c) {
+		return sarch32::Is_Hex_Digit(c) || c == '-' || c == 'x';
+	}
+
+	// validates data immediate value (without the # prefix) - up to 3 characters of sign and hex prefix ("-", "0", "x"), followed by hex digits
+	bool Is_Data_Immediate(std::string_view str) {
+		// everything past the last sign or hex prefix character must be a digit
+		const auto last = str.find_last_of("-x");
+		const size_t digitsStart = (last == std::string_view::npos) ? 0 : last + 1;
+
+		return digitsStart <= 3 && digitsStart < str.size()
+			&& std::all_of(str.begin(), str.begin() + digitsStart, [](char c) { return c == '-' || c == '0' || c == 'x'; });
+	}
+}
+
+bool CAssembler::Parse_Section_Directive(std::string_view line, std::string& sectionName) const {
+
+	sarch32::CLine_Lexer lex{ line };
+	lex.Skip_Space();
+
+	// zero-filled section shorthand (".bss" is the same as ".section bss")
+	{
+		sarch32::CLine_Lexer bss = lex;
+		if (bss.Accept(".bss") && bss.Accept_Trailer()) {
+			sectionName = "bss";
+			return true;
+		}
+	}
+
+	// section directive (e.g., ".section abcd"), possibly containing a comment
+	if (!lex.Accept(".section"))
 		return false;
 
-	sectionName = sm[1];
+	lex.Skip_Space();
+	const auto name = lex.Take_While(sarch32::Is_Alpha);
+	if (name.empty() || !lex.Accept_Trailer())
+		return false;
+
+	sectionName = name;
 	return true;
 }
 
-bool CAssembler::Parse_Label_Directive(const std::string& line, std::string& labelName) const {
+bool CAssembler::Parse_Label_Directive(std::string_view line, std::string& labelName) const {
+
+	// label directive (e.g., "$label_abcd:"), possibly containing a comment
+	sarch32::CLine_Lexer lex{ line };
+	lex.Skip_Space();
 
-	// regex that matches a label directive (e.g., "$label_abcd:"), possibly containing a comment
-	std::regex labelregex{ "^[\\s]{0,}\\$([a-zA-Z0-9_]+):[\\s]*(;.*)?$", std::regex::ECMAScript };
+	if (!lex.Accept('$'))
+		return false;
 
-	std::smatch sm;
-	if (!std::regex_match(line, sm, labelregex) || sm.size() < 2)
+	const auto name = lex.Take_While(Is_Label_Char);
+	if (name.empty() || !lex.Accept(':') || !lex.Accept_Trailer())
 		return false;
 
-	labelName = sm[1];
+	labelName = name;
 	return true;
 }
 
-std::unique_ptr<CInstruction> CAssembler::Parse_Pseudo_Instruction(const std::string& line) const {
+std::unique_ptr<CInstruction> CAssembler::Parse_Pseudo_Instruction(std::string_view line) const {
+
+	sarch32::CLine_Lexer lex{ line };
+	lex.Skip_Space();
+	const auto directive = lex.Rest();
+
+	// match space directive (e.g., ".space 1024", ".space #0x100000"), possibly containing a comment
+	if (lex.Accept(".space")) {
 
-	// regex that matches a data directive (e.g., "db #12", "dw #12345", "dw $otherlabel"), possibly containing a comment
-	std::regex dbregex{ "^[\\s]{0,}(db|dw)[\\s]{0,}(#[\\-0x]{0,3}[0-9a-fA-F]+|\\$[a-zA-Z0-9_]+)[\\s]{0,}(;.*)?$", std::regex::ECMAScript };
-	// regex that matches a string data directive (e.g., "asciz 'hello world'"), possibly containing a comment
-	std::regex strregex{ "^[\\s]{0,}(asciz)[\\s]{0,}('[^']*')[\\s]{0,}(;.*)?$", std::regex::ECMAScript };
+		if (!lex.Skip_Space())
+			return nullptr;
+
+		const auto value = lex.Rest();
+		lex.Accept('#');
+		const bool hex = lex.Accept("0x");
+		const auto digits = lex.Take_While(hex ? sarch32::Is_Hex_Digit : sarch32::Is_Digit);
+		const auto operand = value.substr(0, value.size() - lex.Rest().size());
 
-	std::smatch sm;
+		if (digits.empty() || !lex.Accept_Trailer())
+			return nullptr;
 
-	// match data directive
-	if (std::regex_match(line, sm, dbregex) && sm.size() >= 3) {
+		std::unique_ptr<CPseudo_Instruction_Space> instr = std::make_unique<CPseudo_Instruction_Space>();
+		if (!instr->Parse_String("space", std::vector<std::string>{ std::string(operand) }))
+			return nullptr;
+
+		return instr;
+	}
+
+	// match data directive (e.g., "db #12", "dw #12345", "dw $otherlabel"), possibly containing a comment
+	if (lex.Accept("db") || lex.Accept("dw")) {
+
+		const std::string mnemonic{ directive.substr(0, 2) };
+
+		lex.Skip_Space();
+		const auto value = lex.Rest();
+		if (lex.Accept('#')) {
+			if (!Is_Data_Immediate(lex.Take_While(Is_Data_Immediate_Char)))
+				return nullptr;
+		}
+		else if (lex.Accept('$')) {
+			if (lex.Take_While(Is_Label_Char).empty())
+				return nullptr;
+		}
+		else
+			return nullptr;
+
+		const auto operand = value.substr(0, value.size() - lex.Rest().size());
+		if (!lex.Accept_Trailer())
+			return nullptr;
 
 		std::unique_ptr<CPseudo_Instruction_Data> instr = std::make_unique<CPseudo_Instruction_Data>();
-		if (!instr->Parse_String(sm[1], std::vector<std::string>{ sm[2] }))
+		if (!instr->Parse_String(mnemonic, std::vector<std::string>{ std::string(operand) }))
 			return nullptr;
 
 		return instr;
 	}
 
-	// match string directive
-	if (std::regex_match(line, sm, strregex) && sm.size() >= 3) {
+	// match string directive (e.g., "asciz 'hello world'"), possibly containing a comment
+	if (lex.Accept("asciz")) {
+
+		lex.Skip_Space();
+		const auto value = lex.Rest();
+		if (!lex.Accept('\''))
+			return nullptr;
+
+		lex.Take_While([](char c) { return c != '\''; });
+		if (!lex.Accept('\''))
+			return nullptr;
+
+		const auto operand = value.substr(0, value.size() - lex.Rest().size());
+		if (!lex.Accept_Trailer())
+			return nullptr;
 
 		std::unique_ptr<CPseudo_Instruction_Data> instr = std::make_unique<CPseudo_Instruction_Data>();
-		if (!instr->Parse_String(sm[1], std::vector<std::string>{ sm[2] }))
+		if (!instr->Parse_String("asciz", std::vector<std::string>{ std::string(operand) }))
 			return nullptr;
 
 		return instr;
 	}
 
+	// match load constant (e.g., "ldc r1, #0x12345678"), possibly containing a comment
+	if (lex.Accept("ldc")) {
+
+		// the load may expand to several instructions (and clobber r0), a condition would have to apply to all of them
+		if (lex.Peek() == '.') {
+			throw sarch32_parser_exception{ "ldc cannot be conditional, branch around it instead: " + std::string(directive) };
+		}
+
+		// other mnemonics starting with "ldc" are left to the machine instruction parser
+		const auto operands = lex.Rest();
+		if (!lex.Skip_Space() && !lex.Accept_Trailer())
+			return nullptr;
+
+		const auto invalidOperands = [&operands]() {
+			return sarch32_parser_exception{ "ldc expects a register and an immediate (e.g., ldc r1, #0x12345678): ldc" + std::string(operands) };
+		};
+
+		const auto reg = lex.Take_While(Is_Label_Char);
+		lex.Skip_Space();
+		if (reg.empty() || !lex.Accept(','))
+			throw invalidOperands();
+
+		lex.Skip_Space();
+		const auto value = lex.Rest();
+		if (!lex.Accept('#') || !Is_Data_Immediate(lex.Take_While(Is_Data_Immediate_Char)))
+			throw invalidOperands();
+
+		const auto operand = value.substr(0, value.size() - lex.Rest().size());
+		if (!lex.Accept_Trailer())
+			throw invalidOperands();
+
+		// streamed instructions are encoded before the literal pools are placed, so the constants are built by a sequence instead
+		std::unique_ptr<CPseudo_Instruction_Load_Constant> instr = std::make_unique<CPseudo_Instruction_Load_Constant>(!mInput.Stream_Emission);
+		if (!instr->Parse_String("ldc", std::vector<std::string>{ std::string(reg), std::string(operand) }))
+			throw invalidOperands();
+
+		return instr;
+	}
+
 	return nullptr;
 }
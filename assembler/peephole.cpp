@@ -0,0 +1,421 @@
+#include "assembler.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+	// machine instruction decoded from its encoding - just the fields the rewrites look at
+	struct TDecoded {
+		// the instruction is a machine instruction without a symbolic operand, i.e., it may be rewritten
+		bool valid = false;
+		NOpcode opcode = NOpcode::nop;
+		NCondition condition = NCondition::always;
+		// register pair (meaningful only for instructions with register operands)
+		NRegister dst = NRegister::R0;
+		NRegister src = NRegister::R0;
+		// immediate operand (16bit, 24bit for fw and svc)
+		int32_t imm = 0;
+		// the branch is relative to PC
+		bool relative = false;
+	};
+
+	TDecoded Decode(const CInstruction& instr) {
+
+		TDecoded d;
+
+		// symbolic operands are known only after the layout is final
+		std::string symbol;
+		if (instr.Is_Pseudo_Instruction() || instr.Get_Resolve_Request(symbol)) {
+			return d;
+		}
+
+		uint32_t word = 0;
+		try {
+			word = instr.Generate_Binary();
+		}
+		catch (const std::exception&) {
+			// invalid instruction (e.g., immediate out of range) is left intact and reported when generated
+			return d;
+		}
+
+		d.valid = true;
+		d.opcode = instr.Get_Opcode();
+		d.condition = instr.Get_Condition();
+		d.dst = static_cast<NRegister>((word >> 12) & 0xF);
+		d.src = static_cast<NRegister>((word >> 8) & 0xF);
+		d.imm = (d.opcode == NOpcode::fw || d.opcode == NOpcode::svc) ? (static_cast<int32_t>(word) >> 8) : static_cast<int16_t>(word >> 16);
+		d.relative = (d.opcode == NOpcode::bi || d.opcode == NOpcode::br) && ((word >> 8) & 0xFF) == 0xFF;
+
+		return d;
+	}
+
+	// encodes unconditional instruction with register and immediate operands
+	uint32_t Encode_Immediate(NOpcode opcode, NRegister dst, int32_t imm) {
+		return static_cast<uint32_t>(opcode) | (static_cast<uint32_t>(dst) << 12) | (static_cast<uint32_t>(static_cast<uint16_t>(imm)) << 16);
+	}
+
+	// encodes unconditional instruction with two register operands
+	uint32_t Encode_Registers(NOpcode opcode, NRegister dst, NRegister src) {
+		return static_cast<uint32_t>(opcode) | (static_cast<uint32_t>(dst) << 12) | (static_cast<uint32_t>(src) << 8);
+	}
+
+	// does the instruction leave everything as it was?
+	bool Is_No_Op(const TDecoded& d) {
+		switch (d.opcode) {
+			case NOpcode::mov:
+				return d.dst == d.src;
+			case NOpcode::addi:
+			case NOpcode::subi:
+			case NOpcode::ori:
+			case NOpcode::sli:
+			case NOpcode::sri:
+				return d.imm == 0;
+			case NOpcode::muli:
+				return d.imm == 1;
+			case NOpcode::andi:
+				return d.imm == -1;
+			default:
+				return false;
+		}
+	}
+
+	// does the instruction just set a register, without reading its previous value and without any other effect?
+	bool Just_Sets(const TDecoded& d, NRegister& reg) {
+		switch (d.opcode) {
+			case NOpcode::movi:
+				reg = d.dst;
+				return true;
+			case NOpcode::mov:
+				reg = d.dst;
+				return d.dst != d.src;
+			case NOpcode::fw:
+				reg = NRegister::R0;
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	// does the instruction use PC as anything but a target of return (mov pc, ra; pop pc) or register branch?
+	bool Mentions_PC(const TDecoded& d) {
+		switch (d.opcode) {
+			case NOpcode::nop:
+			case NOpcode::bi:
+			case NOpcode::br:
+			case NOpcode::fw:
+			case NOpcode::svc:
+			case NOpcode::pop:
+				return false;
+			case NOpcode::push:
+			case NOpcode::mov:
+				return d.src == NRegister::PC;
+			default:
+				break;
+		}
+
+		// the rest have a register operand first, followed by a register (odd opcodes) or an immediate
+		const bool registerForm = static_cast<uint8_t>(d.opcode) < 27 && (static_cast<uint8_t>(d.opcode) & 0x1);
+		return d.dst == NRegister::PC || (registerForm && d.src == NRegister::PC);
+	}
+
+	// evaluates "op reg, #imm" on a known register value; false, if the operation cannot be folded
+	bool Fold(NOpcode opcode, uint32_t value, int32_t imm, uint32_t& result) {
+		const uint32_t k = static_cast<uint32_t>(imm);
+		switch (opcode) {
+			case NOpcode::addi: result = value + k; return true;
+			case NOpcode::subi: result = value - k; return true;
+			case NOpcode::muli: result = value * k; return true;
+			case NOpcode::andi: result = value & k; return true;
+			case NOpcode::ori:  result = value | k; return true;
+			case NOpcode::sli:  result = (k >= 32) ? 0 : (value << k); return true;
+			case NOpcode::sri:  result = (k >= 32) ? 0 : (value >> k); return true;
+			default:
+				return false;
+		}
+	}
+
+	// does the value fit to a 16bit immediate?
+	bool Fits_Imm16(uint32_t value) {
+		const int32_t v = static_cast<int32_t>(value);
+		return v >= std::numeric_limits<int16_t>::min() && v <= std::numeric_limits<int16_t>::max();
+	}
+}
+
+size_t CAssembler::Optimize_Section(TSection_Contents& contents, const std::vector<size_t*>& labelOffsets, const std::vector<uint32_t*>& requestIndices) {
+
+	auto& instrs = contents.instructions;
+	const size_t count = instrs.size();
+
+	std::vector<size_t> offsets(count + 1, 0);
+	std::vector<TDecoded> decoded(count);
+	for (size_t i = 0; i < count; i++) {
+		offsets[i + 1] = offsets[i] + instrs[i]->Get_Length();
+		decoded[i] = Decode(*instrs[i]);
+	}
+
+	// control may enter the section just at labels and targets of relative branches - no rewrite may span them
+	std::vector<size_t> targets;
+	for (auto* offset : labelOffsets) {
+		targets.push_back(*offset);
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		const auto& d = decoded[i];
+		if (!d.valid) {
+			continue;
+		}
+
+		// code reading PC (e.g., to compute a return address) or branching relatively by a register depends on the layout
+		if (Mentions_PC(d) || (d.opcode == NOpcode::br && d.relative)) {
+			return 0;
+		}
+
+		if (d.opcode == NOpcode::bi && d.relative) {
+			const int64_t target = static_cast<int64_t>(offsets[i] + 4) + d.imm;
+			if (target < 0 || !std::binary_search(offsets.begin(), offsets.end(), static_cast<size_t>(target))) {
+				return 0;
+			}
+			targets.push_back(static_cast<size_t>(target));
+		}
+	}
+
+	std::sort(targets.begin(), targets.end());
+
+	// can control enter between given instructions?
+	auto entered = [&targets, &offsets](size_t i, size_t j) {
+		auto itr = std::upper_bound(targets.begin(), targets.end(), offsets[i]);
+		return itr != targets.end() && *itr <= offsets[j];
+	};
+
+	std::vector<bool> removed(count, false);
+	size_t removedCount = 0;
+
+	auto remove = [&removed, &removedCount](size_t i) {
+		removed[i] = true;
+		removedCount++;
+	};
+
+	auto replace = [&instrs, &decoded](size_t i, uint32_t word) {
+		instrs[i] = CInstruction::Build_From_Binary(word);
+		decoded[i] = Decode(*instrs[i]);
+	};
+
+	// the rewrites may enable each other (e.g., a chain of constant operations), repeat until nothing changes
+	bool changed = true;
+	while (changed) {
+		changed = false;
+
+		for (size_t i = 0; i < count; i++) {
+
+			if (removed[i] || !decoded[i].valid) {
+				continue;
+			}
+
+			const auto a = decoded[i];
+
+			// addi rX, #0; mov rX, rX; ...
+			if (Is_No_Op(a)) {
+				remove(i);
+				changed = true;
+				continue;
+			}
+
+			size_t j = i + 1;
+			while (j < count && removed[j]) {
+				j++;
+			}
+			if (j >= count || !decoded[j].valid || decoded[j].condition != NCondition::always) {
+				continue;
+			}
+
+			const auto b = decoded[j];
+
+			// movi rX, #a; movi rX, #b - the first value is never used (regardless of where the control enters)
+			NRegister reg, nextReg;
+			if (Just_Sets(a, reg) && reg != NRegister::PC && Just_Sets(b, nextReg) && nextReg == reg) {
+				remove(i);
+				changed = true;
+				continue;
+			}
+
+			// the pairs below are merged, so the control must not enter at the second instruction
+			if (a.condition != NCondition::always || entered(i, j)) {
+				continue;
+			}
+
+			// movi rX, #a; addi rX, #b --> movi rX, #(a+b)
+			uint32_t value = 0;
+			if (a.opcode == NOpcode::movi && b.dst == a.dst && Fold(b.opcode, static_cast<uint32_t>(a.imm), b.imm, value) && Fits_Imm16(value)) {
+				replace(j, Encode_Immediate(NOpcode::movi, a.dst, static_cast<int32_t>(value)));
+				remove(i);
+				changed = true;
+				continue;
+			}
+
+			// push rX; pop rY --> mov rY, rX (nothing, if the registers are the same)
+			auto isStackSafe = [](NRegister r) { return r != NRegister::SP && r != NRegister::PC; };
+			if (a.opcode == NOpcode::push && b.opcode == NOpcode::pop && isStackSafe(a.src) && isStackSafe(b.src)) {
+				if (a.src == b.src) {
+					remove(j);
+				}
+				else {
+					replace(j, Encode_Registers(NOpcode::mov, b.src, a.src));
+				}
+				remove(i);
+				changed = true;
+				continue;
+			}
+		}
+	}
+
+	if (removedCount == 0) {
+		return 0;
+	}
+
+	// new offsets and indices of the instructions; removed ones map to the next kept one
+	std::vector<size_t> newOffsets(count + 1);
+	std::vector<uint32_t> newIndices(count + 1);
+	{
+		size_t offset = 0;
+		uint32_t index = 0;
+		for (size_t i = 0; i < count; i++) {
+			newOffsets[i] = offset;
+			newIndices[i] = index;
+			if (!removed[i]) {
+				offset += offsets[i + 1] - offsets[i];
+				index++;
+			}
+		}
+		newOffsets[count] = offset;
+		newIndices[count] = index;
+	}
+
+	auto mapOffset = [&offsets, &newOffsets](size_t offset) {
+		return newOffsets[std::lower_bound(offsets.begin(), offsets.end(), offset) - offsets.begin()];
+	};
+
+	// relative branches are retargeted to the new layout
+	for (size_t i = 0; i < count; i++) {
+		const auto& d = decoded[i];
+		if (removed[i] || !d.valid || d.opcode != NOpcode::bi || !d.relative) {
+			continue;
+		}
+
+		const size_t target = static_cast<size_t>(static_cast<int64_t>(offsets[i] + 4) + d.imm);
+		const int32_t imm = static_cast<int32_t>(mapOffset(target)) - static_cast<int32_t>(newOffsets[i] + 4);
+
+		auto word = instrs[i]->Generate_Binary();
+		word = (word & 0xFFFF) | (static_cast<uint32_t>(static_cast<uint16_t>(imm)) << 16);
+		instrs[i] = CInstruction::Build_From_Binary(word);
+	}
+
+	for (auto* offset : labelOffsets) {
+		*offset = mapOffset(*offset);
+	}
+	for (auto* index : requestIndices) {
+		*index = newIndices[*index];
+	}
+
+	size_t kept = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (!removed[i]) {
+			instrs[kept] = std::move(instrs[i]);
+			contents.sourceLocations[kept] = contents.sourceLocations[i];
+			kept++;
+		}
+	}
+	instrs.resize(kept);
+	contents.sourceLocations.resize(kept);
+	contents.offset = newOffsets[count];
+
+	return removedCount;
+}
+
+size_t CAssembler::Optimize() {
+
+	Log(NLog_Level::Basic, "Optimizing...");
+
+	// targets of absolute branches given by an immediate value (not by a label) must stay where they are
+	std::vector<uint32_t> absoluteTargets;
+	for (auto& contents : mSections) {
+		for (auto& instr : contents.instructions) {
+			const auto d = Decode(*instr);
+			if (d.valid && d.opcode == NOpcode::bi && !d.relative) {
+				absoluteTargets.push_back(static_cast<uint32_t>(d.imm));
+			}
+		}
+	}
+
+	// labels and resolve requests sorted to sections
+	std::vector<std::vector<size_t*>> labelOffsets(mSections.size());
+	for (auto& lr : mLabel_Refs) {
+		if (lr.defined) {
+			labelOffsets[lr.section].push_back(&lr.byteOffset);
+		}
+	}
+
+	std::vector<std::vector<uint32_t*>> requestIndices(mSections.size());
+	for (auto& rr : mResolve_Requests) {
+		requestIndices[rr.section].push_back(&rr.instructionIndex);
+	}
+
+	size_t removed = 0;
+
+	for (sarch32::TString_Id i = 0; i < mSections.size(); i++) {
+
+		auto& contents = mSections[i];
+		const auto* slink = Get_Section_Def(i);
+		if (contents.instructions.empty() || !slink) {
+			continue;
+		}
+
+		const bool pinned = std::any_of(absoluteTargets.begin(), absoluteTargets.end(), [slink, &contents](uint32_t target) {
+			return target >= slink->startAddr && target <= slink->startAddr + contents.offset;
+		});
+		if (pinned) {
+			Log(NLog_Level::Extended, "Section", mSection_Names.Get(i), "is a target of an absolute branch, not optimized");
+			continue;
+		}
+
+		const size_t sectionRemoved = Optimize_Section(contents, labelOffsets[i], requestIndices[i]);
+		Log(NLog_Level::Extended, "Removed", sectionRemoved, "instructions from section", mSection_Names.Get(i));
+
+		removed += sectionRemoved;
+	}
+
+	Log(NLog_Level::Basic, "Peephole optimization removed", removed, "instructions");
+
+	return removed;
+}
+
+bool CAssembler::Is_Position_Dependent(sarch32::TString_Id section) const {
+
+	const auto& contents = mSections[section];
+
+	// code reading PC or branching relatively by an immediate value or a register
+	for (auto& instr : contents.instructions) {
+		const auto d = Decode(*instr);
+		if (d.valid && (Mentions_PC(d) || ((d.opcode == NOpcode::bi || d.opcode == NOpcode::br) && d.relative))) {
+			return true;
+		}
+	}
+
+	const auto* slink = Get_Section_Def(section);
+	if (!slink) {
+		return false;
+	}
+
+	// absolute branches by an immediate value into the section
+	for (auto& other : mSections) {
+		for (auto& instr : other.instructions) {
+			const auto d = Decode(*instr);
+			if (d.valid && d.opcode == NOpcode::bi && !d.relative
+				&& static_cast<uint32_t>(d.imm) >= slink->startAddr && static_cast<uint32_t>(d.imm) < slink->startAddr + contents.offset) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
@@ -1,6 +1,22 @@
 #include "pseudoinstruction.h"
 
 #include <iostream>
+#include <sstream>
+#include <limits>
+#include <bit>
+
+namespace {
+
+	// does the value fit to 16bit immediate?
+	bool Fits_Imm16(int64_t value) {
+		return value >= std::numeric_limits<int16_t>::min() && value <= std::numeric_limits<int16_t>::max();
+	}
+
+	// does the value fit to 24bit immediate?
+	bool Fits_Imm24(int64_t value) {
+		return value >= -0x800000 && value <= 0x7FFFFF;
+	}
+}
 
 bool CPseudo_Instruction_Data::Parse_String(const std::string& mnemonic, const std::vector<std::string>& operands) {
 
@@ -137,3 +153,250 @@ void CPseudo_Instruction_Data::Resolve_Symbol(int32_t value) {
 		}
 	}
 }
+
+bool CPseudo_Instruction_Space::Parse_String(const std::string& mnemonic, const std::vector<std::string>& operands) {
+
+	if (operands.size() != 1) {
+		return false;
+	}
+
+	try {
+		// allow both hexadecimal and decimal format, with or without immediate prefix
+		const std::string op = operands[0].starts_with('#') ? operands[0].substr(1) : operands[0];
+		const auto size = std::stoul(op, nullptr, (op.starts_with("0x") || op.starts_with("0X")) ? 16 : 10);
+
+		if (size > 0xFFFFFFFFul) {
+			std::cerr << "Space size out of range: " << operands[0] << std::endl;
+			return false;
+		}
+
+		mSize = static_cast<uint32_t>(size);
+	}
+	catch (const std::exception& /*ex*/) {
+		std::cerr << "Could not parse space size: " << operands[0] << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+std::string CPseudo_Instruction_Space::Generate_String(bool hexaFmt) const {
+
+	std::ostringstream oss;
+	oss << ".space ";
+	if (hexaFmt) {
+		oss << "0x" << std::hex;
+	}
+	oss << mSize;
+
+	return oss.str();
+}
+
+bool CPseudo_Instruction_Branch::Reaches(NForm form) const {
+
+	switch (form) {
+		case NForm::Absolute:
+			return Fits_Imm16(mTarget);
+		case NForm::Relative:
+			// relative to the next instruction (PC is already incremented when the branch executes)
+			return Fits_Imm16(static_cast<int64_t>(mTarget) - (static_cast<int64_t>(mAddress) + 4));
+		case NForm::Long:
+			return Fits_Imm24(mTarget);
+	}
+
+	return false;
+}
+
+bool CPseudo_Instruction_Branch::Relax(int32_t address, int32_t target) {
+
+	mAddress = address;
+	mTarget = target;
+
+	const auto length = Get_Length();
+
+	while (mForm != NForm::Long && !Reaches(mForm)) {
+		mForm = static_cast<NForm>(static_cast<int>(mForm) + 1);
+	}
+
+	return Get_Length() != length;
+}
+
+std::vector<uint32_t> CPseudo_Instruction_Branch::Encode() const {
+
+	switch (mForm) {
+		case NForm::Absolute:
+			return { Encode_From_Byte_Half(Encode_MSB_Of(NOpcode::bi), Encode_Register_Pair(NRegister::ignored, NRegister::ignored), static_cast<int16_t>(mTarget)) };
+		case NForm::Relative:
+			// all bits of the register pair set mark the branch as relative
+			return { Encode_From_Byte_Half(Encode_MSB_Of(NOpcode::bi), 0xFF, static_cast<int16_t>(mTarget - (mAddress + 4))) };
+		case NForm::Long:
+			return {
+				Encode_From_Byte_Extended(Encode_MSB_Of(NOpcode::fw), mTarget),
+				Encode_From_Bytes({ Encode_MSB_Of(NOpcode::br), Encode_Register_Pair(NRegister::ignored, NRegister::R0), 0, 0 })
+			};
+	}
+
+	return {};
+}
+
+bool CPseudo_Instruction_Branch::Generate_Additional_Data(std::vector<uint8_t>& data) {
+
+	if (!Is_Reachable()) {
+		throw sarch32_generator_exception{ "Branch target out of range" };
+	}
+
+	for (const auto word : Encode()) {
+		Word_To_Bytes(word, data);
+	}
+
+	return true;
+}
+
+std::string CPseudo_Instruction_Branch::Generate_String(bool hexaFmt) const {
+
+	// the instructions the branch is encoded to
+	std::string generated;
+	for (const auto word : Encode()) {
+		if (!generated.empty()) {
+			generated += "; ";
+		}
+		generated += CInstruction::Build_From_Binary(word)->Generate_String(hexaFmt);
+	}
+
+	return generated;
+}
+
+bool CPseudo_Instruction_Load_Constant::Parse_String(const std::string& mnemonic, const std::vector<std::string>& operands) {
+
+	if (operands.size() != 2) {
+		return false;
+	}
+
+	const auto dst = Parse_Any(operands[0]);
+	const auto value = Parse_Any(operands[1]);
+	if (!dst.Is_Register() || !value.Is_Immediate()) {
+		return false;
+	}
+
+	mDst = dst.Get_Register();
+	mValue = value.Get_Immediate();
+
+	// fw always loads to r0
+	const bool toR0 = (mDst == NRegister::R0);
+
+	if (Fits_Imm16(mValue)) {
+		mForm = NForm::Move;
+	}
+	else if (toR0 && Fits_Imm24(mValue)) {
+		mForm = NForm::Forward;
+	}
+	else {
+		// strip trailing zero bits - the rest may fit to the immediate of movi or fw
+		mShift = std::countr_zero(static_cast<uint32_t>(mValue));
+		const int32_t shifted = mValue >> mShift;
+
+		if (Fits_Imm16(shifted) || (toR0 && Fits_Imm24(shifted))) {
+			mForm = NForm::Shift;
+		}
+		else {
+			mForm = mPool_Allowed ? NForm::Pool : NForm::Sequence;
+		}
+	}
+
+	return true;
+}
+
+uint32_t CPseudo_Instruction_Load_Constant::Get_Length() const {
+
+	switch (mForm) {
+		case NForm::Shift:
+			return 8;
+		case NForm::Sequence:
+			// the lower half has to be or'ed by bytes, if it would be sign-extended
+			return (static_cast<uint32_t>(mValue) & 0x8000) ? 20 : 12;
+		default:
+			return 4;
+	}
+}
+
+bool CPseudo_Instruction_Load_Constant::Relax(int32_t address, int32_t target) {
+
+	mLiteral_Address = target;
+
+	if (mForm == NForm::Pool && !Fits_Imm16(target)) {
+		mForm = NForm::Sequence;
+		return true;
+	}
+
+	return false;
+}
+
+std::vector<uint32_t> CPseudo_Instruction_Load_Constant::Encode() const {
+
+	const auto withImmediate = [this](NOpcode opcode, int32_t imm) {
+		return Encode_From_Byte_Half(Encode_MSB_Of(opcode), Encode_Register_Pair(mDst, NRegister::ignored), static_cast<int16_t>(imm));
+	};
+
+	switch (mForm) {
+		case NForm::Move:
+			return { withImmediate(NOpcode::movi, mValue) };
+		case NForm::Forward:
+			return { Encode_From_Byte_Extended(Encode_MSB_Of(NOpcode::fw), mValue) };
+		case NForm::Shift:
+		{
+			const int32_t shifted = mValue >> mShift;
+			return {
+				Fits_Imm16(shifted) ? withImmediate(NOpcode::movi, shifted) : Encode_From_Byte_Extended(Encode_MSB_Of(NOpcode::fw), shifted),
+				withImmediate(NOpcode::sli, mShift)
+			};
+		}
+		case NForm::Pool:
+			return { withImmediate(NOpcode::li, mLiteral_Address) };
+		case NForm::Sequence:
+		{
+			const int32_t upper = mValue >> 16;
+			const int32_t lower = static_cast<int32_t>(static_cast<uint32_t>(mValue) & 0xFFFF);
+
+			if (!(lower & 0x8000)) {
+				return { withImmediate(NOpcode::movi, upper), withImmediate(NOpcode::sli, 16), withImmediate(NOpcode::ori, lower) };
+			}
+
+			return {
+				withImmediate(NOpcode::movi, upper),
+				withImmediate(NOpcode::sli, 8),
+				withImmediate(NOpcode::ori, lower >> 8),
+				withImmediate(NOpcode::sli, 8),
+				withImmediate(NOpcode::ori, lower & 0xFF)
+			};
+		}
+	}
+
+	return {};
+}
+
+bool CPseudo_Instruction_Load_Constant::Generate_Additional_Data(std::vector<uint8_t>& data) {
+
+	if (mForm == NForm::Pool && !Fits_Imm16(mLiteral_Address)) {
+		throw sarch32_generator_exception{ "Immediate argument out of range" };
+	}
+
+	for (const auto word : Encode()) {
+		Word_To_Bytes(word, data);
+	}
+
+	return true;
+}
+
+std::string CPseudo_Instruction_Load_Constant::Generate_String(bool hexaFmt) const {
+
+	// the instructions the load is encoded to
+	std::string generated;
+	for (const auto word : Encode()) {
+		if (!generated.empty()) {
+			generated += "; ";
+		}
+		generated += CInstruction::Build_From_Binary(word)->Generate_String(hexaFmt);
+	}
+
+	return generated;
+}
@@ -67,6 +67,15 @@ class CPseudo_Instruction_Data : public CInstruction
 			return false;
 		}
 
+		virtual NRelocation_Kind Get_Relocation_Kind() const override {
+			if (mMnemonic == "db")
+				return NRelocation_Kind::Data8;
+			else if (mMnemonic == "dw")
+				return NRelocation_Kind::Data32;
+
+			return NRelocation_Kind::None;
+		}
+
 		virtual bool Is_Pseudo_Instruction() const override {
 			return true;
 		}
@@ -85,3 +94,237 @@ class CPseudo_Instruction_Data : public CInstruction
 			return static_cast<uint32_t>(mData.size());
 		}
 };
+
+/*
+ * Space pseudoinstruction - reserves given number of zero bytes; holds just the size
+ */
+class CPseudo_Instruction_Space : public CInstruction
+{
+	private:
+		// number of reserved bytes
+		uint32_t mSize = 0;
+
+	public:
+		using CInstruction::CInstruction;
+
+		virtual bool Parse_String(const std::string& mnemonic, const std::vector<std::string>& operands) override;
+
+		virtual bool Parse_Binary(const uint32_t instruction) override {
+			// this instruction is never parsed from binary
+			return true;
+		};
+
+		virtual std::string Generate_String(bool hexaFmt) const override;
+
+		virtual bool Is_Pseudo_Instruction() const override {
+			return true;
+		}
+
+		virtual bool Generate_Additional_Data(std::vector<uint8_t>& data) override {
+			// materialize zeroes - this is used only if the space is a part of a section with other contents
+			data.resize(data.size() + mSize, 0);
+			return mSize > 0;
+		}
+
+		virtual uint32_t Get_Length() const override {
+			return mSize;
+		}
+};
+
+/*
+ * Pseudoinstruction the encoding of which depends on the final layout (see CAssembler::Relax_Layout)
+ */
+class CRelaxable_Instruction : public CInstruction
+{
+	protected:
+		// encodes the most significant byte of an instruction with given opcode, using the condition of this one
+		uint8_t Encode_MSB_Of(NOpcode opcode) const {
+			return (static_cast<uint8_t>(mCondition) << 5) | (static_cast<uint8_t>(opcode));
+		}
+
+	public:
+		using CInstruction::CInstruction;
+
+		// places the instruction to given address with given value of the symbol it refers to and picks the first form that
+		// fits; the form never goes back to a preceding one, so the layout converges; returns true if the length changed
+		virtual bool Relax(int32_t address, int32_t target) = 0;
+
+		// does the chosen form fit the symbol value?
+		virtual bool Is_Reachable() const = 0;
+};
+
+/*
+ * Branch to a label - encoded in the shortest form that reaches the label once the layout is known
+ *
+ * The forms are tried in order: absolute branch (bi, 16bit address), relative branch (bir, 16bit offset to the next
+ * instruction) and a long branch (fw with 24bit address to r0, then br r0) - the long form is 8 bytes long and clobbers
+ * r0 when taken; both of its instructions keep the branch condition
+ */
+class CPseudo_Instruction_Branch : public CRelaxable_Instruction
+{
+	public:
+		// branch forms, in the order they are tried
+		enum class NForm {
+			Absolute,
+			Relative,
+			Long,
+		};
+
+	private:
+		// the label the branch targets
+		std::string mSymbol;
+		// chosen form
+		NForm mForm = NForm::Absolute;
+		// address of the branch itself and of the branch target
+		int32_t mAddress = 0;
+		int32_t mTarget = 0;
+
+		// does the form reach the current target from the current address?
+		bool Reaches(NForm form) const;
+		// encodes the branch in the chosen form (one or two instruction words)
+		std::vector<uint32_t> Encode() const;
+
+	public:
+		CPseudo_Instruction_Branch(NCondition cond, const std::string& symbol)
+			: CRelaxable_Instruction(NOpcode::bi, cond), mSymbol(symbol) {
+			//
+		}
+
+		virtual bool Parse_Binary(const uint32_t instruction) override {
+			// this instruction is never parsed from binary
+			return true;
+		};
+
+		virtual std::string Generate_String(bool hexaFmt) const override;
+
+		virtual void Resolve_Symbol(int32_t value) override {
+			mTarget = value;
+		}
+
+		virtual bool Get_Resolve_Request(std::string& str) const override {
+			str = mSymbol;
+			return true;
+		}
+
+		virtual bool Is_Pseudo_Instruction() const override {
+			return true;
+		}
+
+		virtual bool Generate_Additional_Data(std::vector<uint8_t>& data) override;
+
+		virtual uint32_t Get_Length() const override {
+			return (mForm == NForm::Long) ? 8 : 4;
+		}
+
+		virtual bool Relax(int32_t address, int32_t target) override;
+
+		// does the chosen form reach the target? (i.e., the target is not beyond the reach of the long form)
+		virtual bool Is_Reachable() const override {
+			return Reaches(mForm);
+		}
+
+		// retrieves chosen form
+		NForm Get_Form() const {
+			return mForm;
+		}
+};
+
+/*
+ * Load constant pseudoinstruction (ldc rX, #imm32) - encoded in the cheapest form that loads the value
+ *
+ * The forms are tried in order: movi (16bit values), fw (24bit values to r0), movi or fw followed by sli (shifted 16bit or
+ * 24bit values) and a load of the literal pool entry of the section (li, the pool is placed at the end of the section);
+ * the value is built by a sequence of movi, sli and ori instead, if the pool entry is out of reach of li (16bit address)
+ * or if there are no literal pools
+ */
+class CPseudo_Instruction_Load_Constant : public CRelaxable_Instruction
+{
+	public:
+		// load forms, in the order they are tried
+		enum class NForm {
+			Move,
+			Forward,
+			Shift,
+			Pool,
+			Sequence,
+		};
+
+	private:
+		// target register
+		NRegister mDst = NRegister::R0;
+		// loaded value
+		int32_t mValue = 0;
+		// chosen form
+		NForm mForm = NForm::Move;
+		// shift of the value loaded by the shift form
+		int32_t mShift = 0;
+		// the value may be placed to a literal pool
+		bool mPool_Allowed = true;
+		// label and address of the literal pool entry (pool form)
+		std::string mLiteral_Symbol;
+		int32_t mLiteral_Address = 0;
+
+		// encodes the load in the chosen form
+		std::vector<uint32_t> Encode() const;
+
+	public:
+		CPseudo_Instruction_Load_Constant(bool poolAllowed)
+			: mPool_Allowed(poolAllowed) {
+			//
+		}
+
+		virtual bool Parse_String(const std::string& mnemonic, const std::vector<std::string>& operands) override;
+
+		virtual bool Parse_Binary(const uint32_t instruction) override {
+			// this instruction is never parsed from binary
+			return true;
+		};
+
+		virtual std::string Generate_String(bool hexaFmt) const override;
+
+		virtual void Resolve_Symbol(int32_t value) override {
+			mLiteral_Address = value;
+		}
+
+		virtual bool Get_Resolve_Request(std::string& str) const override {
+			if (mForm == NForm::Pool && !mLiteral_Symbol.empty()) {
+				str = mLiteral_Symbol;
+				return true;
+			}
+			return false;
+		}
+
+		virtual NRelocation_Kind Get_Relocation_Kind() const override {
+			return (mForm == NForm::Pool) ? NRelocation_Kind::Imm16 : NRelocation_Kind::None;
+		}
+
+		virtual bool Is_Pseudo_Instruction() const override {
+			return true;
+		}
+
+		virtual bool Generate_Additional_Data(std::vector<uint8_t>& data) override;
+
+		virtual uint32_t Get_Length() const override;
+
+		virtual bool Relax(int32_t address, int32_t target) override;
+
+		virtual bool Is_Reachable() const override {
+			// the sequence loads any value
+			return true;
+		}
+
+		// sets the label of the literal pool entry holding the value
+		void Set_Literal_Symbol(const std::string& symbol) {
+			mLiteral_Symbol = symbol;
+		}
+
+		// retrieves chosen form
+		NForm Get_Form() const {
+			return mForm;
+		}
+
+		// retrieves loaded value
+		int32_t Get_Value() const {
+			return mValue;
+		}
+};
@@ -0,0 +1,230 @@
+#include "assembler.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <iomanip>
+
+size_t CAssembler::Place_Literal_Pools(std::vector<TSection_Contents>& sections, const sarch32::CString_Pool& sectionNames, sarch32::CString_Pool& symbolNames,
+	std::vector<TLabel_Ref>& labelRefs, std::vector<TResolve_Request>& resolveRequests) {
+
+	size_t entries = 0;
+
+	for (sarch32::TString_Id i = 0; i < sections.size(); i++) {
+
+		auto& contents = sections[i];
+
+		// distinct values in the order of the first use, with the source location of the first use
+		std::unordered_map<int32_t, sarch32::TString_Id> literals;
+		std::vector<std::pair<sarch32::TString_Id, int32_t>> pool;
+		std::vector<TSource_Location> locations;
+
+		for (size_t j = 0; j < contents.instructions.size(); j++) {
+
+			auto* ldc = dynamic_cast<CPseudo_Instruction_Load_Constant*>(contents.instructions[j].get());
+			if (!ldc || ldc->Get_Form() != CPseudo_Instruction_Load_Constant::NForm::Pool) {
+				continue;
+			}
+
+			// the label cannot clash with user labels, as those never contain a dot
+			std::ostringstream name;
+			name << ".lit." << sectionNames.Get(i) << ".0x" << std::hex << std::setw(8) << std::setfill('0') << static_cast<uint32_t>(ldc->Get_Value());
+
+			auto itr = literals.find(ldc->Get_Value());
+			if (itr == literals.end()) {
+				itr = literals.insert({ ldc->Get_Value(), symbolNames.Intern(name.str()) }).first;
+				pool.push_back({ itr->second, ldc->Get_Value() });
+				locations.push_back(contents.sourceLocations[j]);
+			}
+
+			ldc->Set_Literal_Symbol(name.str());
+			resolveRequests.push_back({ itr->second, i, static_cast<uint32_t>(j) });
+		}
+
+		if (pool.empty()) {
+			continue;
+		}
+
+		labelRefs.resize(symbolNames.Size());
+
+		// pool entries are word-aligned (the contents may end with bytes or strings)
+		if (const size_t misalignment = contents.offset % 4; misalignment != 0) {
+			auto padding = std::make_unique<CPseudo_Instruction_Space>();
+			padding->Parse_String("space", { std::to_string(4 - misalignment) });
+
+			contents.offset += padding->Get_Length();
+			contents.instructions.push_back(std::move(padding));
+			contents.sourceLocations.push_back(locations.front());
+		}
+
+		for (size_t j = 0; j < pool.size(); j++) {
+			std::ostringstream value;
+			value << "#0x" << std::hex << static_cast<uint32_t>(pool[j].second);
+
+			auto entry = std::make_unique<CPseudo_Instruction_Data>();
+			entry->Parse_String("dw", { value.str() });
+
+			labelRefs[pool[j].first] = { i, contents.offset, true };
+
+			contents.offset += entry->Get_Length();
+			contents.instructions.push_back(std::move(entry));
+			contents.sourceLocations.push_back(locations[j]);
+		}
+
+		entries += pool.size();
+	}
+
+	return entries;
+}
+
+bool CAssembler::Relax_Layout() {
+
+	Log(NLog_Level::Basic, "Relaxing layout...");
+
+	// relaxable instruction and the label it refers to
+	struct TRelaxable {
+		sarch32::TString_Id section;
+		uint32_t instructionIndex;
+		sarch32::TString_Id symbol;
+		CRelaxable_Instruction* instr;
+	};
+
+	// 1) replace absolute and relative branches to labels with relaxable ones, collect constant loads from literal pools;
+	//    instructions the address of which is not known (section or label not placed by the linker file, undefined label)
+	//    are left to the symbol resolution to report
+	std::vector<TRelaxable> relaxables;
+	std::vector<bool> affected(mSections.size(), false);
+
+	for (auto& rr : mResolve_Requests) {
+
+		auto& instr = mSections[rr.section].instructions[rr.instructionIndex];
+
+		const auto& sym = mLabel_Refs[rr.symbol];
+		if (!Get_Section_Def(rr.section) || !sym.defined || !Get_Section_Def(sym.section)) {
+			continue;
+		}
+
+		if (instr->Get_Opcode() == NOpcode::bi && !instr->Is_Pseudo_Instruction()) {
+			instr = std::make_unique<CPseudo_Instruction_Branch>(instr->Get_Condition(), mSymbol_Names.Get(rr.symbol));
+		}
+
+		auto* relaxable = dynamic_cast<CRelaxable_Instruction*>(instr.get());
+		if (!relaxable) {
+			continue;
+		}
+
+		relaxables.push_back({ rr.section, rr.instructionIndex, rr.symbol, relaxable });
+		affected[rr.section] = true;
+	}
+
+	if (relaxables.empty()) {
+		return true;
+	}
+
+	// 2) labels in sections with relaxable instructions are tied to instructions (the one the label precedes), as their
+	//    offsets move when an instruction grows
+	auto instructionStarts = [this](sarch32::TString_Id section) {
+		std::vector<size_t> starts;
+		starts.reserve(mSections[section].instructions.size() + 1);
+
+		size_t offset = 0;
+		for (auto& instr : mSections[section].instructions) {
+			starts.push_back(offset);
+			offset += instr->Get_Length();
+		}
+		starts.push_back(offset);
+		return starts;
+	};
+
+	std::vector<std::pair<TLabel_Ref*, size_t>> labelIndices;
+	{
+		std::vector<std::vector<size_t>> starts(mSections.size());
+		for (sarch32::TString_Id i = 0; i < mSections.size(); i++) {
+			if (affected[i]) {
+				starts[i] = instructionStarts(i);
+			}
+		}
+
+		for (auto& lr : mLabel_Refs) {
+			if (lr.defined && lr.section < affected.size() && affected[lr.section]) {
+				const auto& s = starts[lr.section];
+				labelIndices.push_back({ &lr, static_cast<size_t>(std::lower_bound(s.begin(), s.end(), lr.byteOffset) - s.begin()) });
+			}
+		}
+	}
+
+	// instructions growing in a position dependent section would move the code following them (relative branches and PC
+	// reads by immediate value would not be adjusted)
+	std::vector<bool> positionDependent(mSections.size(), false);
+	for (sarch32::TString_Id i = 0; i < mSections.size(); i++) {
+		if (affected[i]) {
+			positionDependent[i] = Is_Position_Dependent(i);
+		}
+	}
+
+	// 3) place the instructions until no instruction changes its length - instructions only grow, so this converges
+	size_t passes = 0;
+	bool changed = true;
+
+	while (changed) {
+
+		changed = false;
+		passes++;
+
+		std::vector<std::vector<size_t>> starts(mSections.size());
+		for (sarch32::TString_Id i = 0; i < mSections.size(); i++) {
+			if (affected[i]) {
+				starts[i] = instructionStarts(i);
+				mSections[i].offset = starts[i].back();
+			}
+		}
+
+		for (auto& li : labelIndices) {
+			li.first->byteOffset = starts[li.first->section][li.second];
+		}
+
+		for (auto& r : relaxables) {
+
+			int32_t target = 0;
+			std::string error;
+			Resolve_Address(r.symbol, target, error);
+
+			const auto address = static_cast<int32_t>(Get_Section_Def(r.section)->startAddr + starts[r.section][r.instructionIndex]);
+			if (r.instr->Relax(address, target)) {
+				if (positionDependent[r.section]) {
+					const char* what = dynamic_cast<CPseudo_Instruction_Branch*>(r.instr) ? "branch to" : "constant load from";
+					std::cerr << "Cannot grow a " << what << " " << mSymbol_Names.Get(r.symbol) << " in position dependent section "
+						<< mSection_Names.Get(r.section) << ", the code following it would move" << std::endl;
+					return false;
+				}
+				changed = true;
+			}
+		}
+	}
+
+	size_t relative = 0, longBranches = 0, sequences = 0;
+	for (auto& r : relaxables) {
+		if (!r.instr->Is_Reachable()) {
+			std::cerr << "Branch target out of range of a long branch: " << mSymbol_Names.Get(r.symbol) << std::endl;
+			return false;
+		}
+
+		if (auto* branch = dynamic_cast<CPseudo_Instruction_Branch*>(r.instr)) {
+			if (branch->Get_Form() == CPseudo_Instruction_Branch::NForm::Relative) {
+				relative++;
+			}
+			else if (branch->Get_Form() == CPseudo_Instruction_Branch::NForm::Long) {
+				longBranches++;
+			}
+		}
+		else if (auto* ldc = dynamic_cast<CPseudo_Instruction_Load_Constant*>(r.instr)) {
+			if (ldc->Get_Form() == CPseudo_Instruction_Load_Constant::NForm::Sequence) {
+				sequences++;
+			}
+		}
+	}
+
+	Log(NLog_Level::Extended, "Relaxed", relaxables.size(), "instructions in", passes, "passes:", relative, "relative and", longBranches, "long branches,",
+		sequences, "constant loads out of reach of the literal pool");
+
+	return true;
+}
@@ -0,0 +1,86 @@
+#include "coverage.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+namespace sarch32 {
+
+	CCoverage_Map::CCoverage_Map(uint32_t memSize) : mBlocks((static_cast<size_t>(memSize) / 4 + 7) / 8) {
+		//
+	}
+
+	void CCoverage_Map::Clear() {
+		std::fill(mEdges.begin(), mEdges.end(), 0);
+		std::fill(mBlocks.begin(), mBlocks.end(), 0);
+		mPrev_Location = 0;
+	}
+
+	bool CCoverage_Map::Is_Block_Covered(uint32_t address) const {
+		const uint32_t word = address >> 2;
+		if ((word >> 3) >= mBlocks.size()) {
+			return false;
+		}
+
+		return (mBlocks[word >> 3] >> (word & 0b111)) & 0x1;
+	}
+
+	size_t CCoverage_Map::Get_Edge_Count() const {
+		return static_cast<size_t>(std::count_if(mEdges.begin(), mEdges.end(), [](uint8_t e) { return e != 0; }));
+	}
+
+	void CCoverage_Map::Dump(std::ostream& os, const std::vector<TLoaded_Section>& sections, const CSymbol_Index* symbols) const {
+
+		os << "; SArch32 coverage map" << std::endl;
+		os << "; " << Get_Edge_Count() << " of " << Coverage_Map_Size << " edge map entries hit" << std::endl;
+
+		for (const auto& s : sections) {
+
+			// collect covered block entries within this section
+			std::vector<uint32_t> covered;
+			for (uint32_t offset = 0; offset < s.size; offset += 4) {
+				if (Is_Block_Covered(s.startAddr + offset)) {
+					covered.push_back(offset);
+				}
+			}
+
+			os << "section " << s.name << " 0x" << std::hex << std::setw(8) << std::setfill('0') << s.startAddr
+				<< " size " << std::dec << s.size << " blocks " << covered.size() << std::endl;
+
+			for (auto offset : covered) {
+				os << "block " << s.name << "+0x" << std::hex << std::setw(4) << std::setfill('0') << offset
+					<< " 0x" << std::setw(8) << (s.startAddr + offset) << std::dec;
+
+				// symbolic location, if known
+				if (symbols) {
+					const auto sym = symbols->Format_Symbol(s.startAddr + offset);
+					const auto line = symbols->Format_Line(s.startAddr + offset);
+					if (!sym.empty() || !line.empty()) {
+						os << " ;";
+					}
+					if (!sym.empty()) {
+						os << " " << sym;
+					}
+					if (!line.empty()) {
+						os << " " << line;
+					}
+				}
+
+				os << std::endl;
+			}
+		}
+	}
+
+	bool CCoverage_Map::Save_Edge_Map(const std::string& path) const {
+
+		std::ofstream ofs(path, std::ios::out | std::ios::binary);
+		if (!ofs.is_open()) {
+			return false;
+		}
+
+		ofs.write(reinterpret_cast<const char*>(mEdges.data()), mEdges.size());
+
+		return true;
+	}
+
+}
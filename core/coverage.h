@@ -0,0 +1,88 @@
+#pragma once
+
+#include "hooks.h"
+#include "symbols.h"
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <string>
+#include <ostream>
+
+namespace sarch32 {
+
+	// size of the edge coverage map - compatible with AFL-style fuzzers
+	constexpr size_t Coverage_Map_Size = 64 * 1024;
+
+	// loaded section record - used to express coverage relative to sections placed by linker file
+	struct TLoaded_Section {
+		std::string name;
+		uint32_t startAddr;
+		uint32_t size;
+		// hash of the stored section payload (used to detect changed sections when the image is reloaded)
+		uint64_t contentHash = 0;
+	};
+
+	/*
+	 * Basic-block coverage map
+	 *
+	 * Contains an AFL-style edge hit map (hashed pairs of previous and current block) and a bitmap
+	 * of block entry addresses (1 bit per instruction word of main memory)
+	 *
+	 * Attached to the machine as a plugin - the run loop reports block entries just at taken branches, traps and IRQs,
+	 * so the straight-line code does not pay for the recording
+	 */
+	class CCoverage_Map : public IMachine_Plugin {
+
+		private:
+			// edge hit counters (wrapping)
+			std::array<uint8_t, Coverage_Map_Size> mEdges{};
+			// bitmap of executed block entry addresses
+			std::vector<uint8_t> mBlocks;
+			// hashed location of the previous block, shifted right by one (to distinguish A->B from B->A)
+			uint32_t mPrev_Location = 0;
+
+		public:
+			CCoverage_Map(uint32_t memSize);
+
+			// records an entry into a block starting at given address
+			inline void Record_Block(uint32_t address) {
+				const uint32_t cur = ((address >> 2) * 0x9E3779B1u) >> 16;
+
+				mEdges[(cur ^ mPrev_Location) & (Coverage_Map_Size - 1)]++;
+				mPrev_Location = cur >> 1;
+
+				const uint32_t word = address >> 2;
+				if ((word >> 3) < mBlocks.size()) {
+					mBlocks[word >> 3] |= static_cast<uint8_t>(1 << (word & 0b111));
+				}
+			}
+
+			uint32_t Get_Hook_Kinds() const override {
+				return static_cast<uint32_t>(NHook_Kind::Block_Enter);
+			}
+
+			void On_Block_Enter(uint32_t address) override {
+				Record_Block(address);
+			}
+
+			// clears all coverage data
+			void Clear();
+
+			// was the block at given address entered?
+			bool Is_Block_Covered(uint32_t address) const;
+			// retrieves the number of non-zero edge map entries
+			size_t Get_Edge_Count() const;
+
+			// retrieves raw edge map (e.g., for fuzzer feedback)
+			const std::array<uint8_t, Coverage_Map_Size>& Get_Edge_Map() const {
+				return mEdges;
+			}
+
+			// dumps covered blocks relative to given sections in a textual form; blocks are annotated by symbols and lines, if available
+			void Dump(std::ostream& os, const std::vector<TLoaded_Section>& sections, const CSymbol_Index* symbols = nullptr) const;
+			// saves the raw edge map to a file
+			bool Save_Edge_Map(const std::string& path) const;
+	};
+
+}
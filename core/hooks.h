@@ -0,0 +1,189 @@
+#pragma once
+
+#include "isa.h"
+
+#include <vector>
+
+namespace sarch32 {
+
+	/*
+	 * Kinds of per-instruction callbacks a plugin may need
+	 *
+	 * The run loop is instantiated just for the kinds needed by the attached plugins, so e.g. guest memory
+	 * accesses are routed through the hooked bus only if some plugin wants to see them; traps and IRQs
+	 * are rare and they are always reported
+	 */
+	enum class NHook_Kind : uint32_t {
+		Instruction_Retire	= 1 << 0,	// On_Instruction_Retire
+		Memory_Access		= 1 << 1,	// On_Memory_Read, On_Memory_Write
+		Block_Enter			= 1 << 2,	// On_Block_Enter
+	};
+
+	// number of distinct combinations of hook kinds
+	constexpr uint32_t Hook_Kind_Combinations = 1 << 3;
+
+	/*
+	 * Machine plugin interface
+	 *
+	 * Instrumentation (profilers, tracers, watchpoints, coverage, ...) is attached to the machine as a plugin
+	 * instead of being hard-wired into the run loop. Every callback has an empty default implementation,
+	 * so the plugin overrides just what it needs - and declares it by Get_Hook_Kinds
+	 */
+	class IMachine_Plugin {
+
+		public:
+			virtual ~IMachine_Plugin() = default;
+
+			// retrieves the kinds of per-instruction callbacks the plugin overrides (NHook_Kind flags); read when the plugin is attached
+			virtual uint32_t Get_Hook_Kinds() const = 0;
+
+			// instruction at given address was executed and retired
+			virtual void On_Instruction_Retire(const CCPU_Context& ctx, uint32_t pc, const CInstruction& instr) { };
+			// guest read from memory bus (instruction fetches are not reported)
+			virtual void On_Memory_Read(uint32_t address, const void* data, uint32_t size) { };
+			// guest write to memory bus; called before the write is performed
+			virtual void On_Memory_Write(uint32_t address, const void* data, uint32_t size) { };
+			// execution continues at given address by a taken branch, a trap, an IRQ or a reset - not by the sequential execution
+			virtual void On_Block_Enter(uint32_t address) { };
+			// CPU is about to enter trap handler of given type; RA register already holds the return address
+			virtual void On_Trap(const CCPU_Context& ctx, NIVT_Entry entry) { };
+			// CPU is about to enter IRQ handler; RA register already holds the return address
+			virtual void On_IRQ(const CCPU_Context& ctx) { };
+	};
+
+	/*
+	 * Attached plugins, sorted by the callbacks they need
+	 */
+	struct TAttached_Plugins {
+		// all plugins (traps and IRQs)
+		std::vector<IMachine_Plugin*> all;
+		// plugins with the respective kind of hooks
+		std::vector<IMachine_Plugin*> retire;
+		std::vector<IMachine_Plugin*> memory;
+		std::vector<IMachine_Plugin*> block;
+		// union of the hook kinds of all plugins
+		uint32_t kinds = 0;
+	};
+
+	/*
+	 * Hook policies for the machine run loop
+	 *
+	 * The run loop is a template parametrized by the policy, so the loop without any hooks compiles
+	 * to the same code as if there were no hook calls at all
+	 */
+
+	// no hooks - every call is an empty inline function
+	struct CNo_Hooks {
+		static constexpr bool Has_Memory_Hooks = false;
+		static constexpr bool Has_Block_Hooks = false;
+
+		CNo_Hooks(const TAttached_Plugins&) {
+			//
+		}
+
+		inline void On_Instruction_Retire(const CCPU_Context&, uint32_t, const CInstruction&) { }
+		inline void On_Memory_Read(uint32_t, const void*, uint32_t) { }
+		inline void On_Memory_Write(uint32_t, const void*, uint32_t) { }
+		inline void On_Block_Enter(uint32_t) { }
+		inline void On_Trap(const CCPU_Context&, NIVT_Entry) { }
+		inline void On_IRQ(const CCPU_Context&) { }
+	};
+
+	// dispatches hooks of given kinds (NHook_Kind flags) to the plugins that need them; the other ones are empty inline functions
+	template<uint32_t Kinds>
+	class CPlugin_Hooks {
+
+		private:
+			const TAttached_Plugins& mPlugins;
+
+		public:
+			static constexpr bool Has_Retire_Hooks = (Kinds & static_cast<uint32_t>(NHook_Kind::Instruction_Retire)) != 0;
+			static constexpr bool Has_Memory_Hooks = (Kinds & static_cast<uint32_t>(NHook_Kind::Memory_Access)) != 0;
+			static constexpr bool Has_Block_Hooks = (Kinds & static_cast<uint32_t>(NHook_Kind::Block_Enter)) != 0;
+
+			CPlugin_Hooks(const TAttached_Plugins& plugins) : mPlugins(plugins) {
+				//
+			}
+
+			inline void On_Instruction_Retire(const CCPU_Context& ctx, uint32_t pc, const CInstruction& instr) {
+				if constexpr (Has_Retire_Hooks) {
+					for (auto p : mPlugins.retire) {
+						p->On_Instruction_Retire(ctx, pc, instr);
+					}
+				}
+			}
+
+			inline void On_Memory_Read(uint32_t address, const void* data, uint32_t size) {
+				if constexpr (Has_Memory_Hooks) {
+					for (auto p : mPlugins.memory) {
+						p->On_Memory_Read(address, data, size);
+					}
+				}
+			}
+
+			inline void On_Memory_Write(uint32_t address, const void* data, uint32_t size) {
+				if constexpr (Has_Memory_Hooks) {
+					for (auto p : mPlugins.memory) {
+						p->On_Memory_Write(address, data, size);
+					}
+				}
+			}
+
+			inline void On_Block_Enter(uint32_t address) {
+				if constexpr (Has_Block_Hooks) {
+					for (auto p : mPlugins.block) {
+						p->On_Block_Enter(address);
+					}
+				}
+			}
+
+			inline void On_Trap(const CCPU_Context& ctx, NIVT_Entry entry) {
+				for (auto p : mPlugins.all) {
+					p->On_Trap(ctx, entry);
+				}
+			}
+
+			inline void On_IRQ(const CCPU_Context& ctx) {
+				for (auto p : mPlugins.all) {
+					p->On_IRQ(ctx);
+				}
+			}
+	};
+
+	/*
+	 * Memory bus proxy, that reports guest memory accesses to hooks
+	 *
+	 * The CPU context is switched to this bus only while a run loop with memory hooks is executing
+	 */
+	template<typename THooks>
+	class CHooked_Bus : public IBus {
+
+		private:
+			IBus& mBus;
+			THooks& mHooks;
+
+		public:
+			CHooked_Bus(IBus& bus, THooks& hooks) : mBus(bus), mHooks(hooks) {
+				//
+			}
+
+			void Read(uint32_t address, void* target, uint32_t size) const override {
+				mBus.Read(address, target, size);
+				mHooks.On_Memory_Read(address, target, size);
+			}
+
+			void Write(uint32_t address, const void* source, uint32_t size) override {
+				mHooks.On_Memory_Write(address, source, size);
+				mBus.Write(address, source, size);
+			}
+
+			bool Map_Peripheral(std::shared_ptr<IPeripheral> peripheral, uint32_t address, uint32_t length) override {
+				return mBus.Map_Peripheral(peripheral, address, length);
+			}
+
+			bool Unmap_Peripheral(std::shared_ptr<IPeripheral> peripheral, uint32_t address, uint32_t length) override {
+				return mBus.Unmap_Peripheral(peripheral, address, length);
+			}
+	};
+
+}
@@ -0,0 +1,380 @@
+#include "host_memory.h"
+#include "isa.h"
+
+#include <new>
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <csignal>
+#include <atomic>
+#include <mutex>
+#endif
+
+namespace sarch32 {
+
+	CHost_Memory::CHost_Memory(size_t size, bool guarded) : mSize(size), mReserved(size), mGuarded(guarded) {
+		Allocate();
+	}
+
+	CHost_Memory::~CHost_Memory() {
+		Release();
+	}
+
+#ifdef _WIN32
+
+	void CHost_Memory::Allocate() {
+
+		// guarded mode is not supported here (yet)
+		mGuarded = false;
+
+		if (mSize == 0) {
+			return;
+		}
+
+		// committed pages are backed by the pagefile, physical pages are assigned on first touch
+		mData = static_cast<uint8_t*>(VirtualAlloc(nullptr, mSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+		if (!mData) {
+			throw std::bad_alloc{};
+		}
+	}
+
+	void CHost_Memory::Release() {
+		if (mData) {
+			VirtualFree(mData, 0, MEM_RELEASE);
+			mData = nullptr;
+		}
+	}
+
+	void CHost_Memory::Clear() {
+		if (!mData) {
+			return;
+		}
+
+		// decommit and commit again - the pages are zeroed on the next touch
+		VirtualFree(mData, mSize, MEM_DECOMMIT);
+		if (!VirtualAlloc(mData, mSize, MEM_COMMIT, PAGE_READWRITE)) {
+			throw std::bad_alloc{};
+		}
+	}
+
+	void CHost_Memory::Clear_Range(size_t offset, size_t length) {
+		if (mData && offset < mSize) {
+			std::memset(mData + offset, 0, std::min(length, mSize - offset));
+		}
+	}
+
+	size_t CHost_Memory::Map_File(size_t offset, int fd, uint64_t fileOffset, size_t length) {
+		// not supported here, the caller copies the data
+		return 0;
+	}
+
+	bool CHost_Memory::Share(int fd, uint64_t fileOffset) {
+		// not supported here
+		return false;
+	}
+
+	bool CHost_Memory::Punch_Shared(size_t offset, size_t length) {
+		return false;
+	}
+
+#else
+
+	namespace {
+
+		// size of the guest address space covered by a guarded reservation
+		constexpr uint64_t Guest_Address_Space_Size = 1ull << 32;
+
+		// maximum number of guarded reservations existing at the same time
+		constexpr size_t Max_Guarded_Ranges = 64;
+
+		// guarded host address range; the fault handler reads it without locking
+		struct TGuarded_Range {
+			std::atomic<uintptr_t> start{ 0 };
+			std::atomic<uintptr_t> end{ 0 };
+		};
+
+		TGuarded_Range gGuarded_Ranges[Max_Guarded_Ranges];
+		std::mutex gGuarded_Ranges_Mtx;
+
+		struct sigaction gPrev_Segv_Action{};
+		struct sigaction gPrev_Bus_Action{};
+
+		void Guard_Fault_Handler(int sig, siginfo_t* info, void* uctx) {
+
+			const uintptr_t addr = reinterpret_cast<uintptr_t>(info->si_addr);
+
+			for (auto& r : gGuarded_Ranges) {
+				const uintptr_t start = r.start.load(std::memory_order_acquire);
+				if (start != 0 && addr >= start && addr < r.end.load(std::memory_order_acquire)) {
+					// the fault is synchronous and comes from an inline guest memory access of the memory bus (never from a libc
+					// call), which is built with -fnon-call-exceptions - so the exception may be unwound through the signal frame
+					throw abort_exception{ static_cast<uint32_t>(addr - start) };
+				}
+			}
+
+			// not our fault - pass it to the previous handler
+			const struct sigaction& prev = (sig == SIGBUS) ? gPrev_Bus_Action : gPrev_Segv_Action;
+			if ((prev.sa_flags & SA_SIGINFO) && prev.sa_sigaction) {
+				prev.sa_sigaction(sig, info, uctx);
+			}
+			else if (prev.sa_handler != SIG_DFL && prev.sa_handler != SIG_IGN) {
+				prev.sa_handler(sig);
+			}
+			else {
+				// restore the default action, the faulting instruction is executed again and terminates the process
+				signal(sig, SIG_DFL);
+			}
+		}
+
+		void Install_Guard_Fault_Handler() {
+
+			static std::once_flag installed;
+
+			std::call_once(installed, []() {
+				struct sigaction sa{};
+				sa.sa_sigaction = &Guard_Fault_Handler;
+				// the handler does not return when it throws, so the signal must not stay blocked
+				sa.sa_flags = SA_SIGINFO | SA_NODEFER;
+				sigemptyset(&sa.sa_mask);
+
+				sigaction(SIGSEGV, &sa, &gPrev_Segv_Action);
+				sigaction(SIGBUS, &sa, &gPrev_Bus_Action);
+			});
+		}
+
+		bool Register_Guarded_Range(uintptr_t start, uintptr_t end) {
+
+			std::unique_lock<std::mutex> lck(gGuarded_Ranges_Mtx);
+
+			for (auto& r : gGuarded_Ranges) {
+				if (r.start.load(std::memory_order_relaxed) == 0) {
+					r.end.store(end, std::memory_order_release);
+					r.start.store(start, std::memory_order_release);
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		void Unregister_Guarded_Range(uintptr_t start) {
+
+			std::unique_lock<std::mutex> lck(gGuarded_Ranges_Mtx);
+
+			for (auto& r : gGuarded_Ranges) {
+				if (r.start.load(std::memory_order_relaxed) == start) {
+					r.start.store(0, std::memory_order_release);
+					r.end.store(0, std::memory_order_release);
+				}
+			}
+		}
+	}
+
+	void CHost_Memory::Allocate() {
+
+		const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+		// guarded mode needs 64-bit host address space and a block ending on a page boundary
+		if (mGuarded && (sizeof(void*) < 8 || mSize == 0 || mSize % pageSize != 0 || mSize > Guest_Address_Space_Size)) {
+			mGuarded = false;
+		}
+
+		mReserved = mGuarded ? static_cast<size_t>(Guest_Address_Space_Size) + pageSize : mSize;
+
+		if (mReserved == 0) {
+			return;
+		}
+
+		int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+		// do not account the whole size up front, large memory configs are usually sparsely used
+		flags |= MAP_NORESERVE;
+#endif
+
+		void* ptr = mmap(nullptr, mReserved, mGuarded ? PROT_NONE : (PROT_READ | PROT_WRITE), flags, -1, 0);
+		if (ptr == MAP_FAILED) {
+			throw std::bad_alloc{};
+		}
+
+		mData = static_cast<uint8_t*>(ptr);
+
+		if (mGuarded) {
+			// just the block itself is accessible, the rest of the reservation is the guard region
+			if (mprotect(mData, mSize, PROT_READ | PROT_WRITE) != 0) {
+				Release();
+				throw std::bad_alloc{};
+			}
+
+			Install_Guard_Fault_Handler();
+
+			// too many guarded blocks - the block stays accessible, but the accesses must be checked
+			if (!Register_Guarded_Range(reinterpret_cast<uintptr_t>(mData), reinterpret_cast<uintptr_t>(mData) + mReserved)) {
+				mGuarded = false;
+			}
+		}
+
+#ifdef MADV_HUGEPAGE
+		// just a hint, the failure is not an error
+		madvise(mData, mSize, MADV_HUGEPAGE);
+#endif
+	}
+
+	void CHost_Memory::Release() {
+		if (mData) {
+			if (mGuarded) {
+				Unregister_Guarded_Range(reinterpret_cast<uintptr_t>(mData));
+			}
+
+			munmap(mData, mReserved);
+			mData = nullptr;
+		}
+	}
+
+	void CHost_Memory::Clear() {
+		if (!mData) {
+			return;
+		}
+
+		// shared pages must stay shared
+		if (mShared_Fd >= 0) {
+			if (!Punch_Shared(0, mSize)) {
+				std::memset(mData, 0, mSize);
+			}
+			return;
+		}
+
+#ifdef __linux__
+		// private anonymous pages read as zero after being dropped (file-backed pages would revert to the file contents, though)
+		if (!mFile_Mapped && madvise(mData, mSize, MADV_DONTNEED) == 0) {
+			return;
+		}
+#endif
+
+		mFile_Mapped = false;
+
+		// MADV_DONTNEED does not guarantee zeroing elsewhere - replace the mapping by a fresh one
+		int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED;
+#ifdef MAP_NORESERVE
+		flags |= MAP_NORESERVE;
+#endif
+
+		if (mmap(mData, mSize, PROT_READ | PROT_WRITE, flags, -1, 0) == MAP_FAILED) {
+			// should not happen, but the memory must be cleared anyway
+			std::memset(mData, 0, mSize);
+		}
+	}
+
+	void CHost_Memory::Clear_Range(size_t offset, size_t length) {
+
+		if (!mData || offset >= mSize) {
+			return;
+		}
+
+		length = std::min(length, mSize - offset);
+
+		const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+		// whole pages within the range
+		const size_t first = (offset + pageSize - 1) / pageSize * pageSize;
+		const size_t last = (offset + length) / pageSize * pageSize;
+
+		if (first >= last) {
+			std::memset(mData + offset, 0, length);
+			return;
+		}
+
+		// partial pages at the edges are written, the whole pages are replaced by fresh ones (they could be file-backed)
+		std::memset(mData + offset, 0, first - offset);
+		std::memset(mData + last, 0, offset + length - last);
+
+		if (mShared_Fd >= 0) {
+			if (!Punch_Shared(first, last - first)) {
+				std::memset(mData + first, 0, last - first);
+			}
+			return;
+		}
+
+		int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED;
+#ifdef MAP_NORESERVE
+		flags |= MAP_NORESERVE;
+#endif
+
+		if (mmap(mData + first, last - first, PROT_READ | PROT_WRITE, flags, -1, 0) == MAP_FAILED) {
+			std::memset(mData + first, 0, last - first);
+		}
+	}
+
+	size_t CHost_Memory::Map_File(size_t offset, int fd, uint64_t fileOffset, size_t length) {
+
+		const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+		// private file pages would not be visible through the shared object
+		if (!mData || fd < 0 || mShared_Fd >= 0 || offset % pageSize != 0 || fileOffset % pageSize != 0 || offset > mSize) {
+			return 0;
+		}
+
+		// whole pages only - the tail page would contain unrelated file contents (or lie beyond the end of the file)
+		length = std::min(length, mSize - offset);
+		length -= length % pageSize;
+
+		if (length == 0) {
+			return 0;
+		}
+
+		// private mapping - guest writes end up in an anonymous copy of the page, the file stays untouched
+		if (mmap(mData + offset, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, static_cast<off_t>(fileOffset)) == MAP_FAILED) {
+			// the original mapping may be gone by now, restore it
+			int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED;
+#ifdef MAP_NORESERVE
+			flags |= MAP_NORESERVE;
+#endif
+			if (mmap(mData + offset, length, PROT_READ | PROT_WRITE, flags, -1, 0) == MAP_FAILED) {
+				throw std::bad_alloc{};
+			}
+			return 0;
+		}
+
+		mFile_Mapped = true;
+
+		return length;
+	}
+
+	bool CHost_Memory::Share(int fd, uint64_t fileOffset) {
+
+		const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+		if (!mData || fd < 0 || fileOffset % pageSize != 0 || mSize % pageSize != 0) {
+			return false;
+		}
+
+		// the guard region (if any) stays in place, just the block itself is replaced
+		if (mmap(mData, mSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, static_cast<off_t>(fileOffset)) == MAP_FAILED) {
+			return false;
+		}
+
+		mShared_Fd = fd;
+		mShared_Offset = fileOffset;
+		mFile_Mapped = false;
+
+		return true;
+	}
+
+	bool CHost_Memory::Punch_Shared(size_t offset, size_t length) {
+#if defined(__linux__) && defined(FALLOC_FL_PUNCH_HOLE)
+		// the deallocated range reads as zeroes (in all processes) and it is allocated again when touched
+		return fallocate(mShared_Fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, static_cast<off_t>(mShared_Offset + offset), static_cast<off_t>(length)) == 0;
+#else
+		return false;
+#endif
+	}
+
+#endif
+
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace sarch32 {
+
+	/*
+	 * Host memory block backing the guest main memory
+	 *
+	 * The block is reserved as anonymous virtual memory, so the host commits the pages only when they are
+	 * first touched - startup and reset cost is proportional to the memory actually used by the guest,
+	 * not to the configured memory size. Transparent huge pages are requested, where available
+	 *
+	 * In guarded mode, the block is placed at the start of a reservation covering the whole 32-bit guest address
+	 * space (plus a page for accesses crossing the end). Everything beyond the block size is inaccessible and
+	 * a host fault in there is converted into abort_exception, so the accesses don't need to be bounds-checked.
+	 * The exception is thrown right from the signal handler, so the guarded accesses must be inline loads and stores
+	 * of code built with -fnon-call-exceptions (see CMemory_Bus) - a fault within a library call (memcpy, ...) cannot
+	 * be unwound. This relies on an unwinder able to step through signal frames (GCC/Clang on Linux).
+	 * Guarded mode is available on 64-bit POSIX hosts with page-aligned block size only; it silently
+	 * falls back to the unguarded mode otherwise (see Is_Guarded)
+	 *
+	 * The block may be backed by a shared object instead (see Share) - file pages are never mapped into it then,
+	 * as they would not be visible to other processes
+	 */
+	class CHost_Memory {
+
+		private:
+			// start of the block
+			uint8_t* mData = nullptr;
+			// size of the block
+			size_t mSize = 0;
+			// size of the whole reservation (equal to block size in unguarded mode)
+			size_t mReserved = 0;
+			// is the guarded mode active?
+			bool mGuarded = false;
+			// are there any file pages mapped into the block?
+			bool mFile_Mapped = false;
+			// descriptor of the shared object backing the block (-1 if the block is private)
+			int mShared_Fd = -1;
+			// offset of the block within the shared object
+			uint64_t mShared_Offset = 0;
+
+			// zeroes given page-aligned range of the shared block by deallocating its pages; false if not possible
+			bool Punch_Shared(size_t offset, size_t length);
+
+			// allocates (reserves) the block; throws std::bad_alloc on failure
+			void Allocate();
+			// releases the block
+			void Release();
+
+		public:
+			CHost_Memory(size_t size, bool guarded = false);
+			~CHost_Memory();
+
+			CHost_Memory(const CHost_Memory&) = delete;
+			CHost_Memory& operator=(const CHost_Memory&) = delete;
+
+			// retrieves the block start
+			uint8_t* Data() {
+				return mData;
+			}
+
+			// retrieves the block start (read only)
+			const uint8_t* Data() const {
+				return mData;
+			}
+
+			// retrieves the block size
+			size_t Size() const {
+				return mSize;
+			}
+
+			// are the accesses beyond block size guarded by the host?
+			bool Is_Guarded() const {
+				return mGuarded;
+			}
+
+			// zeroes the whole block by returning its pages to the host
+			void Clear();
+
+			// zeroes given range of the block; whole pages are returned to the host instead of being written to
+			void Clear_Range(size_t offset, size_t length);
+
+			// backs the whole block by given shared object (e.g., POSIX shared memory object), so other processes can map it too;
+			// the object must be at least of block size (starting at given page-aligned offset), the current contents are discarded
+			bool Share(int fd, uint64_t fileOffset);
+
+			// is the block backed by a shared object?
+			bool Is_Shared() const {
+				return mShared_Fd >= 0;
+			}
+
+			// maps file contents copy-on-write at given offset of the block; only whole pages are mapped (the offsets must be page-aligned)
+			// returns the number of bytes mapped - the rest (or everything, if the mapping is not possible) must be copied by the caller
+			size_t Map_File(size_t offset, int fd, uint64_t fileOffset, size_t length);
+	};
+
+}
@@ -1,9 +1,12 @@
 #include "isa.h"
+#include "lexer.h"
 
 #include <iostream>
-#include <regex>
 #include <algorithm>
 #include <cctype>
+#include <charconv>
+#include <cstring>
+#include <limits>
 #include <string>
 #include <variant>
 #include <sstream>
@@ -145,6 +148,97 @@ const std::unordered_map<NOpcode, std::string> Opcode_To_Mnemonic = {
 	{ NOpcode::aps, "aps" },
 };
 
+// packs up to 4 characters of a mnemonic (case insensitive) to a single key; zero, if the mnemonic is empty or longer
+// NOTE: the packing is injective, so it is a perfect hash of all the mnemonics and the lookups below are plain switches
+constexpr uint32_t Mnemonic_Key(std::string_view str) {
+	if (str.empty() || str.size() > sizeof(uint32_t))
+		return 0;
+
+	uint32_t key = 0;
+	for (size_t i = 0; i < str.size(); i++) {
+		key |= static_cast<uint32_t>(static_cast<uint8_t>(sarch32::To_Lower(str[i]))) << (i * 8);
+	}
+	return key;
+}
+
+// looks up opcode by its mnemonic (the same as Mnemonic_To_Opcode, without hashing strings)
+static bool Lookup_Opcode(std::string_view str, NOpcode& opcode) {
+	switch (Mnemonic_Key(str)) {
+		case Mnemonic_Key("nop"):	opcode = NOpcode::nop; return true;
+		case Mnemonic_Key("mov"):	opcode = NOpcode::mov; return true;
+		case Mnemonic_Key("movi"):	opcode = NOpcode::movi; return true;
+		case Mnemonic_Key("add"):	opcode = NOpcode::add; return true;
+		case Mnemonic_Key("addi"):	opcode = NOpcode::addi; return true;
+		case Mnemonic_Key("sub"):	opcode = NOpcode::sub; return true;
+		case Mnemonic_Key("subi"):	opcode = NOpcode::subi; return true;
+		case Mnemonic_Key("mul"):	opcode = NOpcode::mul; return true;
+		case Mnemonic_Key("muli"):	opcode = NOpcode::muli; return true;
+		case Mnemonic_Key("div"):	opcode = NOpcode::div; return true;
+		case Mnemonic_Key("divi"):	opcode = NOpcode::divi; return true;
+		case Mnemonic_Key("and"):	opcode = NOpcode::and_; return true;
+		case Mnemonic_Key("andi"):	opcode = NOpcode::andi; return true;
+		case Mnemonic_Key("or"):	opcode = NOpcode::or_; return true;
+		case Mnemonic_Key("ori"):	opcode = NOpcode::ori; return true;
+		case Mnemonic_Key("slr"):	opcode = NOpcode::slr; return true;
+		case Mnemonic_Key("sli"):	opcode = NOpcode::sli; return true;
+		case Mnemonic_Key("srr"):	opcode = NOpcode::srr; return true;
+		case Mnemonic_Key("sri"):	opcode = NOpcode::sri; return true;
+		case Mnemonic_Key("lw"):	opcode = NOpcode::lw; return true;
+		case Mnemonic_Key("li"):	opcode = NOpcode::li; return true;
+		case Mnemonic_Key("sw"):	opcode = NOpcode::sw; return true;
+		case Mnemonic_Key("si"):	opcode = NOpcode::si; return true;
+		case Mnemonic_Key("cmpr"):	opcode = NOpcode::cmpr; return true;
+		case Mnemonic_Key("cmpi"):	opcode = NOpcode::cmpi; return true;
+		case Mnemonic_Key("br"):	opcode = NOpcode::br; return true;
+		case Mnemonic_Key("bi"):	opcode = NOpcode::bi; return true;
+		case Mnemonic_Key("brr"):	opcode = NOpcode::br; return true;
+		case Mnemonic_Key("bir"):	opcode = NOpcode::bi; return true;
+		case Mnemonic_Key("push"):	opcode = NOpcode::push; return true;
+		case Mnemonic_Key("pop"):	opcode = NOpcode::pop; return true;
+		case Mnemonic_Key("fw"):	opcode = NOpcode::fw; return true;
+		case Mnemonic_Key("svc"):	opcode = NOpcode::svc; return true;
+		case Mnemonic_Key("aps"):	opcode = NOpcode::aps; return true;
+	}
+	return false;
+}
+
+// looks up condition by its mnemonic (the same as Mnemonic_To_Cond)
+static bool Lookup_Condition(std::string_view str, NCondition& cond) {
+	switch (Mnemonic_Key(str)) {
+		case Mnemonic_Key("al"):	cond = NCondition::always; return true;
+		case Mnemonic_Key("eq"):	cond = NCondition::equal; return true;
+		case Mnemonic_Key("ne"):	cond = NCondition::not_equal; return true;
+		case Mnemonic_Key("gt"):	cond = NCondition::greater; return true;
+		case Mnemonic_Key("ge"):	cond = NCondition::greater_equal; return true;
+		case Mnemonic_Key("lt"):	cond = NCondition::less; return true;
+		case Mnemonic_Key("le"):	cond = NCondition::less_equal; return true;
+	}
+	return false;
+}
+
+// looks up register by its mnemonic (the same as Mnemonic_To_Register); NRegister::count if there is no such register
+static NRegister Lookup_Register(std::string_view str) {
+	switch (Mnemonic_Key(str)) {
+		case Mnemonic_Key("r0"):	return NRegister::R0;
+		case Mnemonic_Key("r1"):	return NRegister::R1;
+		case Mnemonic_Key("r2"):	return NRegister::R2;
+		case Mnemonic_Key("r3"):	return NRegister::R3;
+		case Mnemonic_Key("r4"):	return NRegister::R4;
+		case Mnemonic_Key("r5"):	return NRegister::R5;
+		case Mnemonic_Key("r6"):	return NRegister::R6;
+		case Mnemonic_Key("r7"):	return NRegister::R7;
+		case Mnemonic_Key("r8"):	return NRegister::R8;
+		case Mnemonic_Key("r9"):	return NRegister::R9;
+		case Mnemonic_Key("r10"):	return NRegister::R10;
+		case Mnemonic_Key("r11"):	return NRegister::R11;
+		case Mnemonic_Key("sp"):	return NRegister::SP;
+		case Mnemonic_Key("ra"):	return NRegister::RA;
+		case Mnemonic_Key("flg"):	return NRegister::FLG;
+		case Mnemonic_Key("pc"):	return NRegister::PC;
+	}
+	return NRegister::count;
+}
+
 // retrieves register name using its enum value
 std::string Get_Register_Name(NRegister reg) {
 	auto itr = Register_To_Mnemonic.find(reg);
@@ -165,20 +259,16 @@ inline bool Validate_Argc(const std::vector<std::string>& operands, size_t cnt)
 
 // parse register name from string, throw exception if not found
 static NRegister Parse_Register(const std::string& str) {
-	auto itr = Mnemonic_To_Register.find(str);
-	if (itr == Mnemonic_To_Register.end())
+	const NRegister reg = Lookup_Register(str);
+	if (reg == NRegister::count)
 		throw sarch32_parser_exception{ "Unknown register: " + str };
 
-	return itr->second;
+	return reg;
 }
 
 // attempt to parse register, return invalid value if not found
 static NRegister Try_Parse_Register(const std::string& str) {
-	auto itr = Mnemonic_To_Register.find(str);
-	if (itr == Mnemonic_To_Register.end())
-		return NRegister::count;
-
-	return itr->second;
+	return Lookup_Register(str);
 }
 
 // attempt to parse immediate value (dec/hex)
@@ -188,37 +278,34 @@ static bool Try_Parse_Immediate(const std::string& str, int32_t& imm) {
 		return false;
 
 	// cut off the #
-	auto sub = str.substr(1);
-	try {
+	std::string_view sub{ str };
+	sub.remove_prefix(1);
 
-		// is hexa?
-		if (sub.starts_with("0x") || sub.starts_with("-0x")) {
+	// is negative? (contains minus sign?)
+	const bool neg = sub.starts_with('-');
 
-			// is negative? (contains minus sign?)
-			bool neg = false;
-			if (sub[0] == '-') {
-				neg = true;
-				sub = sub.substr(3);
-			}
-			else {
-				sub = sub.substr(2);
-			}
+	// is hexa?
+	if (sub.starts_with("0x") || sub.starts_with("-0x")) {
 
-			// try to parse hex number
-			imm = static_cast<int32_t>(std::stoull(sub, nullptr, 16));
-			// if negative, switch sign
-			if (neg)
-				imm *= -1;
-		}
-		// is dec
-		else {
-			imm = static_cast<int32_t>(std::stol(sub));
-		}
+		sub.remove_prefix(neg ? 3 : 2);
+
+		// try to parse hex number
+		uint64_t val = 0;
+		if (std::from_chars(sub.data(), sub.data() + sub.size(), val, 16).ec != std::errc{})
+			return false;
+
+		imm = static_cast<int32_t>(val);
+		// if negative, switch sign
+		if (neg)
+			imm *= -1;
 	}
-	// this means the string does not represent a number --> error
-	catch (...)
-	{
-		return false;
+	// is dec
+	else {
+		int64_t val = 0;
+		if (std::from_chars(sub.data(), sub.data() + sub.size(), val, 10).ec != std::errc{})
+			return false;
+
+		imm = static_cast<int32_t>(val);
 	}
 
 	return true;
@@ -264,6 +351,58 @@ void Word_To_Bytes(uint32_t word, std::vector<uint8_t>& res) {
 	std::copy_n(&dump.bytes[0], sizeof(word), std::back_inserter(res));
 }
 
+// retrieves the size of the instruction or data holding a field of given kind
+uint32_t Get_Relocation_Size(NRelocation_Kind kind) {
+	switch (kind) {
+		case NRelocation_Kind::Imm16:
+		case NRelocation_Kind::Imm24:
+		case NRelocation_Kind::Data32:
+			return 4;
+		case NRelocation_Kind::Data8:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+// patches resolved value to a field of given kind
+void Apply_Relocation(NRelocation_Kind kind, std::span<uint8_t> target, int32_t value) {
+
+	if (kind == NRelocation_Kind::None || target.size() < Get_Relocation_Size(kind))
+		throw sarch32_generator_exception{ "Invalid relocation" };
+
+	// the same range checks as in the instruction binary generators
+	switch (kind) {
+		case NRelocation_Kind::Imm16:
+		{
+			if (value > std::numeric_limits<int16_t>::max() || value < std::numeric_limits<int16_t>::min())
+				throw sarch32_generator_exception{ "Immediate argument out of range" };
+
+			const int16_t imm = static_cast<int16_t>(value);
+			std::memcpy(&target[2], &imm, sizeof(imm));
+			break;
+		}
+		case NRelocation_Kind::Imm24:
+		{
+			if (value > 0x7FFFFF || value < -0x800000)
+				throw sarch32_generator_exception{ "Immediate argument out of range" };
+
+			std::memcpy(&target[1], &value, 3);
+			break;
+		}
+		case NRelocation_Kind::Data8:
+		{
+			target[0] = static_cast<uint8_t>(value);
+			break;
+		}
+		case NRelocation_Kind::Data32:
+		{
+			std::memcpy(&target[0], &value, sizeof(value));
+			break;
+		}
+	}
+}
+
 // formats number for output - this should be compliant with the parser (strings generated by this should be parsed fine)
 std::string formatNum(int32_t num, bool hexaFmt) {
 	std::ostringstream oss;
@@ -289,7 +428,7 @@ class CInstruction_Nop : public CInstruction
 			return true; // opcode was parsed by parser, rest is ignored
 		};
 		virtual std::string Generate_String(bool hexaFmt) const override {
-			return Opcode_To_Mnemonic.find(Get_Opcode())->second;
+			return Opcode_To_Mnemonic.find(Get_Opcode())->second + (mCondition == NCondition::always ? "" : ("." + Cond_To_Mnemonic.find(Get_Condition())->second));
 		};
 		virtual uint32_t Generate_Binary() const override {
 			return Encode_From_Bytes({ Encode_MSB(), 0, 0, 0 });
@@ -396,6 +535,10 @@ class CInstruction_Generic_2Param : public CInstruction
 
 			return false;
 		}
+
+		virtual NRelocation_Kind Get_Relocation_Kind() const override {
+			return NRelocation_Kind::Imm16;
+		}
 };
 
 /*
@@ -475,6 +618,10 @@ class CInstruction_Generic_1Param : public CInstruction
 
 			return false;
 		}
+
+		virtual NRelocation_Kind Get_Relocation_Kind() const override {
+			return NRelocation_Kind::Imm16;
+		}
 };
 
 /*
@@ -558,6 +705,10 @@ class CInstruction_1Param : public CInstruction
 
 			return false;
 		}
+
+		virtual NRelocation_Kind Get_Relocation_Kind() const override {
+			return (NType == NOperand_Type::Immediate) ? NRelocation_Kind::Imm24 : NRelocation_Kind::None;
+		}
 };
 
 /*
@@ -765,12 +916,13 @@ class CInstruction_ShiftLeft : public CInstruction_Generic_2Param {
 			if (!Check_Condition(mCondition, cpu))
 				return true;
 
-			cpu.Reg(mDst.Get_Register()) =
-				cpu.Reg(mDst.Get_Register()) <<
-				(mSrc.Is_Immediate() ?
-					mSrc.Get_Immediate()
-					:
-					cpu.Reg(mSrc.Get_Register()));
+			const uint32_t amount = mSrc.Is_Immediate() ?
+				mSrc.Get_Immediate()
+				:
+				cpu.Reg(mSrc.Get_Register());
+
+			// shifting by the register width or more (or by a negative amount) clears the register
+			cpu.Reg(mDst.Get_Register()) = (amount >= 32) ? 0 : (cpu.Reg(mDst.Get_Register()) << amount);
 
 			return true;
 		}
@@ -791,12 +943,13 @@ class CInstruction_ShiftRight : public CInstruction_Generic_2Param {
 			if (!Check_Condition(mCondition, cpu))
 				return true;
 
-			cpu.Reg(mDst.Get_Register()) =
-				cpu.Reg(mDst.Get_Register()) >>
-				(mSrc.Is_Immediate() ?
-					mSrc.Get_Immediate()
-					:
-					cpu.Reg(mSrc.Get_Register()));
+			const uint32_t amount = mSrc.Is_Immediate() ?
+				mSrc.Get_Immediate()
+				:
+				cpu.Reg(mSrc.Get_Register());
+
+			// shifting by the register width or more (or by a negative amount) clears the register
+			cpu.Reg(mDst.Get_Register()) = (amount >= 32) ? 0 : (cpu.Reg(mDst.Get_Register()) >> amount);
 
 			return true;
 		}
@@ -869,7 +1022,8 @@ class CInstruction_Compare : public CInstruction_Generic_2Param {
 			const int32_t r1 = std::bit_cast<int32_t>(cpu.Reg(mDst.Get_Register()));
 			const int32_t r2 = std::bit_cast<int32_t>(mSrc.Is_Immediate() ? mSrc.Get_Immediate() : cpu.Reg(mSrc.Get_Register()));
 
-			const int32_t result = r1 - r2;
+			// subtract with wrap-around (signed overflow is detected below)
+			const int32_t result = std::bit_cast<int32_t>(static_cast<uint32_t>(r1) - static_cast<uint32_t>(r2));
 
 			auto& flg = cpu.Reg(NRegister::FLG);
 			auto setFlag = [&flg](NFlags flag, bool set = true) {
@@ -881,7 +1035,7 @@ class CInstruction_Compare : public CInstruction_Generic_2Param {
 
 			setFlag(NFlags::Zero, (result == 0));
 			setFlag(NFlags::Sign, (result < 0));
-			setFlag(NFlags::Overflow, (r1 > r2 && result > r1));  // ?
+			setFlag(NFlags::Overflow, ((r1 ^ r2) & (r1 ^ result)) < 0); // operands of different sign and the result sign differs from the minuend
 
 			return true;
 		}
@@ -1128,71 +1282,99 @@ const std::unordered_map<NOpcode, TFactory_Fnc> Instruction_Factory_Map = {
 	{ NOpcode::aps, &InstrFactory<CInstruction_Aps> },
 };
 
-// builds an instruction class from string
-std::unique_ptr<CInstruction> CInstruction::Build_From_String(const std::string& line) {
+// is the character allowed within an operand? (registers, immediates and symbols)
+static bool Is_Operand_Char(char c) {
+	return sarch32::Is_Alnum(c) || c == '-' || c == '_';
+}
 
-	// transform the input to lowercase
-	std::string input = "";
-	std::transform(line.begin(), line.end(), std::back_inserter(input), [](unsigned char c) { return std::tolower(c); });
+// lexes an operand at the current position ([a-z#$][-a-z0-9_]*); empty, if there is none
+static std::string_view Lex_Operand(sarch32::CLine_Lexer& lex) {
+	const char c = lex.Peek();
+	if (!sarch32::Is_Alpha(c) && c != '#' && c != '$')
+		return {};
 
-	// regular expressions for instruction parsing
-	std::regex instr_2op{ "^[\\s]{0,}([a-z]+[a-z0-9]*[\\.]{0,1}[a-z]{0,2})[\\s]+([a-z]+[a-z0-9]*)[\\s]*,[\\s]*([a-z#\\$]{1}[\\-a-z0-9_]*)[\\s]*(;.*)?$", std::regex::ECMAScript };
-	std::regex instr_1op{ "^[\\s]{0,}([a-z]+[a-z0-9]*[\\.]{0,1}[a-z]{0,2})[\\s]+([a-z#\\$]{1}[\\-a-z0-9_]*)[\\s]*(;.*)?$", std::regex::ECMAScript };
-	std::regex instr_0op{ "^[\\s]{0,}([a-z]+[a-z0-9]*[\\.]{0,1}[a-z]{0,2})[\\s]*(;.*)?$", std::regex::ECMAScript };
-	std::regex cond_parse{ "^([a-z0-9]+)(\\.[a-z]+)?$", std::regex::ECMAScript };
+	const auto rest = lex.Rest();
+	lex.Accept(c);
+	return rest.substr(0, 1 + lex.Take_While(Is_Operand_Char).size());
+}
 
-	std::string mnemonic;
+// builds an instruction class from string
+std::unique_ptr<CInstruction> CInstruction::Build_From_String(std::string_view line) {
+
+	// the grammar is case insensitive; the lexer does not copy the line, just the tokens are converted to lowercase when stored
+	sarch32::CLine_Lexer lex{ line };
+
+	const auto unable = [&line]() {
+		return sarch32_parser_exception{ "Unable to parse line: " + std::string(line) };
+	};
+
+	// mnemonic - opcode ([a-z][a-z0-9]*), optionally followed by a condition (.[a-z]{0,2})
+	lex.Skip_Space();
+	const auto mnemonicStart = lex.Rest();
+	if (!sarch32::Is_Alpha(lex.Peek()))
+		throw unable();
+
+	const auto opcodeStr = lex.Take_While(sarch32::Is_Alnum);
+	std::string_view condStr;
+	const bool hasCond = lex.Accept('.');
+	if (hasCond) {
+		condStr = lex.Take_While(sarch32::Is_Alpha);
+		if (condStr.size() > 2)
+			throw unable();
+	}
+
+	std::string mnemonic = sarch32::To_Lower(mnemonicStart.substr(0, mnemonicStart.size() - lex.Rest().size()));
 	std::vector<std::string> operands;
 
-	NOpcode opcode = NOpcode::nop;
-	NCondition cond = NCondition::always;
+	// operands - none, one, or a register followed by a comma and another operand; whitespace must separate them from the mnemonic
+	const bool separated = lex.Skip_Space();
+	if (!lex.Accept_Trailer()) {
 
-	std::smatch sm;
-	// match 2 parametric
-	if (std::regex_match(input, sm, instr_2op))
-	{
-		mnemonic = sm[1];
-		operands.push_back(sm[2]);
-		operands.push_back(sm[3]);
-	}
-	// match single parametric
-	else if (std::regex_match(input, sm, instr_1op))
-	{
-		mnemonic = sm[1];
-		operands.push_back(sm[2]);
-	}
-	// match no parametric
-	else if (std::regex_match(input, sm, instr_0op))
-	{
-		mnemonic = sm[1];
-	}
-	else
-		throw sarch32_parser_exception{ "Unable to parse line: " + line };
+		if (!separated)
+			throw unable();
+
+		const auto first = Lex_Operand(lex);
+		if (first.empty())
+			throw unable();
+
+		operands.push_back(sarch32::To_Lower(first));
 
-	// parse mnemonic and conditional, if present
-	if (std::regex_match(mnemonic, sm, cond_parse))
-	{
-		// if matched and corresponds to condition type, use it
-		if (sm[2].matched) {
-			auto itr = Mnemonic_To_Cond.find(sm[2].str().substr(1));
+		lex.Skip_Space();
+		if (lex.Accept(',')) {
 
-			if (itr == Mnemonic_To_Cond.end())
-				throw sarch32_parser_exception{ "Invalid condition mnemonic: " + mnemonic };
+			// the first of two operands is always a register-like token ([a-z][a-z0-9]*)
+			if (!sarch32::Is_Alpha(first.front()) || !std::all_of(first.begin(), first.end(), sarch32::Is_Alnum))
+				throw unable();
 
-			cond = itr->second;
+			lex.Skip_Space();
+			const auto second = Lex_Operand(lex);
+			if (second.empty())
+				throw unable();
+
+			operands.push_back(sarch32::To_Lower(second));
 		}
 
-		// parse mnemonic - find opcode enum value
-		auto itr = Mnemonic_To_Opcode.find(sm[1]);
-		if (itr == Mnemonic_To_Opcode.end())
-			throw sarch32_parser_exception{ "Invalid opcode mnemonic: " + mnemonic };
+		if (!lex.Accept_Trailer())
+			throw unable();
+	}
+
+	NOpcode opcode = NOpcode::nop;
+	NCondition cond = NCondition::always;
 
-		mnemonic = sm[1];
+	// parse conditional, if present
+	if (hasCond) {
+		if (condStr.empty())
+			throw sarch32_parser_exception{ "Invalid instruction mnemonic format: " + mnemonic };
 
-		opcode = itr->second;
+		if (!Lookup_Condition(condStr, cond))
+			throw sarch32_parser_exception{ "Invalid condition mnemonic: " + mnemonic };
 	}
-	else
-		throw sarch32_parser_exception{ "Invalid instruction mnemonic format: " + mnemonic };
+
+	// parse mnemonic - find opcode enum value
+	if (!Lookup_Opcode(opcodeStr, opcode))
+		throw sarch32_parser_exception{ "Invalid opcode mnemonic: " + mnemonic };
+
+	mnemonic.resize(opcodeStr.size());
 
 	// find factory function
 	if (!Instruction_Factory_Map.contains(opcode))
@@ -1225,8 +1407,16 @@ std::unique_ptr<CInstruction> CInstruction::Build_From_Binary(const uint32_t ins
 	const NOpcode opcode = static_cast<NOpcode>(lastByte & 0b11111);
 	const NCondition cond = static_cast<NCondition>(lastByte >> 5);
 
+	// the unspecified condition is not a valid encoding
+	if (cond == NCondition::unspecified)
+		return nullptr;
+
 	// find factory by opcode
-	auto instr = Instruction_Factory_Map.find(opcode)->second(opcode, cond);
+	auto factory = Instruction_Factory_Map.find(opcode);
+	if (factory == Instruction_Factory_Map.end())
+		return nullptr;
+
+	auto instr = factory->second(opcode, cond);
 	// parse binary
 	if (!instr->Parse_Binary(instruction))
 		return nullptr;
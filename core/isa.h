@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <array>
 #include <vector>
 #include <memory>
@@ -8,6 +9,9 @@
 #include <stdexcept>
 #include <bit>
 #include <variant>
+#include <span>
+#include <algorithm>
+#include <atomic>
 
 /*
  * Enumerator of all existing registers
@@ -318,6 +322,54 @@ class IInterrupt_Controller
 		virtual void Clear_IRQ_Flag(int16_t channel) = 0;
 };
 
+/*
+ * Dirty range tracker - accumulates a single range covering all writes since it was taken the last time; the range is marked
+ * by the thread running the machine and taken by another one (e.g., GUI), so both bounds are kept in a single atomic word
+ */
+class CDirty_Range_Tracker
+{
+	private:
+		// begin of the dirty range in the upper half, (exclusive) end in the lower half; offsets within the tracked memory
+		static constexpr uint64_t Empty = static_cast<uint64_t>(UINT32_MAX) << 32;
+		std::atomic<uint64_t> mRange{ Empty };
+
+		static constexpr uint64_t Pack(uint32_t begin, uint32_t end) {
+			return (static_cast<uint64_t>(begin) << 32) | end;
+		}
+
+		static constexpr std::pair<uint32_t, uint32_t> Unpack(uint64_t range) {
+			return { static_cast<uint32_t>(range >> 32), static_cast<uint32_t>(range) };
+		}
+
+	public:
+		// marks given range as dirty
+		void Mark(uint32_t offset, uint32_t size) {
+			uint64_t current = mRange.load(std::memory_order_relaxed);
+			uint64_t extended;
+			do {
+				const auto [begin, end] = Unpack(current);
+				extended = Pack(std::min(begin, offset), std::max(end, offset + size));
+			} while (extended != current && !mRange.compare_exchange_weak(current, extended, std::memory_order_release, std::memory_order_relaxed));
+		}
+
+		// is there anything dirty?
+		bool Is_Dirty() const {
+			const auto [begin, end] = Unpack(mRange.load(std::memory_order_acquire));
+			return begin < end;
+		}
+
+		// retrieves the dirty range (begin, end) and clears it; a range marked concurrently is either taken, or left for the next time
+		std::pair<uint32_t, uint32_t> Take() {
+			const auto [begin, end] = Unpack(mRange.exchange(Empty, std::memory_order_acquire));
+			return (begin < end) ? std::make_pair(begin, end) : std::make_pair(0u, 0u);
+		}
+
+		// clears the dirty range
+		void Clear() {
+			mRange.store(Empty, std::memory_order_release);
+		}
+};
+
 /*
  * Peripheral device interface
  */
@@ -337,6 +389,16 @@ class IPeripheral
 		virtual void Read_Memory(uint32_t address, void* target, uint32_t size) const = 0;
 		// writes to a given address of peripheral memory, places the bytes from source pointer to the memory
 		virtual void Write_Memory(uint32_t address, const void* source, uint32_t size) = 0;
+
+		// retrieves host memory backing the mapped region, if the peripheral memory behaves as plain memory; the bus then
+		// accesses it directly (no Read_Memory/Write_Memory calls) and records the writes to the dirty range tracker
+		virtual std::span<uint8_t> Get_Direct_Memory() {
+			return {};
+		}
+		// retrieves the dirty range tracker of the direct memory (offsets are relative to the mapped region)
+		virtual CDirty_Range_Tracker* Get_Dirty_Range_Tracker() {
+			return nullptr;
+		}
 };
 
 /*
@@ -350,14 +412,36 @@ class CCPU_Context
 		// processor state registers
 		std::array<uint32_t, Processor_State_Register_Count> mState_Registers{};
 		// memory bus
-		IBus& mBus;
+		IBus* mBus;
 
 	public:
-		CCPU_Context(IBus& bus) : mBus(bus) {
-			std::fill(mRegister_Content.begin(), mRegister_Content.end(), 0xFFFFFFFF);
+		CCPU_Context(IBus& bus) : mBus(&bus) {
+			Reset();
 		}
 		virtual ~CCPU_Context() = default;
 
+		// retrieves the memory bus used by the CPU
+		IBus& Get_Bus() const {
+			return *mBus;
+		}
+
+		// switches the memory bus used by the CPU (e.g., to a proxy bus)
+		void Set_Bus(IBus& bus) {
+			mBus = &bus;
+		}
+
+		// copies register and state register contents from other context (the bus stays the same)
+		void Copy_State_From(const CCPU_Context& other) {
+			mRegister_Content = other.mRegister_Content;
+			mState_Registers = other.mState_Registers;
+		}
+
+		// resets registers to their power-on state
+		void Reset() {
+			std::fill(mRegister_Content.begin(), mRegister_Content.end(), 0xFFFFFFFF);
+			std::fill(mState_Registers.begin(), mState_Registers.end(), 0);
+		}
+
 		// retrieve a reference to register content
 		uint32_t& Reg(NRegister regist) {
 			return mRegister_Content[static_cast<size_t>(regist)];
@@ -388,14 +472,14 @@ class CCPU_Context
 		template<typename T>
 		T Mem_Read_Scalar(uint32_t address) {
 			T t;
-			mBus.Read(address, &t, sizeof(T));
+			mBus->Read(address, &t, sizeof(T));
 			return t;
 		}
 
 		// write a scalar to the memory bus (helper method)
 		template<typename T>
 		void Mem_Write_Scalar(uint32_t address, const T& t) {
-			mBus.Write(address, &t, sizeof(T));
+			mBus->Write(address, &t, sizeof(T));
 		}
 };
 
@@ -411,6 +495,18 @@ enum class NOperand_Type {
 	Immediate_Symbolic, // operand is an immediate value, that is unknown at the moment (will be resolved during linkage)
 };
 
+/*
+ * Kind of a field holding a symbolic value - tells the linker how to patch the resolved value into instruction or data
+ */
+enum class NRelocation_Kind : uint32_t {
+	None,
+
+	Imm16,  // 16bit immediate of an instruction (the upper half of the word)
+	Imm24,  // 24bit immediate of an instruction (the lower 3 bytes of the word)
+	Data8,  // single byte of data
+	Data32, // word of data
+};
+
 /*
  * Class encapsulating instruction operand
  */
@@ -565,7 +661,7 @@ class CInstruction
 
 		// decodes an immediate 24bit value from instruction encoding (3 leats significant bytes)
 		int32_t Decode_Immediate_24b(uint32_t word) const {
-			return std::bit_cast<int32_t>(word) / static_cast<int32_t>(0x100); // shift right by 8 bits, but preserving sign
+			return std::bit_cast<int32_t>(word) >> 8; // shift right by 8 bits, but preserving sign (arithmetic shift since C++20)
 		}
 
 	public:
@@ -597,6 +693,9 @@ class CInstruction
 		// retrieves resolve request, if any
 		virtual bool Get_Resolve_Request(std::string& str) const { return false; }
 
+		// retrieves the kind of the field the resolve request refers to
+		virtual NRelocation_Kind Get_Relocation_Kind() const { return NRelocation_Kind::None; }
+
 		// is this a pseudo-instruction? defaulting to "no"
 		virtual bool Is_Pseudo_Instruction() const { return false; }
 
@@ -607,7 +706,7 @@ class CInstruction
 		virtual uint32_t Get_Length() const { return 4; }
 
 		// factory method - build instruction from string
-		static std::unique_ptr<CInstruction> Build_From_String(const std::string& line);
+		static std::unique_ptr<CInstruction> Build_From_String(std::string_view line);
 		// factory method - build instruction from binary encoding
 		static std::unique_ptr<CInstruction> Build_From_Binary(const uint32_t instruction);
 
@@ -657,3 +756,9 @@ COperand Parse_Any(const std::string& str);
 
 // convert a single word to byte dump
 void Word_To_Bytes(uint32_t word, std::vector<uint8_t>& res);
+
+// retrieves the size of the instruction or data holding a field of given kind
+uint32_t Get_Relocation_Size(NRelocation_Kind kind);
+
+// patches resolved value to a field of given kind; the target spans the whole instruction or data (see Get_Relocation_Size)
+void Apply_Relocation(NRelocation_Kind kind, std::span<uint8_t> target, int32_t value);
@@ -0,0 +1,102 @@
+#include "lexer.h"
+
+#include <fstream>
+#include <iterator>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace sarch32 {
+
+	CMapped_Text_File::~CMapped_Text_File() {
+		Close();
+	}
+
+	bool CMapped_Text_File::Open(const std::string& path) {
+
+		Close();
+
+#ifndef _WIN32
+		mFd = open(path.c_str(), O_RDONLY);
+		if (mFd >= 0) {
+			struct stat st;
+			if (fstat(mFd, &st) == 0 && S_ISREG(st.st_mode)) {
+
+				// empty file cannot be mapped, but it is a valid (empty) source
+				if (st.st_size == 0) {
+					return true;
+				}
+
+				void* ptr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, mFd, 0);
+				if (ptr != MAP_FAILED) {
+					// the file is read from start to end just once
+					madvise(ptr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+					mData = static_cast<const char*>(ptr);
+					mSize = static_cast<size_t>(st.st_size);
+					return true;
+				}
+			}
+
+			close(mFd);
+			mFd = -1;
+		}
+#endif
+
+		// the file could not be mapped - read it whole instead
+		std::ifstream ifs(path, std::ios::in | std::ios::binary);
+		if (!ifs.is_open()) {
+			return false;
+		}
+
+		mFallback_Buffer.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+		mData = mFallback_Buffer.data();
+		mSize = mFallback_Buffer.size();
+
+		return true;
+	}
+
+	void CMapped_Text_File::Close() {
+
+#ifndef _WIN32
+		if (mFd >= 0) {
+			if (mData) {
+				munmap(const_cast<char*>(mData), mSize);
+			}
+			close(mFd);
+			mFd = -1;
+		}
+#endif
+
+		mData = nullptr;
+		mSize = 0;
+		mPosition = 0;
+		mFallback_Buffer.clear();
+	}
+
+	bool CMapped_Text_File::Next_Line(std::string_view& line) {
+
+		if (mPosition >= mSize) {
+			return false;
+		}
+
+		const std::string_view rest{ mData + mPosition, mSize - mPosition };
+		const size_t end = rest.find('\n');
+
+		// the last line does not have to be terminated
+		if (end == std::string_view::npos) {
+			line = rest;
+			mPosition = mSize;
+		}
+		else {
+			line = rest.substr(0, end);
+			mPosition += end + 1;
+		}
+
+		return true;
+	}
+
+}
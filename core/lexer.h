@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sarch32 {
+
+	// is the character a whitespace? (the same set as \s of ECMAScript regular expressions, ASCII only)
+	constexpr bool Is_Space(char c) {
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+	}
+
+	// is the character a letter?
+	constexpr bool Is_Alpha(char c) {
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+	}
+
+	// is the character a decimal digit?
+	constexpr bool Is_Digit(char c) {
+		return c >= '0' && c <= '9';
+	}
+
+	// is the character a hexadecimal digit?
+	constexpr bool Is_Hex_Digit(char c) {
+		return Is_Digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+	}
+
+	// is the character a letter or a digit?
+	constexpr bool Is_Alnum(char c) {
+		return Is_Alpha(c) || Is_Digit(c);
+	}
+
+	// converts an ASCII letter to lowercase, other characters are left intact
+	constexpr char To_Lower(char c) {
+		return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+	}
+
+	// copies the string converted to lowercase
+	inline std::string To_Lower(std::string_view str) {
+		std::string res(str);
+		for (auto& c : res) {
+			c = To_Lower(c);
+		}
+		return res;
+	}
+
+	/*
+	 * Single line lexer
+	 *
+	 * Walks a view of a single source line from left to right; nothing is copied, the tokens are views into the line.
+	 * All matching is case sensitive, case insensitive grammars compare against lowercase characters themselves
+	 */
+	class CLine_Lexer {
+
+		private:
+			// rest of the line yet to be consumed
+			std::string_view mRest;
+
+		public:
+			explicit CLine_Lexer(std::string_view line)
+				: mRest(line) {
+				//
+			}
+
+			// retrieves the rest of the line
+			std::string_view Rest() const {
+				return mRest;
+			}
+
+			// retrieves the next character without consuming it; zero at the end of line
+			char Peek() const {
+				return mRest.empty() ? '\0' : mRest.front();
+			}
+
+			// skips whitespaces; returns true if there were any
+			bool Skip_Space() {
+				const size_t len = mRest.size();
+				while (!mRest.empty() && Is_Space(mRest.front())) {
+					mRest.remove_prefix(1);
+				}
+				return mRest.size() != len;
+			}
+
+			// consumes given character, if it is next
+			bool Accept(char c) {
+				if (mRest.empty() || mRest.front() != c) {
+					return false;
+				}
+				mRest.remove_prefix(1);
+				return true;
+			}
+
+			// consumes given string, if it is next
+			bool Accept(std::string_view str) {
+				if (!mRest.starts_with(str)) {
+					return false;
+				}
+				mRest.remove_prefix(str.size());
+				return true;
+			}
+
+			// consumes the longest prefix of characters matching given predicate
+			template<typename TPred>
+			std::string_view Take_While(TPred pred) {
+				size_t len = 0;
+				while (len < mRest.size() && pred(mRest[len])) {
+					len++;
+				}
+				auto res = mRest.substr(0, len);
+				mRest.remove_prefix(len);
+				return res;
+			}
+
+			// consumes the rest of the line, if it contains nothing but whitespaces and an optional comment (";...")
+			bool Accept_Trailer() {
+				Skip_Space();
+				if (mRest.empty() || mRest.front() == ';') {
+					mRest = {};
+					return true;
+				}
+				return false;
+			}
+	};
+
+	/*
+	 * Read-only text file, mapped to memory
+	 *
+	 * Splits the contents to lines, the lines are views into the mapped file, which stays mapped for the whole lifetime
+	 * of this object
+	 */
+	class CMapped_Text_File {
+
+		private:
+			// mapped file contents
+			const char* mData = nullptr;
+			// size of the mapped file
+			size_t mSize = 0;
+			// native file descriptor (-1 if not available)
+			int mFd = -1;
+			// contents of the file, if it could not be mapped
+			std::vector<char> mFallback_Buffer;
+			// offset of the next line
+			size_t mPosition = 0;
+
+			// unmaps the file and closes it
+			void Close();
+
+		public:
+			CMapped_Text_File() = default;
+			~CMapped_Text_File();
+
+			CMapped_Text_File(const CMapped_Text_File&) = delete;
+			CMapped_Text_File& operator=(const CMapped_Text_File&) = delete;
+
+			// maps given file
+			bool Open(const std::string& path);
+
+			// retrieves the whole file contents
+			std::string_view Get_Text() const {
+				return { mData, mSize };
+			}
+
+			// retrieves the next line (without the line terminator); returns false at the end of the file
+			bool Next_Line(std::string_view& line);
+	};
+
+}
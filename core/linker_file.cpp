@@ -0,0 +1,82 @@
+#include "linker_file.h"
+#include "sobjformat.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <regex>
+
+namespace sarch32 {
+
+	bool Load_Linker_File(const std::string& path, std::map<std::string, TLinker_Section_Def>& sections) {
+
+		// open linker file
+		std::ifstream lf(path);
+		if (!lf.is_open()) {
+			return false;
+		}
+
+		// section definition regex - optionally followed by section attributes
+		std::regex sdefregex("[\\s]{0,}(section)[\\s]{0,}([a-zA-Z0-9_]+)\\((0x[0-9a-zA-Z]+|[0-9])\\)((?:[\\s]+[a-zA-Z_]+)*)[\\s]*", std::regex::ECMAScript | std::regex::icase);
+
+		// for each line...
+		std::string line;
+		while (std::getline(lf, line)) {
+
+			std::smatch sm;
+			if (std::regex_match(line, sm, sdefregex) && sm.size() == 5) {
+
+				const auto& sname = sm[2];
+				const auto& reloc = sm[3];
+
+				// parse section attributes
+				uint32_t flags = 0;
+				std::istringstream attrs(sm[4].str());
+				std::string attr;
+				while (attrs >> attr) {
+					if (attr == "exec") {
+						flags |= static_cast<uint32_t>(SObj::NSection_Flag::Exec);
+					}
+					else if (attr == "readonly") {
+						flags |= static_cast<uint32_t>(SObj::NSection_Flag::Read_Only);
+					}
+					else if (attr == "compress") {
+						flags |= static_cast<uint32_t>(SObj::NSection_Flag::Compressed);
+					}
+					else {
+						std::cerr << "Unknown section attribute '" << attr << "' of section " << sname << std::endl;
+						return false;
+					}
+				}
+
+				uint32_t relocAddr = 0;
+
+				try {
+
+					// hexa format
+					if (reloc.str().starts_with("0x") || reloc.str().starts_with("0X")) {
+						relocAddr = std::stol(reloc.str(), nullptr, 16);
+					}
+					// dec format
+					else {
+						relocAddr = std::stol(reloc.str(), nullptr, 10);
+					}
+
+					sections[sname.str()] = {
+						sname.str(),
+						relocAddr,
+						0, // TODO: limit
+						flags
+					};
+				}
+				catch (std::exception& /*ex*/) {
+					std::cerr << "Cannot parse relocation address: " << reloc << std::endl;
+				}
+			}
+
+		}
+
+		return true;
+	}
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <map>
+
+namespace sarch32 {
+
+	// definition of linker section (from the linker file)
+	struct TLinker_Section_Def {
+		std::string section{};
+		uint32_t startAddr = 0;
+		uint32_t limit = 0;
+		// section flags (SObj::NSection_Flag bitmask)
+		uint32_t flags = 0;
+	};
+
+	/*
+	 * Linker file (.sld) - one section definition per line, e.g., "section text(0x1000) exec readonly"
+	 */
+
+	// loads section definitions from given linker file; fails if the file cannot be opened or contains an unknown section attribute
+	bool Load_Linker_File(const std::string& path, std::map<std::string, TLinker_Section_Def>& sections);
+
+}
@@ -0,0 +1,150 @@
+#include "lockstep.h"
+
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+namespace sarch32 {
+
+	// formats memory write record to a stream
+	static void Format_Write(std::ostream& os, const TMemory_Write_Record& rec) {
+		os << "[0x" << std::hex << std::setw(8) << std::setfill('0') << rec.address << "] <-";
+		for (auto b : rec.data) {
+			os << " " << std::setw(2) << static_cast<uint32_t>(b);
+		}
+		os << std::dec;
+	}
+
+	CLockstep_Runner::CLockstep_Runner(CMachine& reference, CMachine& candidate) : mReference(reference), mCandidate(candidate) {
+		mReference.Get_Memory_Bus().Set_Write_Log(&mReference_Writes);
+		mCandidate.Get_Memory_Bus().Set_Write_Log(&mCandidate_Writes);
+	}
+
+	CLockstep_Runner::~CLockstep_Runner() {
+		mReference.Get_Memory_Bus().Set_Write_Log(nullptr);
+		mCandidate.Get_Memory_Bus().Set_Write_Log(nullptr);
+	}
+
+	bool CLockstep_Runner::Synchronize() {
+
+		mDivergence.clear();
+		mSteps = 0;
+
+		return mCandidate.Clone_State_From(mReference);
+	}
+
+	bool CLockstep_Runner::Step(size_t numberOfSteps, bool handleIRQs, size_t granularity) {
+
+		if (Has_Diverged()) {
+			return false;
+		}
+
+		granularity = std::max(granularity, static_cast<size_t>(1));
+
+		while (numberOfSteps > 0) {
+
+			const size_t chunk = std::min(numberOfSteps, granularity);
+
+			mReference_Writes.clear();
+			mCandidate_Writes.clear();
+
+			const size_t steps = mReference.Step(chunk, handleIRQs);
+			mCandidate.Step(chunk, handleIRQs);
+
+			mSteps += steps;
+			numberOfSteps -= chunk;
+
+			// a different number of steps executed by the candidate shows as a difference in cycle counts
+			if (!Compare()) {
+				return false;
+			}
+
+			// both machines stopped on a fault
+			if (steps < chunk) {
+				break;
+			}
+		}
+
+		return true;
+	}
+
+	bool CLockstep_Runner::Compare() {
+
+		const auto& refCtx = mReference.Get_CPU_Context();
+		const auto& candCtx = mCandidate.Get_CPU_Context();
+
+		// the machines are expected to agree - nothing is formatted then
+		bool same = mReference.Get_Cycle_Count() == mCandidate.Get_Cycle_Count() && mReference_Writes == mCandidate_Writes;
+		for (size_t i = 0; same && i < Register_Count; i++) {
+			same = refCtx.Reg(static_cast<NRegister>(i)) == candCtx.Reg(static_cast<NRegister>(i));
+		}
+		for (size_t i = 0; same && i < Processor_State_Register_Count; i++) {
+			same = refCtx.State(static_cast<NProcessor_State_Register>(i)) == candCtx.State(static_cast<NProcessor_State_Register>(i));
+		}
+
+		if (same) {
+			return true;
+		}
+
+		std::ostringstream os;
+
+		// registers
+		for (size_t i = 0; i < Register_Count; i++) {
+			const auto reg = static_cast<NRegister>(i);
+			if (refCtx.Reg(reg) != candCtx.Reg(reg)) {
+				os << "  " << Get_Register_Name(i) << ": 0x" << std::hex << std::setw(8) << std::setfill('0') << refCtx.Reg(reg)
+					<< " vs. 0x" << std::setw(8) << candCtx.Reg(reg) << std::dec << std::endl;
+			}
+		}
+
+		// state registers
+		for (size_t i = 0; i < Processor_State_Register_Count; i++) {
+			const auto reg = static_cast<NProcessor_State_Register>(i);
+			if (refCtx.State(reg) != candCtx.State(reg)) {
+				os << "  state register " << i << ": " << refCtx.State(reg) << " vs. " << candCtx.State(reg) << std::endl;
+			}
+		}
+
+		// cycle counters
+		if (mReference.Get_Cycle_Count() != mCandidate.Get_Cycle_Count()) {
+			os << "  cycles: " << mReference.Get_Cycle_Count() << " vs. " << mCandidate.Get_Cycle_Count() << std::endl;
+		}
+
+		// memory write streams
+		if (mReference_Writes != mCandidate_Writes) {
+			const size_t common = std::min(mReference_Writes.size(), mCandidate_Writes.size());
+			size_t first = 0;
+			while (first < common && mReference_Writes[first] == mCandidate_Writes[first]) {
+				first++;
+			}
+
+			os << "  memory write #" << first << ": ";
+			if (first < mReference_Writes.size()) {
+				Format_Write(os, mReference_Writes[first]);
+			}
+			else {
+				os << "(none)";
+			}
+			os << " vs. ";
+			if (first < mCandidate_Writes.size()) {
+				Format_Write(os, mCandidate_Writes[first]);
+			}
+			else {
+				os << "(none)";
+			}
+			os << std::endl;
+		}
+
+		if (os.tellp() == 0) {
+			return true;
+		}
+
+		std::ostringstream header;
+		header << "Divergence after " << mSteps << " steps (reference vs. candidate):" << std::endl;
+
+		mDivergence = header.str() + os.str();
+
+		return false;
+	}
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "machine.h"
+
+#include <string>
+#include <vector>
+
+namespace sarch32 {
+
+	/*
+	 * Lockstep runner
+	 *
+	 * Runs two machines (usually with different execution engines) side by side and compares their
+	 * architectural state - registers, state registers and the stream of memory writes - after every
+	 * stepping chunk. The first divergence stops the execution and is described in a readable form
+	 */
+	class CLockstep_Runner {
+
+		private:
+			// reference machine (its behavior is considered correct)
+			CMachine& mReference;
+			// candidate machine (compared against the reference)
+			CMachine& mCandidate;
+
+			// memory writes performed by each machine during the current chunk
+			std::vector<TMemory_Write_Record> mReference_Writes;
+			std::vector<TMemory_Write_Record> mCandidate_Writes;
+
+			// total number of instructions stepped in lockstep
+			uint64_t mSteps = 0;
+			// description of the first divergence; empty if none was found
+			std::string mDivergence;
+
+		protected:
+			// compares the state of both machines, fills divergence description if they differ
+			bool Compare();
+
+		public:
+			CLockstep_Runner(CMachine& reference, CMachine& candidate);
+			~CLockstep_Runner();
+
+			// copies the state of the reference machine into the candidate, so both start from the same point
+			bool Synchronize();
+
+			// steps both machines by given number of instructions, comparing the state after every chunk of given granularity;
+			// stops early if the machines stop on a fault (see CMachine::Set_Stop_On_Fault); returns false when the machines diverged
+			bool Step(size_t numberOfSteps, bool handleIRQs = false, size_t granularity = 1);
+
+			// have the machines diverged?
+			bool Has_Diverged() const {
+				return !mDivergence.empty();
+			}
+
+			// retrieves the description of the divergence
+			const std::string& Get_Divergence() const {
+				return mDivergence;
+			}
+
+			// retrieves the number of instructions stepped in lockstep
+			uint64_t Get_Step_Count() const {
+				return mSteps;
+			}
+	};
+
+}
@@ -0,0 +1,184 @@
+#include "sobjformat.h"
+
+#include <cstring>
+
+namespace SObj {
+
+	/*
+	 * LZ4 block format - sequences of a token (literal length, match length), literals and a match (offset, length)
+	 *
+	 * The compressor is a simple greedy one with a single hash table; it obeys the format end conditions
+	 * (the last match starts at least 12 bytes before the end, the last 5 bytes are always literals)
+	 */
+
+	// minimum match length
+	constexpr size_t LZ4_Min_Match = 4;
+	// no match may start within this distance from the end
+	constexpr size_t LZ4_MF_Limit = 12;
+	// the last bytes are always literals
+	constexpr size_t LZ4_Last_Literals = 5;
+	// maximum match offset
+	constexpr size_t LZ4_Max_Offset = 65535;
+	// hash table size (log2)
+	constexpr uint32_t LZ4_Hash_Log = 16;
+
+	// writes length continuation bytes (the part not fitting the token nibble)
+	static void Write_Length(std::vector<uint8_t>& out, size_t len) {
+		while (len >= 255) {
+			out.push_back(255);
+			len -= 255;
+		}
+		out.push_back(static_cast<uint8_t>(len));
+	}
+
+	// emits a sequence; matchLen is zero for the last sequence (literals only)
+	static void Emit_Sequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t litLen, size_t offset, size_t matchLen) {
+
+		const size_t matchCode = matchLen ? matchLen - LZ4_Min_Match : 0;
+
+		out.push_back(static_cast<uint8_t>(((litLen >= 15 ? 15 : litLen) << 4) | (matchCode >= 15 ? 15 : matchCode)));
+		if (litLen >= 15) {
+			Write_Length(out, litLen - 15);
+		}
+
+		out.insert(out.end(), literals, literals + litLen);
+
+		if (matchLen) {
+			out.push_back(static_cast<uint8_t>(offset & 0xFF));
+			out.push_back(static_cast<uint8_t>(offset >> 8));
+			if (matchCode >= 15) {
+				Write_Length(out, matchCode - 15);
+			}
+		}
+	}
+
+	std::vector<uint8_t> Compress_LZ4_Block(std::span<const uint8_t> src) {
+
+		std::vector<uint8_t> out;
+		out.reserve(src.size() / 2 + 16);
+
+		const uint8_t* base = src.data();
+		const size_t n = src.size();
+
+		size_t anchor = 0;
+
+		if (n > LZ4_MF_Limit) {
+
+			// positions are stored incremented by one, zero means empty slot
+			std::vector<uint32_t> table(1u << LZ4_Hash_Log, 0);
+
+			const size_t mfLimit = n - LZ4_MF_Limit;
+			const size_t matchLimit = n - LZ4_Last_Literals;
+
+			auto read32 = [base](size_t pos) {
+				uint32_t v;
+				std::memcpy(&v, base + pos, sizeof(v));
+				return v;
+			};
+
+			size_t ip = 0;
+			while (ip < mfLimit) {
+
+				const uint32_t seq = read32(ip);
+				const uint32_t h = (seq * 2654435761u) >> (32 - LZ4_Hash_Log);
+				const size_t cand = table[h];
+				table[h] = static_cast<uint32_t>(ip + 1);
+
+				if (cand == 0 || ip - (cand - 1) > LZ4_Max_Offset || read32(cand - 1) != seq) {
+					ip++;
+					continue;
+				}
+
+				const size_t match = cand - 1;
+
+				size_t len = LZ4_Min_Match;
+				while (ip + len < matchLimit && base[match + len] == base[ip + len]) {
+					len++;
+				}
+
+				Emit_Sequence(out, base + anchor, ip - anchor, ip - match, len);
+
+				ip += len;
+				anchor = ip;
+			}
+		}
+
+		// last literals
+		Emit_Sequence(out, base + anchor, n - anchor, 0, 0);
+
+		return out;
+	}
+
+	bool Decompress_LZ4_Block(std::span<const uint8_t> src, std::span<uint8_t> dst) {
+
+		size_t ip = 0;
+		size_t op = 0;
+
+		// reads length continuation bytes
+		auto readLength = [&src, &ip](size_t& len) {
+			uint8_t b;
+			do {
+				if (ip >= src.size()) {
+					return false;
+				}
+				b = src[ip++];
+				len += b;
+			} while (b == 255);
+			return true;
+		};
+
+		while (ip < src.size()) {
+
+			const uint8_t token = src[ip++];
+
+			// literals
+			size_t litLen = token >> 4;
+			if (litLen == 15 && !readLength(litLen)) {
+				return false;
+			}
+
+			if (litLen > src.size() - ip || litLen > dst.size() - op) {
+				return false;
+			}
+
+			std::memcpy(dst.data() + op, src.data() + ip, litLen);
+			ip += litLen;
+			op += litLen;
+
+			// the last sequence has no match
+			if (ip == src.size()) {
+				break;
+			}
+
+			// match
+			if (src.size() - ip < 2) {
+				return false;
+			}
+
+			const size_t offset = static_cast<size_t>(src[ip]) | (static_cast<size_t>(src[ip + 1]) << 8);
+			ip += 2;
+
+			if (offset == 0 || offset > op) {
+				return false;
+			}
+
+			size_t matchLen = token & 0xF;
+			if (matchLen == 15 && !readLength(matchLen)) {
+				return false;
+			}
+			matchLen += LZ4_Min_Match;
+
+			if (matchLen > dst.size() - op) {
+				return false;
+			}
+
+			// byte by byte - the match may overlap the output being produced
+			for (size_t i = 0; i < matchLen; i++, op++) {
+				dst[op] = dst[op - offset];
+			}
+		}
+
+		return op == dst.size();
+	}
+
+}
@@ -1,10 +1,12 @@
 #include "machine.h"
-#include "sobjfile.h"
+#include "sobjmapped.h"
 
 #include <algorithm>
 #include <iterator>
 #include <random>
 #include <iostream>
+#include <cstring>
+#include <functional>
 
 namespace sarch32 {
 
@@ -12,48 +14,109 @@ namespace sarch32 {
 	 * Memory bus
 	 ***********************************************************************************/
 
-	CMemory_Bus::CMemory_Bus(const uint32_t memSize) : mMain_Memory(memSize) {
+	// copies guest data from or to the guarded main memory; a fault in the guard region is turned into an exception thrown
+	// right from the signal handler, so the faulting access must be an inline load or store of this project (built with
+	// -fnon-call-exceptions) - never a libc call (e.g., memcpy), which has no unwind info for non-call exceptions
+	static inline void Guarded_Copy(uint8_t* target, const uint8_t* source, uint32_t size) {
+#if defined(__GNUC__)
+		// fixed-size builtins are always expanded inline
+		switch (size) {
+			case 1:
+				*target = *source;
+				return;
+			case 2: {
+				uint16_t value;
+				__builtin_memcpy(&value, source, sizeof(value));
+				__builtin_memcpy(target, &value, sizeof(value));
+				return;
+			}
+			case 4: {
+				uint32_t value;
+				__builtin_memcpy(&value, source, sizeof(value));
+				__builtin_memcpy(target, &value, sizeof(value));
+				return;
+			}
+		}
+#endif
+		// volatile accesses cannot be merged into a library call
+		const volatile uint8_t* src = source;
+		volatile uint8_t* dst = target;
+		for (uint32_t i = 0; i < size; i++) {
+			dst[i] = src[i];
+		}
+	}
+
+	CMemory_Bus::CMemory_Bus(const uint32_t memSize, NMemory_Mode mode) : mMain_Memory(memSize, mode == NMemory_Mode::Guarded), mGuarded(mMain_Memory.Is_Guarded()) {
 		//
 	}
 
 	void CMemory_Bus::Read(uint32_t address, void* target, uint32_t size) const {
 
 		// peripheral memory
-		for (auto mapping : mPeripheral_Memory) {
+		for (const auto& mapping : mPeripheral_Memory) {
 			if (address >= mapping.addressStart && address < mapping.addressStart + mapping.length) {
+				// plain memory is accessed directly
+				if (mapping.direct && size <= mapping.length - (address - mapping.addressStart)) {
+					std::memcpy(target, mapping.direct + (address - mapping.addressStart), size);
+					return;
+				}
 				return mapping.peripheral->Read_Memory(address, target, size);
 			}
 		}
 
+		// guarded memory - invalid access faults in the guard region and the fault is converted to abort_exception
+		if (mGuarded) {
+			Guarded_Copy(static_cast<uint8_t*>(target), mMain_Memory.Data() + address, size);
+			return;
+		}
+
 		// detect invalid memory access
-		if (static_cast<size_t>(address) + static_cast<size_t>(size) > mMain_Memory.size()) {
+		if (static_cast<size_t>(address) + static_cast<size_t>(size) > mMain_Memory.Size()) {
 			throw abort_exception{ address };
 		}
 
-		std::copy_n(mMain_Memory.begin() + address, size, static_cast<uint8_t*>(target));
+		std::copy_n(mMain_Memory.Data() + address, size, static_cast<uint8_t*>(target));
 	}
 
 	void CMemory_Bus::Write(uint32_t address, const void* source, uint32_t size) {
 
+		if (mWrite_Log) {
+			mWrite_Log->push_back({ address, std::vector<uint8_t>(static_cast<const uint8_t*>(source), static_cast<const uint8_t*>(source) + size) });
+		}
+
 		// peripheral memory
-		for (auto mapping : mPeripheral_Memory) {
+		for (const auto& mapping : mPeripheral_Memory) {
 			if (address >= mapping.addressStart && address < mapping.addressStart + mapping.length) {
+				// plain memory is accessed directly, the peripheral learns about the change from the dirty range when it asks
+				if (mapping.direct && size <= mapping.length - (address - mapping.addressStart)) {
+					std::memcpy(mapping.direct + (address - mapping.addressStart), source, size);
+					if (mapping.dirty) {
+						mapping.dirty->Mark(address - mapping.addressStart, size);
+					}
+					return;
+				}
 				return mapping.peripheral->Write_Memory(address, source, size);
 			}
 		}
 
+		// guarded memory - invalid access faults in the guard region and the fault is converted to abort_exception
+		if (mGuarded) {
+			Guarded_Copy(mMain_Memory.Data() + address, static_cast<const uint8_t*>(source), size);
+			return;
+		}
+
 		// detect invalid memory access
-		if (static_cast<size_t>(address) + static_cast<size_t>(size) > mMain_Memory.size()) {
+		if (static_cast<size_t>(address) + static_cast<size_t>(size) > mMain_Memory.Size()) {
 			throw abort_exception{ address };
 		}
 
-		std::copy_n(static_cast<const uint8_t*>(source), size, mMain_Memory.begin() + address);
+		std::copy_n(static_cast<const uint8_t*>(source), size, mMain_Memory.Data() + address);
 	}
 
 	bool CMemory_Bus::Map_Peripheral(std::shared_ptr<IPeripheral> peripheral, uint32_t address, uint32_t length) {
 
 		// detect overlaps
-		for (auto mapping : mPeripheral_Memory) {
+		for (const auto& mapping : mPeripheral_Memory) {
 			if (address >= mapping.addressStart && address < mapping.addressStart + mapping.length) {
 				return false;
 			}
@@ -62,10 +125,16 @@ namespace sarch32 {
 			}
 		}
 
+		// the peripheral may expose its memory to be accessed directly - it must cover the whole mapped region
+		const auto direct = peripheral->Get_Direct_Memory();
+		const bool isDirect = !direct.empty() && direct.size() >= length;
+
 		mPeripheral_Memory.push_back({
 			peripheral,
 			address,
-			length
+			length,
+			isDirect ? direct.data() : nullptr,
+			isDirect ? peripheral->Get_Dirty_Range_Tracker() : nullptr
 		});
 
 		return true;
@@ -85,20 +154,126 @@ namespace sarch32 {
 		return true;
 	}
 
-	bool CMemory_Bus::Load_Bytes_To(const std::vector<uint8_t>& bytes, uint32_t address) {
+	bool CMemory_Bus::Load_Bytes_To(std::span<const uint8_t> bytes, uint32_t address) {
 
-		if (static_cast<size_t>(address) + static_cast<size_t>(bytes.size()) > mMain_Memory.size()) {
+		if (static_cast<size_t>(address) + static_cast<size_t>(bytes.size()) > mMain_Memory.Size()) {
 			return false;
 		}
 
-		std::copy(bytes.begin(), bytes.end(), mMain_Memory.begin() + address);
+		std::copy(bytes.begin(), bytes.end(), mMain_Memory.Data() + address);
+		return true;
+	}
+
+	bool CMemory_Bus::Zero_Bytes_At(uint32_t address, uint32_t size) {
+
+		if (static_cast<size_t>(address) + static_cast<size_t>(size) > mMain_Memory.Size()) {
+			return false;
+		}
+
+		mMain_Memory.Clear_Range(address, size);
+		return true;
+	}
+
+	std::span<uint8_t> CMemory_Bus::Get_Main_Memory_Span(uint32_t address, uint32_t size) {
+
+		if (static_cast<size_t>(address) + static_cast<size_t>(size) > mMain_Memory.Size()) {
+			return {};
+		}
+
+		return std::span<uint8_t>(mMain_Memory.Data() + address, size);
+	}
+
+	TMemory_Region CMemory_Bus::Get_Region(uint32_t address, uint32_t maxSize) const {
+
+		uint64_t end = static_cast<uint64_t>(address) + maxSize;
+
+		// peripherals take precedence over the main memory
+		for (const auto& mapping : mPeripheral_Memory) {
+			if (address >= mapping.addressStart && address < mapping.addressStart + mapping.length) {
+				const uint32_t offset = address - mapping.addressStart;
+				const uint32_t size = static_cast<uint32_t>(std::min<uint64_t>(end, static_cast<uint64_t>(mapping.addressStart) + mapping.length) - address);
+
+				if (mapping.direct) {
+					return { address, size, NMemory_Region_Type::Peripheral_Memory, std::span<const uint8_t>(mapping.direct + offset, size) };
+				}
+
+				return { address, size, NMemory_Region_Type::Peripheral_IO, {} };
+			}
+
+			// the region ends where the next peripheral starts
+			if (mapping.addressStart > address) {
+				end = std::min<uint64_t>(end, mapping.addressStart);
+			}
+		}
+
+		if (address < mMain_Memory.Size()) {
+			const uint32_t size = static_cast<uint32_t>(std::min<uint64_t>(end, mMain_Memory.Size()) - address);
+			return { address, size, NMemory_Region_Type::Main_Memory, std::span<const uint8_t>(mMain_Memory.Data() + address, size) };
+		}
+
+		return { address, static_cast<uint32_t>(end - address), NMemory_Region_Type::Unmapped, {} };
+	}
+
+	std::span<const uint8_t> CMemory_Bus::Get_Span(uint32_t address, uint32_t size) const {
+
+		const auto region = Get_Region(address, size);
+		if (region.size != size || region.data.empty()) {
+			return {};
+		}
+
+		return region.data;
+	}
+
+	std::span<uint8_t> CMemory_Bus::Get_Writable_Span(uint32_t address, uint32_t size) {
+
+		const auto region = Get_Region(address, size);
+		if (region.size != size || region.data.empty()) {
+			return {};
+		}
+
+		// the writes through the view cannot be tracked, consider the whole view written
+		if (region.type == NMemory_Region_Type::Peripheral_Memory) {
+			for (const auto& mapping : mPeripheral_Memory) {
+				if (address >= mapping.addressStart && address < mapping.addressStart + mapping.length && mapping.dirty) {
+					mapping.dirty->Mark(address - mapping.addressStart, size);
+				}
+			}
+		}
+
+		// the region just views memory owned by this bus (or its peripherals) - no need to keep it read-only
+		return std::span<uint8_t>(const_cast<uint8_t*>(region.data.data()), region.data.size());
+	}
+
+	bool CMemory_Bus::Load_File_Bytes_To(std::span<const uint8_t> bytes, int fd, uint64_t fileOffset, uint32_t address) {
+
+		if (static_cast<size_t>(address) + static_cast<size_t>(bytes.size()) > mMain_Memory.Size()) {
+			return false;
+		}
+
+		// map what can be mapped, copy the rest
+		const size_t mapped = mMain_Memory.Map_File(address, fd, fileOffset, bytes.size());
+
+		return Load_Bytes_To(bytes.subspan(mapped), address + static_cast<uint32_t>(mapped));
+	}
+
+	bool CMemory_Bus::Share_Main_Memory(int fd, uint64_t offset) {
+		return mMain_Memory.Share(fd, offset);
+	}
+
+	bool CMemory_Bus::Copy_Main_Memory_From(const CMemory_Bus& other) {
+
+		if (other.mMain_Memory.Size() != mMain_Memory.Size()) {
+			return false;
+		}
+
+		std::copy_n(other.mMain_Memory.Data(), other.mMain_Memory.Size(), mMain_Memory.Data());
 		return true;
 	}
 
 	void CMemory_Bus::Clear_Main_Memory() {
 
-		// fill with zeroes - this is here for easier debugging
-		std::fill(mMain_Memory.begin(), mMain_Memory.end(), 0);
+		// fill with zeroes - this is here for easier debugging; the pages are returned to the host and zeroed on the next touch
+		mMain_Memory.Clear();
 
 		// fill with random data - more likely to be the real scenario, disabled during debugging phase
 		/*
@@ -106,7 +281,7 @@ namespace sarch32 {
 		std::default_random_engine randomEngine(r());
 		std::uniform_int_distribution<int> uniformDist(std::numeric_limits<uint8_t>::min(), std::numeric_limits<uint8_t>::max());
 
-		std::generate(mMain_Memory.begin(), mMain_Memory.end(), [&uniformDist, &randomEngine]() {
+		std::generate(mMain_Memory.Data(), mMain_Memory.Data() + mMain_Memory.Size(), [&uniformDist, &randomEngine]() {
 			return (uint8_t)uniformDist(randomEngine);
 		});
 		*/
@@ -136,26 +311,181 @@ namespace sarch32 {
 	 * Machine
 	 ***********************************************************************************/
 
-	CMachine::CMachine(uint32_t memory_size) : mMem_Bus(memory_size), mContext(mMem_Bus), mInterrupt_Ctl{ std::make_shared<CInterrupt_Controller>() } {
-		//
+	CMachine::CMachine(uint32_t memory_size, NMemory_Mode memoryMode) : mMem_Bus(memory_size, memoryMode), mContext(mMem_Bus), mInterrupt_Ctl{ std::make_shared<CInterrupt_Controller>() }, mCoverage(memory_size) {
+		Select_Run_Loop();
+	}
+
+	// hashes the section as stored in the object file, including its placement and flags
+	static uint64_t Hash_Loaded_Section(const SObj::TSection_View& s) {
+		const uint32_t header[] = { s.startAddr, s.size, s.flags };
+		const uint64_t hash = SObj::Hash_FNV1a_64(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(header), sizeof(header)));
+		return SObj::Hash_FNV1a_64(s.data, hash);
+	}
+
+	bool CMachine::Init_Memory_From_File(const std::string& sobjFile, bool verify) {
+
+		// map object file - the sections are not copied anywhere before they reach the main memory
+		SObj::CSObj_Mapped_File infile;
+		if (!infile.Open(sobjFile)) {
+			return false;
+		}
+
+		if (verify && !infile.Verify()) {
+			std::cerr << "Object file " << sobjFile << " is corrupted (content hash mismatch)" << std::endl;
+			return false;
+		}
+
+		mLoaded_Sections.clear();
+
+		// missing or malformed metadata are not fatal, the image itself may still be fine
+		if (!mSymbols.Load(infile)) {
+			std::cerr << "Could not load symbols from " << sobjFile << std::endl;
+			mSymbols.Clear();
+		}
+
+		for (auto& s : infile.Get_Sections()) {
+
+			// metadata sections are not loaded to memory
+			if (SObj::Has_Flag(s.flags, SObj::NSection_Flag::Metadata)) {
+				continue;
+			}
+
+			bool result;
+
+			// zero-filled sections have no payload
+			if (SObj::Has_Flag(s.flags, SObj::NSection_Flag::Zero_Fill)) {
+				result = mMem_Bus.Zero_Bytes_At(s.startAddr, s.size);
+			}
+			// compressed sections are decompressed straight to the main memory
+			else if (SObj::Has_Flag(s.flags, SObj::NSection_Flag::Compressed)) {
+				auto target = mMem_Bus.Get_Main_Memory_Span(s.startAddr, s.size);
+				result = (target.size() == s.size) && infile.Read_Section(s, target);
+			}
+			// map all other sections to their respective addresses
+			else {
+				result = mMem_Bus.Load_File_Bytes_To(s.data, infile.Get_File_Descriptor(), s.fileOffset, s.startAddr);
+			}
+
+			if (!result) {
+				return false;
+			}
+
+			mLoaded_Sections.push_back({ s.name, s.startAddr, s.size, Hash_Loaded_Section(s) });
+		}
+
+		return true;
 	}
 
-	bool CMachine::Init_Memory_From_File(const std::string& sobjFile) {
+	bool CMachine::Reload_Image(const std::string& sobjFile, bool resetCpu, TReload_Stats* stats) {
+
+		SObj::CSObj_Mapped_File infile;
+		if (!infile.Open(sobjFile)) {
+			return false;
+		}
 
-		// load object file
-		SObj::CSObj_File infile;
-		if (!infile.Load_From_File(sobjFile)) {
+		// the file may be caught in the middle of being written
+		if (!infile.Verify()) {
+			std::cerr << "Object file " << sobjFile << " is corrupted (content hash mismatch)" << std::endl;
 			return false;
 		}
 
-		// retrieve sections
-		auto sections = infile.Get_Sections();
+		TReload_Stats result;
+		std::vector<TLoaded_Section> loaded;
 
-		for (auto& s : sections) {
-			// map all sections to their respective addresses
-			if (!mMem_Bus.Load_Bytes_To(s.second.data, s.second.startAddr)) {
+		// section to be compared with the memory
+		struct TPending_Section {
+			uint32_t startAddr;
+			std::span<const uint8_t> contents;
+			std::span<uint8_t> target;
+		};
+
+		std::vector<TPending_Section> pending;
+		std::vector<std::vector<uint8_t>> buffers;
+		buffers.reserve(infile.Get_Sections().size());
+
+		// 1) check the whole image first, so a bad one leaves the memory intact
+		for (auto& s : infile.Get_Sections()) {
+
+			if (SObj::Has_Flag(s.flags, SObj::NSection_Flag::Metadata)) {
+				continue;
+			}
+
+			const uint64_t hash = Hash_Loaded_Section(s);
+			loaded.push_back({ s.name, s.startAddr, s.size, hash });
+
+			// the section did not change since the last load - unless the CPU is reset, leave the memory as it is (the guest
+			// may have modified it in the meantime); a reset restores the whole image
+			auto prev = std::find_if(mLoaded_Sections.begin(), mLoaded_Sections.end(), [&s](const TLoaded_Section& ls) { return ls.name == s.name; });
+			const bool unchanged = (prev != mLoaded_Sections.end() && prev->startAddr == s.startAddr && prev->size == s.size && prev->contentHash == hash);
+			if (unchanged && !resetCpu) {
+				continue;
+			}
+
+			if (!unchanged) {
+				result.changedSections++;
+			}
+
+			auto target = mMem_Bus.Get_Main_Memory_Span(s.startAddr, s.size);
+			if (target.size() != s.size) {
+				std::cerr << "Section " << s.name << " does not fit to the main memory" << std::endl;
 				return false;
 			}
+
+			// raw sections are compared right in the mapped file, the others are materialized first
+			std::span<const uint8_t> contents = s.data;
+			if (SObj::Has_Flag(s.flags, SObj::NSection_Flag::Zero_Fill) || SObj::Has_Flag(s.flags, SObj::NSection_Flag::Compressed)) {
+				auto& buffer = buffers.emplace_back(s.size);
+				if (!infile.Read_Section(s, buffer)) {
+					std::cerr << "Could not read section " << s.name << std::endl;
+					return false;
+				}
+				contents = buffer;
+			}
+
+			pending.push_back({ s.startAddr, contents, target });
+		}
+
+		// sections no longer present in the image are left in the memory as they are, they are just not tracked anymore
+		for (auto& ls : mLoaded_Sections) {
+			if (std::none_of(loaded.begin(), loaded.end(), [&ls](const TLoaded_Section& l) { return l.name == ls.name; })) {
+				result.droppedSections++;
+			}
+		}
+
+		// 2) patch runs of differing bytes
+		for (auto& p : pending) {
+
+			auto cur = std::make_pair(p.contents.begin(), p.target.begin());
+			while (true) {
+				cur = std::mismatch(cur.first, p.contents.end(), cur.second, p.target.end());
+				if (cur.first == p.contents.end()) {
+					break;
+				}
+
+				const auto runEnd = std::mismatch(cur.first, p.contents.end(), cur.second, p.target.end(), std::not_equal_to<uint8_t>{});
+				const auto length = static_cast<uint32_t>(runEnd.first - cur.first);
+				const auto address = p.startAddr + static_cast<uint32_t>(cur.first - p.contents.begin());
+
+				std::copy(cur.first, runEnd.first, cur.second);
+				Invalidate_Decoded_Range(address, length);
+
+				result.patchedBytes += length;
+				cur = runEnd;
+			}
+		}
+
+		mLoaded_Sections = std::move(loaded);
+
+		if (!mSymbols.Load(infile)) {
+			mSymbols.Clear();
+		}
+
+		if (resetCpu) {
+			Reset(true);
+		}
+
+		if (stats) {
+			*stats = result;
 		}
 
 		return true;
@@ -163,6 +493,11 @@ namespace sarch32 {
 
 	void CMachine::Reset(bool warm) {
 
+		// cold reset brings the register file to its power-on state
+		if (!warm) {
+			mContext.Reset();
+		}
+
 		mContext.Reg(NRegister::PC) = Reset_Vector;		// reset PC to a reset vector
 		mContext.Reg(NRegister::FLG) = 0;				// reset flags
 
@@ -174,12 +509,207 @@ namespace sarch32 {
 		if (!warm) {
 			mMem_Bus.Clear_Main_Memory();
 		}
+
+		// the execution continues at the reset vector, not in the block being executed
+		for (auto p : mPlugins.block) {
+			p->On_Block_Enter(Reset_Vector);
+		}
 	}
 
-	void CMachine::Step(size_t numberOfSteps, bool handleIRQs) {
+	bool CMachine::Enable_State_Export(const std::string& name) {
+
+		auto state = std::make_unique<CShared_State>();
+		if (!state->Create(name, mMem_Bus.Get_Main_Memory_Size())) {
+			return false;
+		}
+
+		if (!mMem_Bus.Share_Main_Memory(state->Get_File_Descriptor(), state->Get_Memory_Offset())) {
+			std::cerr << "Could not place main memory to shared memory object " << name << std::endl;
+			return false;
+		}
+
+		mShared_State = std::move(state);
+		mShared_State->Publish(mContext, mCycle_Count);
+
+		return true;
+	}
+
+	void CMachine::Set_Execution_Engine(NExecution_Engine engine) {
+
+		mEngine = engine;
+
+		// the cache is allocated only when needed
+		if (mEngine == NExecution_Engine::Predecoded) {
+			mPredecoded.resize(mMem_Bus.Get_Main_Memory_Size() / 4);
+		}
+		else {
+			mPredecoded.clear();
+			mPredecoded.shrink_to_fit();
+		}
+	}
+
+	void CMachine::Invalidate_Decoded_Range(uint32_t address, uint32_t size) {
+
+		const size_t first = address / 4;
+		const size_t last = std::min(mPredecoded.size(), (static_cast<size_t>(address) + size + 3) / 4);
+
+		for (size_t i = first; i < last; i++) {
+			mPredecoded[i].instr.reset();
+		}
+	}
+
+	bool CMachine::Clone_State_From(const CMachine& other) {
+
+		if (!mMem_Bus.Copy_Main_Memory_From(other.mMem_Bus)) {
+			return false;
+		}
+
+		mContext.Copy_State_From(other.mContext);
+		mCycle_Count = other.mCycle_Count;
+
+		return true;
+	}
+
+	const CInstruction* CMachine::Decode(uint32_t address, uint32_t encoded, std::unique_ptr<CInstruction>& holder) {
+
+		// predecoded engine - reuse the cached instruction if the memory still holds the same word
+		if (mEngine == NExecution_Engine::Predecoded && address / 4 < mPredecoded.size()) {
+
+			auto& entry = mPredecoded[address / 4];
+			if (!entry.instr || entry.encoded != encoded) {
+				entry.encoded = encoded;
+				entry.instr = CInstruction::Build_From_Binary(encoded);
+			}
+
+			return entry.instr.get();
+		}
+
+		// reference interpreter (and instructions fetched outside main memory)
+		holder = CInstruction::Build_From_Binary(encoded);
+		return holder.get();
+	}
+
+	void CMachine::Attach_Plugin(IMachine_Plugin& plugin) {
+		if (std::find(mPlugins.all.begin(), mPlugins.all.end(), &plugin) == mPlugins.all.end()) {
+			mPlugins.all.push_back(&plugin);
+			Select_Run_Loop();
+		}
+	}
+
+	void CMachine::Detach_Plugin(IMachine_Plugin& plugin) {
+		std::erase(mPlugins.all, &plugin);
+		Select_Run_Loop();
+	}
+
+	void CMachine::Select_Run_Loop() {
+
+		mPlugins.retire.clear();
+		mPlugins.memory.clear();
+		mPlugins.block.clear();
+		mPlugins.kinds = 0;
+
+		for (auto p : mPlugins.all) {
+			const uint32_t kinds = p->Get_Hook_Kinds();
+			if (kinds & static_cast<uint32_t>(NHook_Kind::Instruction_Retire)) {
+				mPlugins.retire.push_back(p);
+			}
+			if (kinds & static_cast<uint32_t>(NHook_Kind::Memory_Access)) {
+				mPlugins.memory.push_back(p);
+			}
+			if (kinds & static_cast<uint32_t>(NHook_Kind::Block_Enter)) {
+				mPlugins.block.push_back(p);
+			}
+			mPlugins.kinds |= kinds;
+		}
+
+		// one loop instance per combination of hook kinds, indexed by the NHook_Kind flags
+		static constexpr TRun_Loop Plugin_Loops[Hook_Kind_Combinations] = {
+			&CMachine::Run_Loop<CPlugin_Hooks<0>>,
+			&CMachine::Run_Loop<CPlugin_Hooks<1>>,
+			&CMachine::Run_Loop<CPlugin_Hooks<2>>,
+			&CMachine::Run_Loop<CPlugin_Hooks<3>>,
+			&CMachine::Run_Loop<CPlugin_Hooks<4>>,
+			&CMachine::Run_Loop<CPlugin_Hooks<5>>,
+			&CMachine::Run_Loop<CPlugin_Hooks<6>>,
+			&CMachine::Run_Loop<CPlugin_Hooks<7>>,
+		};
+
+		mRun_Loop = mPlugins.all.empty() ? &CMachine::Run_Loop<CNo_Hooks> : Plugin_Loops[mPlugins.kinds & (Hook_Kind_Combinations - 1)];
+	}
+
+	void CMachine::Set_Coverage_Enabled(bool enabled) {
+
+		mCoverage_Enabled = enabled;
+
+		if (enabled) {
+			// the recording starts in the block being executed
+			mCoverage.Record_Block(mContext.Reg(NRegister::PC));
+			Attach_Plugin(mCoverage);
+		}
+		else {
+			Detach_Plugin(mCoverage);
+		}
+	}
+
+	void CMachine::Set_Profiling_Enabled(bool enabled) {
+
+		mProfiling_Enabled = enabled;
+
+		if (enabled) {
+			Attach_Plugin(mProfile);
+		}
+		else {
+			Detach_Plugin(mProfile);
+		}
+	}
+
+	size_t CMachine::Step(size_t numberOfSteps, bool handleIRQs) {
+
+		const size_t steps = (this->*mRun_Loop)(numberOfSteps, handleIRQs);
+
+		if (mShared_State) {
+			mShared_State->Publish(mContext, mCycle_Count);
+		}
+
+		return steps;
+	}
+
+	template<typename THooks>
+	size_t CMachine::Run_Loop(size_t numberOfSteps, bool handleIRQs) {
+
+		THooks hooks(mPlugins);
+
+		if constexpr (THooks::Has_Memory_Hooks) {
+			// guest memory accesses are routed through the hooked proxy bus for the duration of the loop
+			CHooked_Bus<THooks> hookedBus(mMem_Bus, hooks);
+			mContext.Set_Bus(hookedBus);
+
+			// restores the original bus on every way out of the loop
+			struct TBus_Restore {
+				CCPU_Context& ctx;
+				IBus& bus;
+				~TBus_Restore() {
+					ctx.Set_Bus(bus);
+				}
+			} busRestore{ mContext, mMem_Bus };
+
+			return Step_With_Hooks(hooks, numberOfSteps, handleIRQs);
+		}
+		else {
+			return Step_With_Hooks(hooks, numberOfSteps, handleIRQs);
+		}
+	}
+
+	template<typename THooks>
+	size_t CMachine::Step_With_Hooks(THooks& hooks, size_t numberOfSteps, bool handleIRQs) {
 
 		for (size_t i = 0; i < numberOfSteps; i++) {
 
+			// currently executed instruction and its address
+			std::unique_ptr<CInstruction> holder;
+			const CInstruction* instr = nullptr;
+			uint32_t pc = 0;
+
 			try {
 
 				/*
@@ -190,6 +720,7 @@ namespace sarch32 {
 				for (auto p : mPeripherals) {
 					p->Clock_Cycles_Passed(Default_Mean_CPI);
 				}
+				mCycle_Count += Default_Mean_CPI;
 
 				// has pending IRQ? signalize
 				if (handleIRQs && mInterrupt_Ctl->Has_Pending_IRQ(IRQ_Channel_Any)) {
@@ -205,7 +736,9 @@ namespace sarch32 {
 
 				// 1) fetch
 				try {
-					encoded = mContext.Mem_Read_Scalar<uint32_t>(mContext.Reg(NRegister::PC));
+					pc = mContext.Reg(NRegister::PC);
+					// instruction fetches go directly to the bus, they are not reported to memory hooks
+					mMem_Bus.Read(pc, &encoded, sizeof(uint32_t));
 					mContext.Reg(NRegister::PC) += 4;
 				}
 				catch (abort_exception& /*ex*/) {
@@ -218,7 +751,7 @@ namespace sarch32 {
 				}
 
 				// 2) decode
-				auto instr = CInstruction::Build_From_Binary(encoded);
+				instr = Decode(pc, encoded, holder);
 				if (instr) {
 					//std::cout << "EXEC: " << instr->Generate_String() << std::endl;
 
@@ -227,6 +760,15 @@ namespace sarch32 {
 					if (!instr->Execute(mContext)) {
 						std::cerr << "Could not execute instruction: " << instr->Generate_String() << std::endl;
 					}
+
+					hooks.On_Instruction_Retire(mContext, pc, *instr);
+
+					// a new block is entered just by a taken transfer of control
+					if constexpr (THooks::Has_Block_Hooks) {
+						if (mContext.Reg(NRegister::PC) != pc + 4) {
+							hooks.On_Block_Enter(mContext.Reg(NRegister::PC));
+						}
+					}
 				}
 				else {
 					throw undefined_instruction_exception();
@@ -236,53 +778,92 @@ namespace sarch32 {
 			catch (reset_exception& /*ex*/) {
 				mContext.Reg(NRegister::RA) = mContext.Reg(NRegister::PC);
 
+				hooks.On_Trap(mContext, NIVT_Entry::Reset);
+
 				// load interrupt vector from memory
 				uint32_t addr = 0;
 				mMem_Bus.Read(Get_IVT_Vector_Address(NIVT_Entry::Reset), &addr, sizeof(uint32_t));
 				mContext.Reg(NRegister::PC) = addr;
+				hooks.On_Block_Enter(addr);
 			}
 			catch (undefined_instruction_exception& /*ex*/) {
 				mContext.Reg(NRegister::RA) = mContext.Reg(NRegister::PC);
 
+				hooks.On_Trap(mContext, NIVT_Entry::Undefined);
+
 				// load interrupt vector from memory
 				uint32_t addr = 0;
 				mMem_Bus.Read(Get_IVT_Vector_Address(NIVT_Entry::Undefined), &addr, sizeof(uint32_t));
 				mContext.Reg(NRegister::PC) = addr;
+				hooks.On_Block_Enter(addr);
+
+				if (mStop_On_Fault) {
+					return i;
+				}
 			}
 			catch (abort_exception& /*ex*/) {
 				mContext.Reg(NRegister::RA) = mContext.Reg(NRegister::PC);
 
+				hooks.On_Trap(mContext, NIVT_Entry::Abort);
+
 				// load interrupt vector from memory
 				uint32_t addr = 0;
 				mMem_Bus.Read(Get_IVT_Vector_Address(NIVT_Entry::Abort), &addr, sizeof(uint32_t));
 				mContext.Reg(NRegister::PC) = addr;
+				hooks.On_Block_Enter(addr);
+
+				if (mStop_On_Fault) {
+					return i;
+				}
 			}
 			catch (unaligned_exception& /*ex*/) {
 				mContext.Reg(NRegister::RA) = mContext.Reg(NRegister::PC);
 
+				hooks.On_Trap(mContext, NIVT_Entry::Unaligned);
+
 				// load interrupt vector from memory
 				uint32_t addr = 0;
 				mMem_Bus.Read(Get_IVT_Vector_Address(NIVT_Entry::Unaligned), &addr, sizeof(uint32_t));
 				mContext.Reg(NRegister::PC) = addr;
+				hooks.On_Block_Enter(addr);
+
+				if (mStop_On_Fault) {
+					return i;
+				}
 			}
 			catch (irq_exception& /*ex*/) {
 				mContext.Reg(NRegister::RA) = mContext.Reg(NRegister::PC);
 
+				hooks.On_IRQ(mContext);
+
 				// load interrupt vector from memory
 				uint32_t addr = 0;
 				mMem_Bus.Read(Get_IVT_Vector_Address(NIVT_Entry::IRQ), &addr, sizeof(uint32_t));
 				mContext.Reg(NRegister::PC) = addr;
+				hooks.On_Block_Enter(addr);
 			}
-			catch (supervisor_call_exception& /*ex*/) {
+			catch (supervisor_call_exception& ex) {
+
+				// trace markers are handled inline - just record them, PC already points to the next instruction
+				if (Is_Trace_Svc_Number(ex.Get_Svc_Number())) {
+					mTrace_Buffer.Record(ex.Get_Svc_Number(), mCycle_Count, mContext.Reg(NRegister::PC), mContext.Reg(NRegister::R0));
+					hooks.On_Instruction_Retire(mContext, pc, *instr);
+					continue;
+				}
+
 				mContext.Reg(NRegister::RA) = mContext.Reg(NRegister::PC);
 
+				hooks.On_Trap(mContext, NIVT_Entry::Supervisor_Call);
+
 				// load interrupt vector from memory
 				uint32_t addr = 0;
 				mMem_Bus.Read(Get_IVT_Vector_Address(NIVT_Entry::Supervisor_Call), &addr, sizeof(uint32_t));
 				mContext.Reg(NRegister::PC) = addr;
+				hooks.On_Block_Enter(addr);
 			}
 		}
 
+		return numberOfSteps;
 	}
 
 }
@@ -1,7 +1,15 @@
 #pragma once
 
 #include "isa.h"
+#include "trace.h"
+#include "coverage.h"
+#include "profile.h"
+#include "hooks.h"
+#include "host_memory.h"
+#include "symbols.h"
+#include "shared_state.h"
 #include <fstream>
+#include <span>
 
 namespace sarch32 {
 
@@ -17,6 +25,41 @@ namespace sarch32 {
 	template<typename T>
 	concept Child_Of_IPeripheral = std::derived_from<T, IPeripheral>;
 
+	// record of a single memory bus write (used for comparing write streams)
+	struct TMemory_Write_Record {
+		uint32_t address;
+		std::vector<uint8_t> data;
+
+		bool operator==(const TMemory_Write_Record&) const = default;
+	};
+
+	/*
+	 * Main memory access modes
+	 */
+	enum class NMemory_Mode {
+		Checked,	// every access is bounds-checked
+		Guarded,	// accesses are not checked, the memory is followed by host guard region (falls back to checked, if unavailable)
+	};
+
+	/*
+	 * Type of a contiguous guest memory region
+	 */
+	enum class NMemory_Region_Type {
+		Main_Memory,		// main memory
+		Peripheral_Memory,	// plain memory of a peripheral (host backed)
+		Peripheral_IO,		// peripheral memory without host backing - accessible through the bus only
+		Unmapped,			// nothing is there
+	};
+
+	// contiguous guest memory region
+	struct TMemory_Region {
+		uint32_t address;
+		uint32_t size;
+		NMemory_Region_Type type;
+		// host view of the region (empty for peripheral I/O and unmapped regions)
+		std::span<const uint8_t> data;
+	};
+
 	/*
 	 * Used memory bus
 	 * 
@@ -25,26 +68,80 @@ namespace sarch32 {
 	class CMemory_Bus : public IBus
 	{
 		private:
-			// main memory vector
-			std::vector<uint8_t> mMain_Memory;
+			// main memory block, committed lazily by the host
+			CHost_Memory mMain_Memory;
+			// is the main memory guarded? (cached from the memory block)
+			const bool mGuarded;
 
 			// structure for peripheral memory mapping
 			struct TPeripheral_Mapping {
 				std::shared_ptr<IPeripheral> peripheral;
 				uint32_t addressStart;
 				uint32_t length;
+				// host memory backing the region, if the peripheral memory behaves as plain memory (nullptr otherwise)
+				uint8_t* direct = nullptr;
+				// dirty range tracker of the direct memory
+				CDirty_Range_Tracker* dirty = nullptr;
 			};
 
 			// a vector of peripheral memory mapping
 			std::vector<TPeripheral_Mapping> mPeripheral_Memory;
 
+			// write log - if set, every write is recorded here
+			std::vector<TMemory_Write_Record>* mWrite_Log = nullptr;
+
 		public:
-			CMemory_Bus(const uint32_t memSize);
+			CMemory_Bus(const uint32_t memSize, NMemory_Mode mode = NMemory_Mode::Checked);
+
+			// retrieves the effective main memory access mode
+			NMemory_Mode Get_Memory_Mode() const {
+				return mMain_Memory.Is_Guarded() ? NMemory_Mode::Guarded : NMemory_Mode::Checked;
+			}
+
+			// retrieves the size of main memory
+			uint32_t Get_Main_Memory_Size() const {
+				return static_cast<uint32_t>(mMain_Memory.Size());
+			}
+
+			// copies main memory contents from other bus (of the same memory size)
+			bool Copy_Main_Memory_From(const CMemory_Bus& other);
+
+			// sets the write log (nullptr disables logging)
+			void Set_Write_Log(std::vector<TMemory_Write_Record>* log) {
+				mWrite_Log = log;
+			}
 
 			// loads bytes given as argument to given address
-			bool Load_Bytes_To(const std::vector<uint8_t>& bytes, uint32_t address);
+			bool Load_Bytes_To(std::span<const uint8_t> bytes, uint32_t address);
+			// zeroes given range of main memory
+			bool Zero_Bytes_At(uint32_t address, uint32_t size);
+			// retrieves writable view of given main memory range; empty, if the range is out of main memory
+			std::span<uint8_t> Get_Main_Memory_Span(uint32_t address, uint32_t size);
+
+			// retrieves the region starting at given address, at most of given size
+			TMemory_Region Get_Region(uint32_t address, uint32_t maxSize) const;
+			// retrieves read-only view of given guest memory range; empty, if the range is not contained in a single host backed region
+			std::span<const uint8_t> Get_Span(uint32_t address, uint32_t size) const;
+			// retrieves writable view of given guest memory range (peripheral memory is marked dirty as a whole); empty, if not possible
+			std::span<uint8_t> Get_Writable_Span(uint32_t address, uint32_t size);
+
+			// calls given function for every region of given guest memory range, in ascending order
+			template<typename TFunc>
+			void For_Each_Region(uint32_t address, uint32_t size, TFunc&& func) const {
+				uint64_t cur = address;
+				const uint64_t end = static_cast<uint64_t>(address) + size;
+				while (cur < end) {
+					const auto region = Get_Region(static_cast<uint32_t>(cur), static_cast<uint32_t>(end - cur));
+					func(region);
+					cur += region.size;
+				}
+			}
+			// loads bytes of a file (given also as a span) to given address; maps the file pages copy-on-write when possible, copies otherwise
+			bool Load_File_Bytes_To(std::span<const uint8_t> bytes, int fd, uint64_t fileOffset, uint32_t address);
 			// clears main memory
 			void Clear_Main_Memory();
+			// backs main memory by given shared object at given offset (see CHost_Memory::Share); the contents are discarded
+			bool Share_Main_Memory(int fd, uint64_t offset);
 
 			// IBus iface
 			virtual void Read(uint32_t address, void* target, uint32_t size) const override;
@@ -86,6 +183,24 @@ namespace sarch32 {
 			virtual void Clear_Memory_Changed_Flag() = 0;
 	};
 
+	/*
+	 * Available execution engines
+	 */
+	enum class NExecution_Engine {
+		Interpreter,	// reference interpreter - decodes every fetched instruction
+		Predecoded,		// caches decoded instructions per address, the cache entry is validated by the fetched word
+	};
+
+	// outcome of an image reload
+	struct TReload_Stats {
+		// number of sections that changed since the last load
+		size_t changedSections = 0;
+		// number of bytes written to the memory
+		size_t patchedBytes = 0;
+		// number of previously loaded sections missing in the reloaded image
+		size_t droppedSections = 0;
+	};
+
 	/*
 	 * Default reference SArch32 machine
 	 */
@@ -100,17 +215,112 @@ namespace sarch32 {
 
 			std::list<std::shared_ptr<IPeripheral>> mPeripherals;
 
+			// number of clock cycles passed since the machine creation
+			uint64_t mCycle_Count = 0;
+			// buffer of guest-emitted trace records
+			CTrace_Buffer mTrace_Buffer;
+
+			// sections loaded from the object file
+			std::vector<TLoaded_Section> mLoaded_Sections;
+			// symbols and source lines of the loaded object file (if it contains them)
+			CSymbol_Index mSymbols;
+
+			// is the coverage recording enabled?
+			bool mCoverage_Enabled = false;
+			// block coverage map
+			CCoverage_Map mCoverage;
+
+			// is the execution profiling enabled?
+			bool mProfiling_Enabled = false;
+			// execution profile
+			CExecution_Profile mProfile;
+
+			// attached instrumentation plugins (not owned)
+			TAttached_Plugins mPlugins;
+
+			// the run loop instantiated for the hook kinds needed by the attached plugins
+			using TRun_Loop = size_t (CMachine::*)(size_t, bool);
+			TRun_Loop mRun_Loop = nullptr;
+
+			// used execution engine
+			NExecution_Engine mEngine = NExecution_Engine::Interpreter;
+
+			// does the stepping stop once a fault handler (abort, undefined instruction, unaligned access) is entered?
+			bool mStop_On_Fault = false;
+
+			// predecoded instruction cache entry
+			struct TPredecoded_Entry {
+				uint32_t encoded = 0;
+				std::unique_ptr<CInstruction> instr;
+			};
+
+			// predecoded instruction cache, one entry per main memory word
+			std::vector<TPredecoded_Entry> mPredecoded;
+
+			// exported machine state (memory and register snapshots), if enabled
+			std::unique_ptr<CShared_State> mShared_State;
+
+		protected:
+			// decodes instruction fetched from given address using the selected engine; temporary instances are held in the holder
+			const CInstruction* Decode(uint32_t address, uint32_t encoded, std::unique_ptr<CInstruction>& holder);
+
+			// the run loop itself, instantiated for every hook policy; returns the number of steps completed
+			template<typename THooks>
+			size_t Step_With_Hooks(THooks& hooks, size_t numberOfSteps, bool handleIRQs);
+			// sets up the hooks of given policy (and the hooked bus, if the policy has memory hooks) and runs the loop
+			template<typename THooks>
+			size_t Run_Loop(size_t numberOfSteps, bool handleIRQs);
+			// sorts the attached plugins by the hooks they need and selects the run loop instance
+			void Select_Run_Loop();
+
 		public:
-			CMachine(uint32_t memory_size = Default_Memory_Size);
+			CMachine(uint32_t memory_size = Default_Memory_Size, NMemory_Mode memoryMode = NMemory_Mode::Checked);
 			virtual ~CMachine() = default;
 
-			// initializes memory from object file
-			bool Init_Memory_From_File(const std::string& sobjFile);
+			// initializes memory from object file; v2 content hash is checked if requested (this reads the whole file)
+			bool Init_Memory_From_File(const std::string& sobjFile, bool verify = false);
+			// reloads a rebuilt object file into the running machine - sections which changed since the last load (all sections, if the CPU
+			// is reset) are compared to the memory and just the differing bytes are written (and their decoded instructions invalidated);
+			// the whole image is checked before anything is written, so a failed reload leaves the memory intact; memory of sections
+			// dropped from the image is left as it is; the CPU is warm reset, if requested
+			bool Reload_Image(const std::string& sobjFile, bool resetCpu, TReload_Stats* stats = nullptr);
 			// resets the CPU
 			void Reset(bool warm = true);
 
-			// steps the CPU by given number of steps
-			void Step(size_t numberOfSteps = 1, bool handleIRQs = false);
+			// steps the CPU by given number of steps; the run loop instance is selected when plugins are attached or detached,
+			// so stepping does not check for hooks at all; returns the number of steps completed - less than requested only when
+			// stopped on a fault (the step that entered the fault handler is not counted then)
+			size_t Step(size_t numberOfSteps = 1, bool handleIRQs = false);
+
+			// stops the stepping once a fault handler (abort, undefined instruction, unaligned access) is entered, e.g. for fuzzing,
+			// where random images fault almost immediately and the handler addresses are random as well
+			void Set_Stop_On_Fault(bool stop) {
+				mStop_On_Fault = stop;
+			}
+
+			// attaches instrumentation plugin; the plugin must outlive the attachment and must not be attached while the machine is stepping
+			void Attach_Plugin(IMachine_Plugin& plugin);
+			// detaches instrumentation plugin
+			void Detach_Plugin(IMachine_Plugin& plugin);
+
+			// exports main memory and register snapshot to a POSIX shared memory object of given name, e.g. "/sarch32"; the snapshot is
+			// published after every Step call (callers running the machine continuously step it in batches); the main memory contents
+			// are discarded, so this is meant to be called before the image is loaded
+			bool Enable_State_Export(const std::string& name);
+
+			// selects the execution engine
+			void Set_Execution_Engine(NExecution_Engine engine);
+
+			// retrieves the execution engine in use
+			NExecution_Engine Get_Execution_Engine() const {
+				return mEngine;
+			}
+
+			// invalidates decoded instructions in given address range
+			void Invalidate_Decoded_Range(uint32_t address, uint32_t size);
+
+			// copies the architectural state (CPU context, main memory, cycle count) from other machine; peripherals are not copied
+			bool Clone_State_From(const CMachine& other);
 
 			// retrieves CPU context (read only)
 			const CCPU_Context& Get_CPU_Context() const {
@@ -122,6 +332,62 @@ namespace sarch32 {
 				return mMem_Bus;
 			}
 
+			// retrieves the number of clock cycles passed
+			uint64_t Get_Cycle_Count() const {
+				return mCycle_Count;
+			}
+
+			// retrieves the trace buffer (guest trace markers)
+			CTrace_Buffer& Get_Trace_Buffer() {
+				return mTrace_Buffer;
+			}
+
+			// enables or disables basic-block coverage recording
+			void Set_Coverage_Enabled(bool enabled);
+
+			// is the coverage recording enabled?
+			bool Is_Coverage_Enabled() const {
+				return mCoverage_Enabled;
+			}
+
+			// retrieves the coverage map
+			CCoverage_Map& Get_Coverage() {
+				return mCoverage;
+			}
+
+			// dumps the coverage relative to loaded sections
+			void Dump_Coverage(std::ostream& os) const {
+				mCoverage.Dump(os, mLoaded_Sections, &mSymbols);
+			}
+
+			// enables or disables execution profiling
+			void Set_Profiling_Enabled(bool enabled);
+
+			// is the execution profiling enabled?
+			bool Is_Profiling_Enabled() const {
+				return mProfiling_Enabled;
+			}
+
+			// retrieves the execution profile
+			CExecution_Profile& Get_Profile() {
+				return mProfile;
+			}
+
+			// dumps the execution profile relative to loaded sections
+			void Dump_Profile(std::ostream& os) const {
+				mProfile.Dump(os, mLoaded_Sections, &mSymbols);
+			}
+
+			// retrieves sections loaded from the object file
+			const std::vector<TLoaded_Section>& Get_Loaded_Sections() const {
+				return mLoaded_Sections;
+			}
+
+			// retrieves symbols and source lines of the loaded object file
+			const CSymbol_Index& Get_Symbol_Index() const {
+				return mSymbols;
+			}
+
 			// retrieves an interrupt controller
 			std::shared_ptr<CInterrupt_Controller>& Get_Interrupt_Controller() {
 				return mInterrupt_Ctl;
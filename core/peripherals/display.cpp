@@ -10,14 +10,27 @@ namespace sarch32 {
 	void CDisplay_300x200::Clear_Video_Memory() {
 		// black screen
 		std::fill(mVideo_Memory.begin(), mVideo_Memory.end(), 0);
+		mDirty_Range.Mark(0, static_cast<uint32_t>(mVideo_Memory.size()));
 	}
 
 	bool CDisplay_300x200::Is_Memory_Changed() const {
-		return mVideo_Mem_Changed;
+		return mDirty_Range.Is_Dirty();
 	}
 
 	void CDisplay_300x200::Clear_Memory_Changed_Flag() {
-		mVideo_Mem_Changed = false;
+		mDirty_Range.Clear();
+	}
+
+	std::pair<uint32_t, uint32_t> CDisplay_300x200::Take_Changed_Range() {
+		return mDirty_Range.Take();
+	}
+
+	std::span<uint8_t> CDisplay_300x200::Get_Direct_Memory() {
+		return mVideo_Memory;
+	}
+
+	CDirty_Range_Tracker* CDisplay_300x200::Get_Dirty_Range_Tracker() {
+		return &mDirty_Range;
 	}
 
 	void CDisplay_300x200::Attach(IBus& bus, std::shared_ptr<IInterrupt_Controller> /*interruptCtl*/) {
@@ -42,7 +55,7 @@ namespace sarch32 {
 		// video memory connected to bus
 		if (address >= Video_Memory_Start && address + size < Video_Memory_End) {
 			std::copy_n(static_cast<const uint8_t*>(source), size, mVideo_Memory.begin() + (address - Video_Memory_Start));
-			mVideo_Mem_Changed = true;
+			mDirty_Range.Mark(address - Video_Memory_Start, size);
 		}
 
 	}
@@ -17,7 +17,8 @@ namespace sarch32 {
 		public:
 			virtual ~IDisplay() = default;
 
-			// nothing for now
+			// retrieves the range of video memory changed since the last call (begin, end offset from video memory start) and clears it
+			virtual std::pair<uint32_t, uint32_t> Take_Changed_Range() = 0;
 	};
 
 	/*
@@ -26,10 +27,10 @@ namespace sarch32 {
 	class CDisplay_300x200 : public IPeripheral, public IDisplay, public std::enable_shared_from_this<CDisplay_300x200> {
 
 		private:
-			// video memory mapping
+			// video memory mapping - accessed directly by the bus
 			std::array<uint8_t, Video_Memory_End - Video_Memory_Start> mVideo_Memory;
-			// was there a write access to video memory?
-			bool mVideo_Mem_Changed = false;
+			// range of video memory written since the last query
+			CDirty_Range_Tracker mDirty_Range;
 
 		public:
 			CDisplay_300x200() noexcept;
@@ -42,10 +43,15 @@ namespace sarch32 {
 			virtual void Detach(IBus& bus, std::shared_ptr<IInterrupt_Controller> interruptCtl) override;
 			virtual void Read_Memory(uint32_t address, void* target, uint32_t size) const override;
 			virtual void Write_Memory(uint32_t address, const void* source, uint32_t size) override;
+			virtual std::span<uint8_t> Get_Direct_Memory() override;
+			virtual CDirty_Range_Tracker* Get_Dirty_Range_Tracker() override;
 
 			// IMemory_Change_Notifier iface
 			virtual bool Is_Memory_Changed() const override;
 			virtual void Clear_Memory_Changed_Flag() override;
+
+			// IDisplay iface
+			virtual std::pair<uint32_t, uint32_t> Take_Changed_Range() override;
 	};
 
 }
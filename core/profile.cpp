@@ -0,0 +1,119 @@
+#include "profile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+namespace sarch32 {
+
+	uint64_t CExecution_Profile::Get_Count(uint32_t address) const {
+		auto itr = mCounts.find(address);
+		return (itr == mCounts.end()) ? 0 : itr->second;
+	}
+
+	uint64_t CExecution_Profile::Get_Total_Count() const {
+		uint64_t total = 0;
+		for (auto& c : mCounts) {
+			total += c.second;
+		}
+		return total;
+	}
+
+	void CExecution_Profile::Dump(std::ostream& os, const std::vector<TLoaded_Section>& sections, const CSymbol_Index* symbols) const {
+
+		os << "; SArch32 execution profile" << std::endl;
+		os << "; " << Get_Total_Count() << " instructions retired" << std::endl;
+
+		// counts sorted by address
+		std::vector<std::pair<uint32_t, uint64_t>> counts(mCounts.begin(), mCounts.end());
+		std::sort(counts.begin(), counts.end());
+
+		// symbols in the order of the first executed address
+		std::vector<std::pair<std::string, uint64_t>> symbolCounts;
+
+		for (const auto& s : sections) {
+
+			auto first = std::lower_bound(counts.begin(), counts.end(), std::make_pair(s.startAddr, uint64_t{ 0 }));
+			auto last = std::lower_bound(first, counts.end(), std::make_pair(s.startAddr + s.size, uint64_t{ 0 }));
+
+			os << "section " << s.name << " 0x" << std::hex << std::setw(8) << std::setfill('0') << s.startAddr
+				<< " size " << std::dec << s.size << " addresses " << (last - first) << std::endl;
+
+			for (auto itr = first; itr != last; ++itr) {
+				os << "pc 0x" << std::hex << std::setw(8) << std::setfill('0') << itr->first << std::dec << " " << itr->second;
+
+				// symbolic location, if known
+				if (symbols) {
+					const auto sym = symbols->Format_Symbol(itr->first);
+					const auto line = symbols->Format_Line(itr->first);
+					if (!sym.empty() || !line.empty()) {
+						os << " ;";
+					}
+					if (!sym.empty()) {
+						os << " " << sym;
+					}
+					if (!line.empty()) {
+						os << " " << line;
+					}
+
+					if (const auto* sym = symbols->Find_Symbol(itr->first)) {
+						if (symbolCounts.empty() || symbolCounts.back().first != sym->name) {
+							symbolCounts.push_back({ sym->name, 0 });
+						}
+						symbolCounts.back().second += itr->second;
+					}
+				}
+
+				os << std::endl;
+			}
+		}
+
+		for (auto& sc : symbolCounts) {
+			os << "symbol " << sc.first << " " << sc.second << std::endl;
+		}
+	}
+
+	bool Load_Profile(const std::string& path, TProfile_Counts& counts) {
+
+		std::ifstream ifs(path);
+		if (!ifs.is_open()) {
+			return false;
+		}
+
+		std::string line;
+		while (std::getline(ifs, line)) {
+
+			// cut off the comment
+			if (const auto comment = line.find(';'); comment != std::string::npos) {
+				line.resize(comment);
+			}
+
+			std::istringstream iss(line);
+			std::string kind, key;
+			uint64_t count = 0;
+
+			if (!(iss >> kind)) {
+				continue;
+			}
+
+			if (kind == "pc") {
+				uint32_t address = 0;
+				if (!(iss >> std::hex >> address >> std::dec >> count)) {
+					return false;
+				}
+				counts.addresses[address] += count;
+			}
+			else if (kind == "symbol") {
+				if (!(iss >> key >> count)) {
+					return false;
+				}
+				counts.symbols[key] += count;
+			}
+			// other records (sections) are informative only
+		}
+
+		return true;
+	}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "hooks.h"
+#include "symbols.h"
+#include "coverage.h"
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <ostream>
+
+namespace sarch32 {
+
+	/*
+	 * Execution profile
+	 *
+	 * Counts retired instructions per address; attached to the machine as a plugin. The dump lists the counts per address
+	 * and per symbol, the assembler then uses it to lay out the code (hot code first, cold code to a separate section)
+	 */
+	class CExecution_Profile : public IMachine_Plugin {
+
+		private:
+			// retired instruction count per address
+			std::unordered_map<uint32_t, uint64_t> mCounts;
+
+		public:
+			uint32_t Get_Hook_Kinds() const override {
+				return static_cast<uint32_t>(NHook_Kind::Instruction_Retire);
+			}
+
+			void On_Instruction_Retire(const CCPU_Context& ctx, uint32_t pc, const CInstruction& instr) override {
+				mCounts[pc]++;
+			}
+
+			// clears all profile data
+			void Clear() {
+				mCounts.clear();
+			}
+
+			// retrieves the number of retired instructions at given address
+			uint64_t Get_Count(uint32_t address) const;
+			// retrieves the number of all retired instructions
+			uint64_t Get_Total_Count() const;
+
+			// dumps the counts relative to given sections in a textual form; the counts are summed up per symbol as well, if available
+			void Dump(std::ostream& os, const std::vector<TLoaded_Section>& sections, const CSymbol_Index* symbols = nullptr) const;
+	};
+
+	// execution profile loaded from a dump
+	struct TProfile_Counts {
+		// retired instruction counts per address
+		std::map<uint32_t, uint64_t> addresses;
+		// retired instruction counts per symbol (label, without the $ prefix)
+		std::unordered_map<std::string, uint64_t> symbols;
+	};
+
+	// loads execution profile dumped by CExecution_Profile::Dump
+	bool Load_Profile(const std::string& path, TProfile_Counts& counts);
+
+}
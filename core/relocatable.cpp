@@ -0,0 +1,275 @@
+#include "relocatable.h"
+#include "sobjfile.h"
+#include "sobjmapped.h"
+
+#include <iostream>
+
+namespace sarch32 {
+
+	namespace {
+
+		// puts metadata section to the output file
+		void Put_Metadata(SObj::CSObj_File& output, const char* name, const std::vector<uint8_t>& payload) {
+			output.Put_To_Section(name, payload);
+			output.Set_Section_Flags(name, static_cast<uint32_t>(SObj::NSection_Flag::Metadata));
+		}
+
+		// finishes metadata table - appends the name pool
+		std::vector<uint8_t>& Append_Pool(std::vector<uint8_t>& payload, const std::string& pool) {
+			payload.insert(payload.end(), pool.begin(), pool.end());
+			return payload;
+		}
+
+		// parsed metadata table - header, entries, file references and name pool
+		template<typename TEntry>
+		struct TTable {
+			std::vector<TEntry> entries;
+			std::vector<SObj::TName_Ref> files;
+			std::span<const uint8_t> pool;
+		};
+
+		// parses metadata table payload
+		template<typename TEntry>
+		bool Read_Table(std::span<const uint8_t> payload, TTable<TEntry>& table) {
+
+			size_t pos = 0;
+			SObj::TTable_Header hdr;
+			if (!SObj::Read_Table_Value(payload, pos, hdr)) {
+				return false;
+			}
+
+			// the tables must fit before they are parsed (the counts are not trusted)
+			const uint64_t tablesSize = static_cast<uint64_t>(hdr.fileCount) * sizeof(SObj::TName_Ref) + static_cast<uint64_t>(hdr.entryCount) * sizeof(TEntry);
+			if (tablesSize > payload.size() - pos) {
+				return false;
+			}
+
+			table.files.resize(hdr.fileCount);
+			for (auto& f : table.files) {
+				SObj::Read_Table_Value(payload, pos, f);
+			}
+
+			table.entries.resize(hdr.entryCount);
+			for (auto& e : table.entries) {
+				SObj::Read_Table_Value(payload, pos, e);
+			}
+
+			table.pool = payload.subspan(pos);
+
+			return true;
+		}
+	}
+
+	bool Save_Relocatable_Object(const std::string& path, const TRelocatable_Object& object) {
+
+		SObj::CSObj_File output;
+
+		for (const auto& s : object.sections) {
+			if (s.zeroFill) {
+				output.Put_Zero_Fill_To_Section(s.name, s.size);
+			}
+			else {
+				output.Put_To_Section(s.name, s.data);
+			}
+		}
+
+		{
+			std::vector<uint8_t> payload;
+			SObj::Append_Table_Value(payload, SObj::TObject_Info{ object.sourceHash, object.flags, 0 });
+			Put_Metadata(output, SObj::Object_Info_Section, payload);
+		}
+
+		{
+			std::vector<uint8_t> payload;
+			std::string pool;
+
+			SObj::Append_Table_Value(payload, SObj::TTable_Header{ static_cast<uint32_t>(object.symbols.size()), 0 });
+			for (const auto& sym : object.symbols) {
+				SObj::Append_Table_Value(payload, SObj::TSymbol_Definition_Entry{
+					SObj::Append_Table_Name(pool, sym.name),
+					SObj::Append_Table_Name(pool, sym.section),
+					sym.offset,
+					0
+				});
+			}
+
+			Put_Metadata(output, SObj::Symbol_Definition_Section, Append_Pool(payload, pool));
+		}
+
+		{
+			std::vector<uint8_t> payload;
+			std::string pool;
+
+			SObj::Append_Table_Value(payload, SObj::TTable_Header{ static_cast<uint32_t>(object.relocations.size()), 0 });
+			for (const auto& rel : object.relocations) {
+				SObj::Append_Table_Value(payload, SObj::TRelocation_Entry{
+					SObj::Append_Table_Name(pool, rel.symbol),
+					SObj::Append_Table_Name(pool, rel.section),
+					rel.offset,
+					static_cast<uint32_t>(rel.kind)
+				});
+			}
+
+			Put_Metadata(output, SObj::Relocation_Section, Append_Pool(payload, pool));
+		}
+
+		if (object.flags & static_cast<uint32_t>(SObj::NObject_Flag::Debug_Info)) {
+			std::vector<uint8_t> payload;
+			std::string pool;
+
+			SObj::Append_Table_Value(payload, SObj::TTable_Header{ static_cast<uint32_t>(object.lines.size()), static_cast<uint32_t>(object.files.size()) });
+			for (const auto& f : object.files) {
+				SObj::Append_Table_Value(payload, SObj::Append_Table_Name(pool, f));
+			}
+			for (const auto& line : object.lines) {
+				SObj::Append_Table_Value(payload, SObj::TObject_Line_Entry{
+					SObj::Append_Table_Name(pool, line.section),
+					line.offset,
+					line.size,
+					line.line,
+					line.fileIndex
+				});
+			}
+
+			Put_Metadata(output, SObj::Object_Line_Section, Append_Pool(payload, pool));
+		}
+
+		return output.Save_To_File(path, SObj::NVersion::V2);
+	}
+
+	bool Load_Relocatable_Object(const std::string& path, TRelocatable_Object& object) {
+
+		SObj::CSObj_Mapped_File infile;
+		if (!infile.Open(path) || !infile.Verify()) {
+			return false;
+		}
+
+		object = {};
+		bool hasInfo = false;
+
+		for (const auto& s : infile.Get_Sections()) {
+
+			// the contents are unrelocated, just copy them out
+			if (!SObj::Has_Flag(s.flags, SObj::NSection_Flag::Metadata)) {
+
+				auto& sec = object.sections.emplace_back();
+				sec.name = s.name;
+				sec.size = s.size;
+				sec.zeroFill = SObj::Has_Flag(s.flags, SObj::NSection_Flag::Zero_Fill);
+
+				if (!sec.zeroFill) {
+					sec.data.resize(s.size);
+					if (!infile.Read_Section(s, sec.data)) {
+						return false;
+					}
+				}
+
+				continue;
+			}
+
+			std::vector<uint8_t> payload(s.size);
+			if (!infile.Read_Section(s, payload)) {
+				return false;
+			}
+
+			if (s.name == SObj::Object_Info_Section) {
+
+				size_t pos = 0;
+				SObj::TObject_Info info;
+				if (!SObj::Read_Table_Value(std::span<const uint8_t>(payload), pos, info)) {
+					return false;
+				}
+
+				object.sourceHash = info.sourceHash;
+				object.flags = info.flags;
+				hasInfo = true;
+			}
+			else if (s.name == SObj::Symbol_Definition_Section) {
+
+				TTable<SObj::TSymbol_Definition_Entry> table;
+				if (!Read_Table(payload, table)) {
+					return false;
+				}
+
+				for (const auto& e : table.entries) {
+					auto& sym = object.symbols.emplace_back();
+					sym.offset = e.offset;
+					if (!SObj::Read_Table_Name(table.pool, e.name, sym.name) || !SObj::Read_Table_Name(table.pool, e.section, sym.section)) {
+						return false;
+					}
+				}
+			}
+			else if (s.name == SObj::Relocation_Section) {
+
+				TTable<SObj::TRelocation_Entry> table;
+				if (!Read_Table(payload, table)) {
+					return false;
+				}
+
+				for (const auto& e : table.entries) {
+					auto& rel = object.relocations.emplace_back();
+					rel.offset = e.offset;
+					rel.kind = static_cast<NRelocation_Kind>(e.kind);
+					if (!SObj::Read_Table_Name(table.pool, e.symbol, rel.symbol) || !SObj::Read_Table_Name(table.pool, e.section, rel.section)) {
+						return false;
+					}
+				}
+			}
+			else if (s.name == SObj::Object_Line_Section) {
+
+				TTable<SObj::TObject_Line_Entry> table;
+				if (!Read_Table(payload, table)) {
+					return false;
+				}
+
+				for (const auto& f : table.files) {
+					if (!SObj::Read_Table_Name(table.pool, f, object.files.emplace_back())) {
+						return false;
+					}
+				}
+
+				for (const auto& e : table.entries) {
+					if (e.fileIndex >= object.files.size()) {
+						return false;
+					}
+
+					auto& line = object.lines.emplace_back();
+					line.offset = e.offset;
+					line.size = e.size;
+					line.line = e.line;
+					line.fileIndex = e.fileIndex;
+					if (!SObj::Read_Table_Name(table.pool, e.section, line.section)) {
+						return false;
+					}
+				}
+			}
+		}
+
+		// a linked file has no object info
+		return hasInfo;
+	}
+
+	bool Read_Relocatable_Object_Info(const std::string& path, SObj::TObject_Info& info) {
+
+		SObj::CSObj_Mapped_File infile;
+		if (!infile.Open(path)) {
+			return false;
+		}
+
+		for (const auto& s : infile.Get_Sections()) {
+			if (s.name == SObj::Object_Info_Section && SObj::Has_Flag(s.flags, SObj::NSection_Flag::Metadata)) {
+
+				std::vector<uint8_t> payload(s.size);
+				if (!infile.Read_Section(s, payload)) {
+					return false;
+				}
+
+				size_t pos = 0;
+				return SObj::Read_Table_Value(std::span<const uint8_t>(payload), pos, info);
+			}
+		}
+
+		return false;
+	}
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <string>
+
+#include "isa.h"
+#include "sobjformat.h"
+
+namespace sarch32 {
+
+	// section of a relocatable object
+	struct TObject_Section {
+		std::string name;
+		uint32_t size = 0;
+		// the section consists of reserved space only, no data are stored
+		bool zeroFill = false;
+		std::vector<uint8_t> data;
+	};
+
+	// symbol defined by a relocatable object (section relative)
+	struct TObject_Symbol {
+		std::string name;
+		std::string section;
+		uint32_t offset = 0;
+	};
+
+	// field of a relocatable object to be patched with symbol address
+	struct TObject_Relocation {
+		std::string symbol;
+		std::string section;
+		uint32_t offset = 0;
+		NRelocation_Kind kind = NRelocation_Kind::None;
+	};
+
+	// source line record of a relocatable object (section relative)
+	struct TObject_Line {
+		std::string section;
+		uint32_t offset = 0;
+		uint32_t size = 0;
+		uint32_t line = 0;
+		uint32_t fileIndex = 0;
+	};
+
+	/*
+	 * Relocatable object - assembled, but not linked contents of a single source file
+	 *
+	 * Stored as SObj v2 file with unrelocated sections and metadata sections describing symbols and relocations
+	 * (see sobjformat.h)
+	 */
+	struct TRelocatable_Object {
+		// FNV-1a hash of the source the object was assembled from
+		uint64_t sourceHash = 0;
+		// NObject_Flag bitmask
+		uint32_t flags = 0;
+
+		std::vector<TObject_Section> sections;
+		std::vector<TObject_Symbol> symbols;
+		std::vector<TObject_Relocation> relocations;
+		// line records and source files they refer to (only with NObject_Flag::Debug_Info)
+		std::vector<TObject_Line> lines;
+		std::vector<std::string> files;
+	};
+
+	// saves relocatable object to given file
+	bool Save_Relocatable_Object(const std::string& path, const TRelocatable_Object& object);
+	// loads relocatable object from given file; fails if the file is not a valid relocatable object
+	bool Load_Relocatable_Object(const std::string& path, TRelocatable_Object& object);
+	// reads just the info of relocatable object in given file (to decide, if the object is up to date)
+	bool Read_Relocatable_Object_Info(const std::string& path, SObj::TObject_Info& info);
+
+}
@@ -0,0 +1,162 @@
+#include "shared_state.h"
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace sarch32 {
+
+	namespace {
+
+		// number of words of the snapshot
+		constexpr size_t Snapshot_Word_Count = sizeof(TShared_State_Snapshot) / sizeof(uint32_t);
+
+		// stores the snapshot to shared memory word by word (every store is atomic, the snapshot as a whole is not)
+		void Store_Snapshot_Words(TShared_State_Snapshot& target, const TShared_State_Snapshot& source) {
+			uint32_t words[Snapshot_Word_Count];
+			std::memcpy(words, &source, sizeof(words));
+
+			uint32_t* dst = reinterpret_cast<uint32_t*>(&target);
+			for (size_t i = 0; i < Snapshot_Word_Count; i++) {
+				std::atomic_ref<uint32_t>(dst[i]).store(words[i], std::memory_order_relaxed);
+			}
+		}
+
+		// loads the snapshot from shared memory word by word
+		void Load_Snapshot_Words(TShared_State_Snapshot& target, const TShared_State_Snapshot& source) {
+			uint32_t words[Snapshot_Word_Count];
+
+			uint32_t* src = reinterpret_cast<uint32_t*>(const_cast<TShared_State_Snapshot*>(&source));
+			for (size_t i = 0; i < Snapshot_Word_Count; i++) {
+				words[i] = std::atomic_ref<uint32_t>(src[i]).load(std::memory_order_relaxed);
+			}
+
+			std::memcpy(&target, words, sizeof(words));
+		}
+
+		// retrieves the sequence lock of the header
+		std::atomic_ref<uint64_t> Sequence_Of(const TShared_State_Header& header) {
+			return std::atomic_ref<uint64_t>(const_cast<uint64_t&>(header.sequence));
+		}
+	}
+
+#ifdef _WIN32
+
+	CShared_State::~CShared_State() {
+		//
+	}
+
+	bool CShared_State::Create(const std::string& name, uint32_t memorySize) {
+		std::cerr << "Shared state export is not supported on this platform" << std::endl;
+		return false;
+	}
+
+#else
+
+	CShared_State::~CShared_State() {
+		if (mHeader) {
+			munmap(mHeader, mHeader_Size);
+		}
+		if (mFd >= 0) {
+			close(mFd);
+			// the monitors keep their mappings, just the name disappears
+			shm_unlink(mName.c_str());
+		}
+	}
+
+	bool CShared_State::Create(const std::string& name, uint32_t memorySize) {
+
+		const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		mHeader_Size = (sizeof(TShared_State_Header) + pageSize - 1) / pageSize * pageSize;
+
+		// a stale object of a previous run would have a different layout
+		shm_unlink(name.c_str());
+
+		mFd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+		if (mFd < 0) {
+			std::cerr << "Could not create shared memory object " << name << ": " << std::strerror(errno) << std::endl;
+			return false;
+		}
+
+		mName = name;
+
+		// the object is sparse, the main memory pages are allocated when touched
+		if (ftruncate(mFd, static_cast<off_t>(mHeader_Size + memorySize)) != 0) {
+			std::cerr << "Could not resize shared memory object " << name << ": " << std::strerror(errno) << std::endl;
+			return false;
+		}
+
+		void* ptr = mmap(nullptr, mHeader_Size, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+		if (ptr == MAP_FAILED) {
+			std::cerr << "Could not map shared memory object " << name << ": " << std::strerror(errno) << std::endl;
+			return false;
+		}
+
+		mHeader = static_cast<TShared_State_Header*>(ptr);
+		mHeader->magic = Shared_State_Magic;
+		mHeader->version = Shared_State_Version;
+		mHeader->memoryOffset = static_cast<uint32_t>(mHeader_Size);
+		mHeader->memorySize = memorySize;
+
+		return true;
+	}
+
+#endif
+
+	void CShared_State::Publish(const CCPU_Context& ctx, uint64_t cycleCount) {
+
+		if (!mHeader) {
+			return;
+		}
+
+		TShared_State_Snapshot snapshot;
+		snapshot.cycleCount = cycleCount;
+		snapshot.publishCount = ++mPublish_Count;
+		for (size_t i = 0; i < Register_Count; i++) {
+			snapshot.registers[i] = ctx.Reg(static_cast<NRegister>(i));
+		}
+		for (size_t i = 0; i < Processor_State_Register_Count; i++) {
+			snapshot.stateRegisters[i] = ctx.State(static_cast<NProcessor_State_Register>(i));
+		}
+
+		// odd sequence - the snapshot is being written
+		auto sequence = Sequence_Of(*mHeader);
+		const uint64_t seq = sequence.load(std::memory_order_relaxed);
+		sequence.store(seq + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		Store_Snapshot_Words(mHeader->snapshot, snapshot);
+
+		// even sequence - the snapshot is complete
+		sequence.store(seq + 2, std::memory_order_release);
+	}
+
+	bool CShared_State::Read_Snapshot(const TShared_State_Header& header, TShared_State_Snapshot& snapshot, size_t attempts) {
+
+		auto sequence = Sequence_Of(header);
+
+		for (size_t i = 0; i < attempts; i++) {
+			const uint64_t before = sequence.load(std::memory_order_acquire);
+			if (before & 1) {
+				continue;
+			}
+
+			Load_Snapshot_Words(snapshot, header.snapshot);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (sequence.load(std::memory_order_relaxed) == before) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "isa.h"
+
+#include <cstdint>
+#include <string>
+
+namespace sarch32 {
+
+	// magic number of the shared state segment ("S32M")
+	constexpr uint32_t Shared_State_Magic = 0x4D323353;
+	// version of the shared state segment layout
+	constexpr uint32_t Shared_State_Version = 1;
+
+	// published snapshot of the CPU state
+	struct TShared_State_Snapshot {
+		uint64_t cycleCount;		// clock cycles passed
+		uint64_t publishCount;		// number of snapshots published so far
+		uint32_t registers[Register_Count];
+		uint32_t stateRegisters[Processor_State_Register_Count];
+	};
+
+	// header of the shared state segment
+	struct TShared_State_Header {
+		uint32_t magic;				// Shared_State_Magic
+		uint32_t version;			// Shared_State_Version
+		uint32_t memoryOffset;		// offset of main memory from the segment start (page aligned)
+		uint32_t memorySize;		// size of main memory
+		uint64_t sequence;			// sequence lock of the snapshot (odd while the snapshot is being written)
+		TShared_State_Snapshot snapshot;
+	};
+
+	static_assert(sizeof(TShared_State_Snapshot) % sizeof(uint32_t) == 0, "Snapshot must consist of whole words");
+
+	/*
+	 * Shared machine state segment
+	 *
+	 * POSIX shared memory object laid out as follows (host byte order):
+	 *    0                      TShared_State_Header (padded to memoryOffset)
+	 *    header.memoryOffset    main memory, header.memorySize bytes
+	 *
+	 * The snapshot is published by the machine after every Step call (the emulator steps in batches, so the snapshot lags
+	 * by at most a batch of instructions while running) and it is protected by a sequence lock - the writer
+	 * increments the sequence (odd), stores the snapshot word by word and increments the sequence again (even). A reader loads
+	 * the sequence, copies the snapshot and loads the sequence again; the copy is consistent, if both values are equal and even.
+	 * Main memory is live and not protected at all; readers are supposed to map the segment read-only
+	 *
+	 * Not available on Windows
+	 */
+	class CShared_State {
+
+		private:
+			// name of the shared memory object
+			std::string mName;
+			// descriptor of the shared memory object
+			int mFd = -1;
+			// mapped header
+			TShared_State_Header* mHeader = nullptr;
+			// size of the header mapping (offset of the main memory)
+			size_t mHeader_Size = 0;
+			// number of snapshots published so far
+			uint64_t mPublish_Count = 0;
+
+		public:
+			CShared_State() = default;
+			~CShared_State();
+
+			CShared_State(const CShared_State&) = delete;
+			CShared_State& operator=(const CShared_State&) = delete;
+
+			// creates the shared memory object of given name (e.g., "/sarch32") for main memory of given size; an existing object is replaced
+			bool Create(const std::string& name, uint32_t memorySize);
+
+			// retrieves the descriptor of the shared memory object (to map the main memory)
+			int Get_File_Descriptor() const {
+				return mFd;
+			}
+
+			// retrieves the offset of the main memory within the shared memory object
+			uint64_t Get_Memory_Offset() const {
+				return mHeader_Size;
+			}
+
+			// publishes the snapshot of given CPU state
+			void Publish(const CCPU_Context& ctx, uint64_t cycleCount);
+
+			// reads consistent snapshot from given (mapped) header; fails, if the writer kept changing it during all attempts
+			static bool Read_Snapshot(const TShared_State_Header& header, TShared_State_Snapshot& snapshot, size_t attempts = 1000);
+	};
+
+}
@@ -1,9 +1,12 @@
 #include "sobjfile.h"
+#include "sobjmapped.h"
 
 #include <algorithm>
 #include <iterator>
 #include <fstream>
 #include <iostream>
+#include <cstring>
+#include <filesystem>
 
 namespace SObj {
 
@@ -24,6 +27,13 @@ namespace SObj {
 		// TODO: check overflow
 	}
 
+	void CSObj_File::Put_Zero_Fill_To_Section(const std::string& sectionName, uint32_t size) {
+		auto& sec = mSection[sectionName];
+
+		sec.flags |= static_cast<uint32_t>(NSection_Flag::Zero_Fill);
+		sec.size += size;
+	}
+
 	void CSObj_File::Relocate_Section(const std::string& sectionName, uint32_t startAddr) {
 		// if the section does not exist, create its record
 		if (mSection.find(sectionName) == mSection.end()) {
@@ -40,14 +50,44 @@ namespace SObj {
 		}
 	}
 
-	bool CSObj_File::Save_To_File(const std::string& path) {
+	void CSObj_File::Set_Section_Flags(const std::string& sectionName, uint32_t flags) {
+		mSection[sectionName].flags = flags;
+	}
+
+	bool CSObj_File::Save_To_File(const std::string& path, NVersion version) {
+
+		// the file is written aside and then renamed over the original - a running emulator may have the original mapped
+		// (truncating it in place would change or invalidate the mapped pages)
+		const std::string tmpPath = path + ".tmp";
+		std::error_code ec;
+
+		{
+			// open file to store object dump to
+			std::ofstream ofs(tmpPath, std::ios::out | std::ios::binary);
+			if (!ofs.is_open()) {
+				return false;
+			}
+
+			const bool result = (version == NVersion::V1) ? Save_V1(ofs) : Save_V2(ofs);
+			ofs.close();
+
+			if (!result || !ofs) {
+				std::filesystem::remove(tmpPath, ec);
+				return false;
+			}
+		}
 
-		// open file to store object dump to
-		std::ofstream ofs(path, std::ios::out | std::ios::binary);
-		if (!ofs.is_open()) {
+		std::filesystem::rename(tmpPath, path, ec);
+		if (ec) {
+			std::filesystem::remove(tmpPath, ec);
 			return false;
 		}
 
+		return true;
+	}
+
+	bool CSObj_File::Save_V1(std::ostream& ofs) {
+
 		// serialize number of sections
 		Serialize<uint32_t>(ofs, static_cast<uint32_t>(mSection.size()));
 		// serialize all sections one after another
@@ -61,43 +101,142 @@ namespace SObj {
 			Serialize<uint32_t>(ofs, s.second.startAddr);
 			// length of section
 			Serialize<uint32_t>(ofs, s.second.size);
-			// section data
-			ofs.write(reinterpret_cast<char*>(s.second.data.data()), s.second.data.size());
+			// section data (v1 has no zero-filled sections, the zeroes must be stored)
+			if (Has_Flag(s.second.flags, NSection_Flag::Zero_Fill)) {
+				const std::vector<char> zeroes(s.second.size, 0);
+				ofs.write(zeroes.data(), zeroes.size());
+			}
+			else {
+				ofs.write(reinterpret_cast<char*>(s.second.data.data()), s.second.data.size());
+			}
 
 			//std::cout << "Stored section " << s.first << " at " << s.second.startAddr << ", size " << s.second.size << std::endl;
 		}
 
-		return true;
+		return ofs.good();
+	}
+
+	bool CSObj_File::Save_V2(std::ostream& ofs) {
+
+		// the whole content after the header is built in memory first, as the header contains its hash
+		std::vector<uint8_t> content;
+
+		auto append = [&content](const void* ptr, size_t len) {
+			const uint8_t* bytes = static_cast<const uint8_t*>(ptr);
+			content.insert(content.end(), bytes, bytes + len);
+		};
+
+		auto alignTo = [&content](size_t alignment) {
+			const size_t pos = sizeof(TFile_Header) + content.size();
+			content.resize(content.size() + (alignment - pos % alignment) % alignment, 0);
+		};
+
+		TFile_Header hdr{};
+		hdr.magic = Magic;
+		hdr.version = static_cast<uint16_t>(NVersion::V2);
+		hdr.headerSize = sizeof(TFile_Header);
+		hdr.sectionCount = static_cast<uint32_t>(mSection.size());
+		hdr.sectionTableOffset = sizeof(TFile_Header);
+
+		std::vector<TSection_Entry> entries;
+		std::string strings;
+		// payloads to be stored (compressed ones are held in a separate buffer)
+		std::vector<std::vector<uint8_t>> compressed(mSection.size());
+
+		size_t idx = 0;
+		for (auto& s : mSection) {
+			TSection_Entry entry{};
+			entry.nameOffset = static_cast<uint32_t>(strings.size());
+			entry.nameLength = static_cast<uint32_t>(s.first.size());
+			entry.startAddr = s.second.startAddr;
+			entry.size = s.second.size;
+			entry.flags = s.second.flags;
+
+			strings += s.first;
+
+			if (Has_Flag(entry.flags, NSection_Flag::Zero_Fill)) {
+				entry.flags &= ~static_cast<uint32_t>(NSection_Flag::Compressed);
+			}
+			else if (Has_Flag(entry.flags, NSection_Flag::Compressed)) {
+				compressed[idx] = Compress_LZ4_Block(s.second.data);
+
+				// the data are not compressible - store them as they are
+				if (compressed[idx].size() >= s.second.data.size()) {
+					compressed[idx].clear();
+					entry.flags &= ~static_cast<uint32_t>(NSection_Flag::Compressed);
+				}
+			}
+
+			entries.push_back(entry);
+			idx++;
+		}
+
+		hdr.stringTableOffset = static_cast<uint32_t>(sizeof(TFile_Header) + entries.size() * sizeof(TSection_Entry));
+		hdr.stringTableSize = static_cast<uint32_t>(strings.size());
+
+		// reserve space for the table, it is filled once the payload offsets are known
+		content.resize(entries.size() * sizeof(TSection_Entry), 0);
+		append(strings.data(), strings.size());
+
+		// payloads, every one of them aligned
+		idx = 0;
+		for (auto& s : mSection) {
+			auto& entry = entries[idx];
+
+			// empty payloads are not aligned, there is nothing to map
+			if (!Has_Flag(entry.flags, NSection_Flag::Zero_Fill) && s.second.size > 0) {
+				alignTo(Section_Alignment);
+				entry.dataOffset = sizeof(TFile_Header) + content.size();
+
+				if (Has_Flag(entry.flags, NSection_Flag::Compressed)) {
+					append(compressed[idx].data(), compressed[idx].size());
+					entry.storedSize = compressed[idx].size();
+				}
+				else {
+					append(s.second.data.data(), s.second.data.size());
+					entry.storedSize = s.second.data.size();
+				}
+			}
+			else if (!Has_Flag(entry.flags, NSection_Flag::Zero_Fill)) {
+				entry.dataOffset = sizeof(TFile_Header) + content.size();
+			}
+
+			idx++;
+		}
+
+		if (!entries.empty()) {
+			std::memcpy(content.data(), entries.data(), entries.size() * sizeof(TSection_Entry));
+		}
+
+		hdr.contentHash = Hash_FNV1a_64(content);
+
+		ofs.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+		ofs.write(reinterpret_cast<const char*>(content.data()), content.size());
+
+		return ofs.good();
 	}
 
 	bool CSObj_File::Load_From_File(const std::string& path) {
 
-		// open object file
-		std::ifstream ifs(path, std::ios::in | std::ios::binary);
-		if (!ifs.is_open()) {
+		// both versions are parsed by the mapped reader, the sections are just copied out of it
+		CSObj_Mapped_File infile;
+		if (!infile.Open(path) || !infile.Verify()) {
 			return false;
 		}
 
-		// read section count
-		auto sectionCount = Deserialize<uint32_t>(ifs);
-		for (decltype(sectionCount) i = 0; i < sectionCount; i++) {
-
-			// read section name length
-			auto nameLen = Deserialize<uint32_t>(ifs);
-			// read section name
-			auto name = Deserialize_String(ifs, nameLen);
+		for (auto& s : infile.Get_Sections()) {
+			auto& sec = mSection[s.name];
 
-			// read starting address
-			mSection[name].startAddr = Deserialize<uint32_t>(ifs);
-			// read section size
-			mSection[name].size = Deserialize<uint32_t>(ifs);
-			// allocate space
-			mSection[name].data.resize(mSection[name].size);
+			sec.startAddr = s.startAddr;
+			sec.size = s.size;
+			sec.flags = s.flags;
+			sec.data.resize(s.size);
 
-			// read section data
-			ifs.read(reinterpret_cast<char*>(mSection[name].data.data()), mSection[name].size);
+			if (!infile.Read_Section(s, sec.data)) {
+				return false;
+			}
 
-			//std::cout << "Loaded section " << name << " at " << mSection[name].startAddr << ", size " << mSection[name].size << std::endl;
+			//std::cout << "Loaded section " << s.name << " at " << sec.startAddr << ", size " << sec.size << std::endl;
 		}
 
 		return true;
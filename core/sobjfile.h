@@ -6,12 +6,16 @@
 #include <fstream>
 #include <map>
 
+#include "sobjformat.h"
+
 namespace SObj {
 
 	// structure of a section (loaded into memory)
 	struct TSection {
 		uint32_t startAddr = 0;
 		uint32_t size = 0;
+		// NSection_Flag bitmask (stored in v2 files only)
+		uint32_t flags = 0;
 		std::vector<uint8_t> data{};
 	};
 
@@ -42,40 +46,28 @@ namespace SObj {
 				file.write(t.c_str(), t.size());
 			}
 
-			// deserializes given POD type from stream
-			template<typename T>
-			T Deserialize(std::istream& file) {
-				union {
-					char bytes[sizeof(T)];
-					T raw;
-				} un;
-
-				file.read(un.bytes, sizeof(T));
-				return un.raw;
-			}
-
-			// deserializes string from stream
-			std::string Deserialize_String(std::istream& file, size_t expectedLen) {
-				std::string ret(expectedLen + 1, '\0');
-
-				file.read(ret.data(), expectedLen);
-
-				return ret;
-			}
+			// saves the v1 (legacy) format
+			bool Save_V1(std::ostream& file);
+			// saves the v2 format
+			bool Save_V2(std::ostream& file);
 
 		public:
 			CSObj_File();
 
 			// put given data dump into section
 			void Put_To_Section(const std::string& sectionName, const std::vector<uint8_t>& data);
+			// reserve given number of zero bytes in a zero-filled section (no data are stored)
+			void Put_Zero_Fill_To_Section(const std::string& sectionName, uint32_t size);
 			// relocate section to given address
 			void Relocate_Section(const std::string& sectionName, uint32_t startAddr);
 			// clears given section
 			void Clear_Section(const std::string& sectionName);
+			// sets flags (NSection_Flag bitmask) of given section
+			void Set_Section_Flags(const std::string& sectionName, uint32_t flags);
 
-			// saves the loaded state to file
-			bool Save_To_File(const std::string& path);
-			// loads contents from file
+			// saves the loaded state to file in given format version
+			bool Save_To_File(const std::string& path, NVersion version = NVersion::V2);
+			// loads contents from file (any version); compressed sections are decompressed, v2 content hash is verified
 			bool Load_From_File(const std::string& path);
 
 			// retrieves read-only map of sections
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace SObj {
+
+	/*
+	 * SObj file format definitions
+	 *
+	 * v1 (legacy): section count, followed by sections, each of them with name length, name, start address, size and data
+	 *
+	 * v2: fixed header, section table, string table (section names), and section payloads, every payload aligned to
+	 *     Section_Alignment (so it can be mapped directly to memory); the header holds FNV-1a hash of everything after the header
+	 *
+	 * v2 files may also contain metadata sections (flagged as such), which are not loaded to memory
+	 */
+
+	// file format version
+	enum class NVersion : uint16_t {
+		V1 = 1,
+		V2 = 2,
+	};
+
+	// magic number of v2 files ("SOBJ")
+	constexpr uint32_t Magic = 0x4A424F53;
+
+	// alignment of v2 section payloads in the file
+	constexpr uint32_t Section_Alignment = 4096;
+
+	// section flags
+	enum class NSection_Flag : uint32_t {
+		Exec		= 1 << 0,	// section contains code
+		Read_Only	= 1 << 1,	// section is not meant to be written to
+		Zero_Fill	= 1 << 2,	// section has no payload, it is filled with zeroes by the loader
+		Compressed	= 1 << 3,	// section payload is LZ4 block compressed
+		Metadata	= 1 << 4,	// section is not loaded to memory (symbol table, line table)
+	};
+
+	// name of the symbol table metadata section
+	constexpr const char* Symbol_Table_Section = ".symtab";
+	// name of the line table metadata section
+	constexpr const char* Line_Table_Section = ".lines";
+
+	// name of the object info metadata section (relocatable objects only)
+	constexpr const char* Object_Info_Section = ".objinfo";
+	// name of the symbol definition metadata section (relocatable objects only)
+	constexpr const char* Symbol_Definition_Section = ".symdef";
+	// name of the relocation metadata section (relocatable objects only)
+	constexpr const char* Relocation_Section = ".reloc";
+	// name of the section relative line table metadata section (relocatable objects only)
+	constexpr const char* Object_Line_Section = ".objlines";
+
+	// object info flags
+	enum class NObject_Flag : uint32_t {
+		Debug_Info	= 1 << 0,	// the object contains section relative line table
+	};
+
+	// does the flag set contain given flag?
+	inline bool Has_Flag(uint32_t flags, NSection_Flag flag) {
+		return (flags & static_cast<uint32_t>(flag)) != 0;
+	}
+
+#pragma pack(push, 1)
+
+	// v2 file header
+	struct TFile_Header {
+		uint32_t magic;
+		uint16_t version;
+		uint16_t headerSize;
+		uint32_t sectionCount;
+		uint32_t sectionTableOffset;
+		uint32_t stringTableOffset;
+		uint32_t stringTableSize;
+		uint64_t contentHash;
+	};
+
+	// v2 section table entry
+	struct TSection_Entry {
+		uint32_t nameOffset;	// offset of the name within string table
+		uint32_t nameLength;
+		uint32_t startAddr;
+		uint32_t size;			// size in memory
+		uint32_t flags;			// NSection_Flag bitmask
+		uint32_t reserved;
+		uint64_t dataOffset;	// offset of the payload within file
+		uint64_t storedSize;	// size of the payload within file
+	};
+
+	/*
+	 * Metadata tables (.symtab, .lines) - table header, file name references (line table only),
+	 * entries sorted by address, and a pool of names; name offsets are relative to the start of the pool
+	 */
+
+	// metadata table header
+	struct TTable_Header {
+		uint32_t entryCount;
+		uint32_t fileCount;		// number of source file references (zero for symbol table)
+	};
+
+	// name reference into the name pool
+	struct TName_Ref {
+		uint32_t nameOffset;
+		uint32_t nameLength;
+	};
+
+	// symbol table entry
+	struct TSymbol_Entry {
+		uint32_t address;
+		uint32_t size;			// distance to the next symbol or to the end of section
+		TName_Ref name;
+	};
+
+	// line table entry
+	struct TLine_Entry {
+		uint32_t address;
+		uint32_t size;			// size of instruction or data generated by the line
+		uint32_t line;			// line number (1-based)
+		uint32_t fileIndex;		// index to source file references
+	};
+
+	/*
+	 * Relocatable objects - v2 files with unrelocated sections (start address zero) and the following metadata sections:
+	 *   .objinfo  - TObject_Info
+	 *   .symdef   - table of TSymbol_Definition_Entry (section relative symbol definitions)
+	 *   .reloc    - table of TRelocation_Entry (fields to be patched with symbol addresses)
+	 *   .objlines - table of TObject_Line_Entry with source file references (only with NObject_Flag::Debug_Info)
+	 * The tables have the same layout as the symbol and line tables
+	 */
+
+	// relocatable object info
+	struct TObject_Info {
+		uint64_t sourceHash;	// FNV-1a hash of the source the object was assembled from
+		uint32_t flags;			// NObject_Flag bitmask
+		uint32_t reserved;
+	};
+
+	// symbol definition entry
+	struct TSymbol_Definition_Entry {
+		TName_Ref name;
+		TName_Ref section;
+		uint32_t offset;		// offset within the section
+		uint32_t reserved;
+	};
+
+	// relocation entry
+	struct TRelocation_Entry {
+		TName_Ref symbol;
+		TName_Ref section;
+		uint32_t offset;		// offset of the patched instruction or data within the section
+		uint32_t kind;			// NRelocation_Kind
+	};
+
+	// section relative line table entry
+	struct TObject_Line_Entry {
+		TName_Ref section;
+		uint32_t offset;		// offset of the instruction or data within the section
+		uint32_t size;
+		uint32_t line;
+		uint32_t fileIndex;
+	};
+
+#pragma pack(pop)
+
+	static_assert(sizeof(TFile_Header) == 32, "Unexpected SObj header size");
+	static_assert(sizeof(TSection_Entry) == 40, "Unexpected SObj section entry size");
+	static_assert(sizeof(TSymbol_Entry) == 16, "Unexpected SObj symbol entry size");
+	static_assert(sizeof(TLine_Entry) == 16, "Unexpected SObj line entry size");
+	static_assert(sizeof(TObject_Info) == 16, "Unexpected SObj object info size");
+	static_assert(sizeof(TSymbol_Definition_Entry) == 24, "Unexpected SObj symbol definition entry size");
+	static_assert(sizeof(TRelocation_Entry) == 24, "Unexpected SObj relocation entry size");
+	static_assert(sizeof(TObject_Line_Entry) == 24, "Unexpected SObj object line entry size");
+
+	// FNV-1a 64-bit offset basis
+	constexpr uint64_t FNV1a_Offset_Basis = 0xCBF29CE484222325ull;
+
+	// calculates FNV-1a 64-bit hash of given bytes; the hash may be continued by passing the previous value
+	inline uint64_t Hash_FNV1a_64(std::span<const uint8_t> bytes, uint64_t hash = FNV1a_Offset_Basis) {
+		for (auto b : bytes) {
+			hash ^= b;
+			hash *= 0x100000001B3ull;
+		}
+		return hash;
+	}
+
+	// appends a trivially copyable value to metadata table payload
+	template<typename T>
+	void Append_Table_Value(std::vector<uint8_t>& payload, const T& value) {
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+		payload.insert(payload.end(), bytes, bytes + sizeof(T));
+	}
+
+	// appends a name to metadata table name pool and retrieves a reference to it
+	inline TName_Ref Append_Table_Name(std::string& pool, const std::string& name) {
+		TName_Ref ref{ static_cast<uint32_t>(pool.size()), static_cast<uint32_t>(name.size()) };
+		pool += name;
+		return ref;
+	}
+
+	// reads a trivially copyable value from given position of metadata table payload; fails if it does not fit
+	template<typename T>
+	bool Read_Table_Value(std::span<const uint8_t> payload, size_t& pos, T& target) {
+		if (pos > payload.size() || payload.size() - pos < sizeof(T)) {
+			return false;
+		}
+
+		std::memcpy(&target, payload.data() + pos, sizeof(T));
+		pos += sizeof(T);
+		return true;
+	}
+
+	// resolves name reference within metadata table name pool; fails if it does not fit
+	inline bool Read_Table_Name(std::span<const uint8_t> pool, const TName_Ref& ref, std::string& target) {
+		if (ref.nameOffset > pool.size() || pool.size() - ref.nameOffset < ref.nameLength) {
+			return false;
+		}
+
+		target.assign(reinterpret_cast<const char*>(pool.data() + ref.nameOffset), ref.nameLength);
+		return true;
+	}
+
+	// compresses given bytes using LZ4 block format
+	std::vector<uint8_t> Compress_LZ4_Block(std::span<const uint8_t> src);
+	// decompresses LZ4 block to given target; fails if the block is malformed or does not decompress exactly to target size
+	bool Decompress_LZ4_Block(std::span<const uint8_t> src, std::span<uint8_t> dst);
+
+}
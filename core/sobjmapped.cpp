@@ -0,0 +1,218 @@
+#include "sobjmapped.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace SObj {
+
+	CSObj_Mapped_File::~CSObj_Mapped_File() {
+		Close();
+	}
+
+	bool CSObj_Mapped_File::Open(const std::string& path) {
+
+		Close();
+
+#ifndef _WIN32
+		mFd = open(path.c_str(), O_RDONLY);
+		if (mFd >= 0) {
+			struct stat st;
+			if (fstat(mFd, &st) == 0 && st.st_size > 0) {
+				void* ptr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, mFd, 0);
+				if (ptr != MAP_FAILED) {
+					mData = static_cast<const uint8_t*>(ptr);
+					mSize = static_cast<size_t>(st.st_size);
+					return Parse();
+				}
+			}
+
+			close(mFd);
+			mFd = -1;
+		}
+#endif
+
+		// the file could not be mapped - read it whole instead
+		std::ifstream ifs(path, std::ios::in | std::ios::binary);
+		if (!ifs.is_open()) {
+			return false;
+		}
+
+		mFallback_Buffer.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+		mData = mFallback_Buffer.data();
+		mSize = mFallback_Buffer.size();
+
+		return Parse();
+	}
+
+	void CSObj_Mapped_File::Close() {
+
+#ifndef _WIN32
+		if (mFd >= 0) {
+			if (mData) {
+				munmap(const_cast<uint8_t*>(mData), mSize);
+			}
+			close(mFd);
+			mFd = -1;
+		}
+#endif
+
+		mData = nullptr;
+		mSize = 0;
+		mFallback_Buffer.clear();
+		mSections.clear();
+	}
+
+	bool CSObj_Mapped_File::Parse() {
+
+		uint32_t magic = 0;
+		if (mSize >= sizeof(magic)) {
+			std::memcpy(&magic, mData, sizeof(magic));
+		}
+
+		// v1 files start with section count, which never reaches the magic value in practice
+		if (magic == Magic) {
+			mVersion = NVersion::V2;
+			return Parse_V2();
+		}
+
+		mVersion = NVersion::V1;
+		return Parse_V1();
+	}
+
+	bool CSObj_Mapped_File::Parse_V1() {
+
+		size_t pos = 0;
+
+		// reads a scalar at the current position; fails on truncated file
+		auto read32 = [this, &pos](uint32_t& value) {
+			if (pos + sizeof(uint32_t) > mSize) {
+				return false;
+			}
+			std::memcpy(&value, mData + pos, sizeof(uint32_t));
+			pos += sizeof(uint32_t);
+			return true;
+		};
+
+		uint32_t sectionCount = 0;
+		if (!read32(sectionCount)) {
+			return false;
+		}
+
+		for (uint32_t i = 0; i < sectionCount; i++) {
+
+			TSection_View sec;
+
+			uint32_t nameLen = 0;
+			if (!read32(nameLen) || pos + nameLen > mSize) {
+				return false;
+			}
+
+			sec.name.assign(reinterpret_cast<const char*>(mData + pos), nameLen);
+			pos += nameLen;
+
+			if (!read32(sec.startAddr) || !read32(sec.size) || pos + sec.size > mSize) {
+				return false;
+			}
+
+			sec.fileOffset = pos;
+			sec.data = std::span<const uint8_t>(mData + pos, sec.size);
+			pos += sec.size;
+
+			mSections.push_back(std::move(sec));
+		}
+
+		return true;
+	}
+
+	bool CSObj_Mapped_File::Parse_V2() {
+
+		if (mSize < sizeof(TFile_Header)) {
+			return false;
+		}
+
+		TFile_Header hdr;
+		std::memcpy(&hdr, mData, sizeof(hdr));
+
+		if (hdr.version != static_cast<uint16_t>(NVersion::V2) || hdr.headerSize < sizeof(TFile_Header)) {
+			return false;
+		}
+
+		mContent_Hash = hdr.contentHash;
+
+		// the tables must lie within the file
+		if (static_cast<uint64_t>(hdr.sectionTableOffset) + static_cast<uint64_t>(hdr.sectionCount) * sizeof(TSection_Entry) > mSize
+			|| static_cast<uint64_t>(hdr.stringTableOffset) + hdr.stringTableSize > mSize) {
+			return false;
+		}
+
+		for (uint32_t i = 0; i < hdr.sectionCount; i++) {
+
+			TSection_Entry entry;
+			std::memcpy(&entry, mData + hdr.sectionTableOffset + i * sizeof(TSection_Entry), sizeof(entry));
+
+			if (static_cast<uint64_t>(entry.nameOffset) + entry.nameLength > hdr.stringTableSize
+				|| entry.dataOffset > mSize || entry.storedSize > mSize - entry.dataOffset) {
+				return false;
+			}
+
+			// uncompressed payload must match the section size exactly, zero-filled section has no payload
+			if (Has_Flag(entry.flags, NSection_Flag::Zero_Fill)) {
+				if (entry.storedSize != 0) {
+					return false;
+				}
+			}
+			else if (!Has_Flag(entry.flags, NSection_Flag::Compressed) && entry.storedSize != entry.size) {
+				return false;
+			}
+
+			TSection_View sec;
+			sec.name.assign(reinterpret_cast<const char*>(mData + hdr.stringTableOffset + entry.nameOffset), entry.nameLength);
+			sec.startAddr = entry.startAddr;
+			sec.size = entry.size;
+			sec.flags = entry.flags;
+			sec.fileOffset = entry.dataOffset;
+			sec.data = std::span<const uint8_t>(mData + entry.dataOffset, static_cast<size_t>(entry.storedSize));
+
+			mSections.push_back(std::move(sec));
+		}
+
+		return true;
+	}
+
+	bool CSObj_Mapped_File::Verify() const {
+
+		if (mVersion != NVersion::V2) {
+			return true;
+		}
+
+		return Hash_FNV1a_64(std::span<const uint8_t>(mData + sizeof(TFile_Header), mSize - sizeof(TFile_Header))) == mContent_Hash;
+	}
+
+	bool CSObj_Mapped_File::Read_Section(const TSection_View& section, std::span<uint8_t> target) const {
+
+		if (target.size() != section.size) {
+			return false;
+		}
+
+		if (Has_Flag(section.flags, NSection_Flag::Zero_Fill)) {
+			std::memset(target.data(), 0, target.size());
+			return true;
+		}
+
+		if (Has_Flag(section.flags, NSection_Flag::Compressed)) {
+			return Decompress_LZ4_Block(section.data, target);
+		}
+
+		std::memcpy(target.data(), section.data.data(), section.data.size());
+		return true;
+	}
+
+}
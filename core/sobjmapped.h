@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <span>
+
+#include "sobjformat.h"
+
+namespace SObj {
+
+	// view of a section of a mapped object file - the data point directly into the mapped file
+	struct TSection_View {
+		std::string name;
+		uint32_t startAddr = 0;
+		// size of the section in memory
+		uint32_t size = 0;
+		// NSection_Flag bitmask
+		uint32_t flags = 0;
+		// offset of the section data within the file
+		uint64_t fileOffset = 0;
+		// stored data (compressed, if the section is compressed; empty for zero-filled section)
+		std::span<const uint8_t> data{};
+	};
+
+	/*
+	 * Read-only object file, mapped to memory
+	 *
+	 * Unlike CSObj_File, the section data are not copied anywhere - they are exposed as spans into the mapped file,
+	 * which stays mapped for the whole lifetime of this object
+	 */
+	class CSObj_Mapped_File {
+
+		private:
+			// mapped file contents
+			const uint8_t* mData = nullptr;
+			// size of the mapped file
+			size_t mSize = 0;
+			// native file descriptor (-1 if not available)
+			int mFd = -1;
+			// contents of the file, if it could not be mapped
+			std::vector<uint8_t> mFallback_Buffer;
+
+			// sections in the order of appearance in the file
+			std::vector<TSection_View> mSections;
+
+			// format version of the file
+			NVersion mVersion = NVersion::V1;
+			// content hash stored in the file header (v2 only)
+			uint64_t mContent_Hash = 0;
+
+			// parses the section table of the mapped file
+			bool Parse();
+			// parses the v1 file (sections interleaved with names)
+			bool Parse_V1();
+			// parses the v2 file (header and section table)
+			bool Parse_V2();
+			// unmaps the file and closes it
+			void Close();
+
+		public:
+			CSObj_Mapped_File() = default;
+			~CSObj_Mapped_File();
+
+			CSObj_Mapped_File(const CSObj_Mapped_File&) = delete;
+			CSObj_Mapped_File& operator=(const CSObj_Mapped_File&) = delete;
+
+			// maps given file and parses its section table; the section payloads are not touched
+			bool Open(const std::string& path);
+
+			// retrieves the format version of the file
+			NVersion Get_Version() const {
+				return mVersion;
+			}
+
+			// verifies the content hash (v2 only, v1 files have no hash and always pass)
+			bool Verify() const;
+
+			// materializes section contents (copies, decompresses or zero-fills) to given target of the section size
+			bool Read_Section(const TSection_View& section, std::span<uint8_t> target) const;
+
+			// retrieves the sections
+			const std::vector<TSection_View>& Get_Sections() const {
+				return mSections;
+			}
+
+			// retrieves the native file descriptor (to map the file contents elsewhere); -1 if not available
+			int Get_File_Descriptor() const {
+				return mFd;
+			}
+	};
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <deque>
+#include <unordered_map>
+
+namespace sarch32 {
+
+	// identifier of an interned string
+	using TString_Id = uint32_t;
+
+	/*
+	 * Pool of interned strings
+	 *
+	 * Every distinct string is stored just once and it is identified by a dense integer ID (in the order of interning),
+	 * so the users may keep per-string data in plain vectors indexed by the ID. Not thread safe
+	 */
+	class CString_Pool {
+
+		private:
+			// interned strings, indexed by ID (deque never moves the stored strings, so the lookup keys stay valid)
+			std::deque<std::string> mStrings;
+			// lookup of interned strings
+			std::unordered_map<std::string_view, TString_Id> mIds;
+
+		public:
+			CString_Pool() = default;
+
+			CString_Pool(const CString_Pool&) = delete;
+			CString_Pool& operator=(const CString_Pool&) = delete;
+
+			// interns given string and retrieves its ID; the same string always gets the same ID
+			TString_Id Intern(std::string_view str) {
+				if (auto itr = mIds.find(str); itr != mIds.end()) {
+					return itr->second;
+				}
+
+				const TString_Id id = static_cast<TString_Id>(mStrings.size());
+				const auto& stored = mStrings.emplace_back(str);
+				mIds.emplace(stored, id);
+				return id;
+			}
+
+			// finds ID of given string, if it was interned
+			bool Find(std::string_view str, TString_Id& id) const {
+				auto itr = mIds.find(str);
+				if (itr == mIds.end()) {
+					return false;
+				}
+
+				id = itr->second;
+				return true;
+			}
+
+			// retrieves interned string of given ID
+			const std::string& Get(TString_Id id) const {
+				return mStrings[id];
+			}
+
+			// retrieves number of interned strings (i.e., the first unused ID)
+			size_t Size() const {
+				return mStrings.size();
+			}
+	};
+
+}
@@ -0,0 +1,228 @@
+#include "symbols.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+namespace sarch32 {
+
+	namespace {
+
+		// finds the last record starting at or before given address, if the address falls within it
+		template<typename T>
+		const T* Find_Spanning(const std::vector<T>& records, uint32_t address) {
+			auto itr = std::upper_bound(records.begin(), records.end(), address, [](uint32_t addr, const T& rec) {
+				return addr < rec.address;
+			});
+
+			if (itr == records.begin()) {
+				return nullptr;
+			}
+
+			--itr;
+			return (address - itr->address < itr->size) ? &*itr : nullptr;
+		}
+	}
+
+	bool CSymbol_Index::Load(const SObj::CSObj_Mapped_File& file) {
+
+		Clear();
+
+		for (const auto& s : file.Get_Sections()) {
+
+			if (!SObj::Has_Flag(s.flags, SObj::NSection_Flag::Metadata)) {
+				continue;
+			}
+
+			// compressed tables need to be materialized first
+			std::vector<uint8_t> buffer;
+			std::span<const uint8_t> payload = s.data;
+			if (SObj::Has_Flag(s.flags, SObj::NSection_Flag::Compressed)) {
+				buffer.resize(s.size);
+				if (!file.Read_Section(s, buffer)) {
+					return false;
+				}
+				payload = buffer;
+			}
+
+			if (s.name == SObj::Symbol_Table_Section && !Load_Symbol_Table(payload)) {
+				return false;
+			}
+			else if (s.name == SObj::Line_Table_Section && !Load_Line_Table(payload)) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool CSymbol_Index::Load_Symbol_Table(std::span<const uint8_t> payload) {
+
+		size_t pos = 0;
+		SObj::TTable_Header hdr;
+		if (!SObj::Read_Table_Value(payload, pos, hdr)) {
+			return false;
+		}
+
+		// the entries must fit before they are parsed (the count is not trusted)
+		if (static_cast<uint64_t>(hdr.entryCount) * sizeof(SObj::TSymbol_Entry) > payload.size() - pos) {
+			return false;
+		}
+
+		const auto pool = payload.subspan(pos + hdr.entryCount * sizeof(SObj::TSymbol_Entry));
+
+		mSymbols.clear();
+		mSymbols.reserve(hdr.entryCount);
+
+		for (uint32_t i = 0; i < hdr.entryCount; i++) {
+			SObj::TSymbol_Entry entry;
+			SObj::Read_Table_Value(payload, pos, entry);
+
+			TSymbol sym{ entry.address, entry.size, {} };
+			if (!SObj::Read_Table_Name(pool, entry.name, sym.name)) {
+				mSymbols.clear();
+				return false;
+			}
+
+			mSymbols.push_back(std::move(sym));
+		}
+
+		// the table is stored sorted, but the lookups rely on it - better be sure
+		std::stable_sort(mSymbols.begin(), mSymbols.end(), [](const TSymbol& a, const TSymbol& b) { return a.address < b.address; });
+
+		return true;
+	}
+
+	bool CSymbol_Index::Load_Line_Table(std::span<const uint8_t> payload) {
+
+		size_t pos = 0;
+		SObj::TTable_Header hdr;
+		if (!SObj::Read_Table_Value(payload, pos, hdr)) {
+			return false;
+		}
+
+		const uint64_t tablesSize = static_cast<uint64_t>(hdr.fileCount) * sizeof(SObj::TName_Ref) + static_cast<uint64_t>(hdr.entryCount) * sizeof(SObj::TLine_Entry);
+		if (tablesSize > payload.size() - pos) {
+			return false;
+		}
+
+		const auto pool = payload.subspan(pos + static_cast<size_t>(tablesSize));
+
+		mFiles.clear();
+		mLines.clear();
+		mFiles.reserve(hdr.fileCount);
+		mLines.reserve(hdr.entryCount);
+
+		for (uint32_t i = 0; i < hdr.fileCount; i++) {
+			SObj::TName_Ref ref;
+			SObj::Read_Table_Value(payload, pos, ref);
+
+			if (!SObj::Read_Table_Name(pool, ref, mFiles.emplace_back())) {
+				mFiles.clear();
+				return false;
+			}
+		}
+
+		for (uint32_t i = 0; i < hdr.entryCount; i++) {
+			SObj::TLine_Entry entry;
+			SObj::Read_Table_Value(payload, pos, entry);
+
+			if (entry.fileIndex >= mFiles.size()) {
+				mFiles.clear();
+				mLines.clear();
+				return false;
+			}
+
+			mLines.push_back({ entry.address, entry.size, entry.line, entry.fileIndex });
+		}
+
+		std::stable_sort(mLines.begin(), mLines.end(), [](const TSource_Line& a, const TSource_Line& b) { return a.address < b.address; });
+
+		return true;
+	}
+
+	void CSymbol_Index::Clear() {
+		mSymbols.clear();
+		mLines.clear();
+		mFiles.clear();
+	}
+
+	const TSymbol* CSymbol_Index::Find_Symbol(uint32_t address) const {
+		return Find_Spanning(mSymbols, address);
+	}
+
+	const TSource_Line* CSymbol_Index::Find_Line(uint32_t address) const {
+		return Find_Spanning(mLines, address);
+	}
+
+	const std::string& CSymbol_Index::Get_File_Name(const TSource_Line& line) const {
+		return mFiles[line.fileIndex];
+	}
+
+	std::string CSymbol_Index::Format_Symbol(uint32_t address) const {
+
+		const auto* sym = Find_Symbol(address);
+		if (!sym) {
+			return {};
+		}
+
+		std::ostringstream oss;
+		oss << "$" << sym->name;
+		if (address != sym->address) {
+			oss << "+0x" << std::hex << (address - sym->address);
+		}
+
+		return oss.str();
+	}
+
+	std::string CSymbol_Index::Format_Line(uint32_t address) const {
+
+		const auto* line = Find_Line(address);
+		if (!line) {
+			return {};
+		}
+
+		return Get_File_Name(*line) + ":" + std::to_string(line->line);
+	}
+
+	std::vector<uint8_t> CSymbol_Index::Serialize_Symbol_Table(std::vector<TSymbol> symbols) {
+
+		std::stable_sort(symbols.begin(), symbols.end(), [](const TSymbol& a, const TSymbol& b) { return a.address < b.address; });
+
+		std::vector<uint8_t> payload;
+		std::string pool;
+
+		SObj::Append_Table_Value(payload, SObj::TTable_Header{ static_cast<uint32_t>(symbols.size()), 0 });
+
+		for (const auto& sym : symbols) {
+			SObj::Append_Table_Value(payload, SObj::TSymbol_Entry{ sym.address, sym.size, SObj::Append_Table_Name(pool, sym.name) });
+		}
+
+		payload.insert(payload.end(), pool.begin(), pool.end());
+
+		return payload;
+	}
+
+	std::vector<uint8_t> CSymbol_Index::Serialize_Line_Table(std::vector<TSource_Line> lines, const std::vector<std::string>& files) {
+
+		std::stable_sort(lines.begin(), lines.end(), [](const TSource_Line& a, const TSource_Line& b) { return a.address < b.address; });
+
+		std::vector<uint8_t> payload;
+		std::string pool;
+
+		SObj::Append_Table_Value(payload, SObj::TTable_Header{ static_cast<uint32_t>(lines.size()), static_cast<uint32_t>(files.size()) });
+
+		for (const auto& f : files) {
+			SObj::Append_Table_Value(payload, SObj::Append_Table_Name(pool, f));
+		}
+
+		for (const auto& line : lines) {
+			SObj::Append_Table_Value(payload, SObj::TLine_Entry{ line.address, line.size, line.line, line.fileIndex });
+		}
+
+		payload.insert(payload.end(), pool.begin(), pool.end());
+
+		return payload;
+	}
+
+}
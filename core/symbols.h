@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <span>
+
+#include "sobjmapped.h"
+
+namespace sarch32 {
+
+	// symbol record (label and the range it spans)
+	struct TSymbol {
+		uint32_t address;
+		uint32_t size;
+		std::string name;
+	};
+
+	// source line record (range generated by the line)
+	struct TSource_Line {
+		uint32_t address;
+		uint32_t size;
+		uint32_t line;
+		uint32_t fileIndex;
+	};
+
+	/*
+	 * Symbol and source line index
+	 *
+	 * Built from metadata sections of an object file; all lookups are binary searches over address-sorted arrays
+	 */
+	class CSymbol_Index {
+
+		private:
+			// symbols sorted by address
+			std::vector<TSymbol> mSymbols;
+			// source lines sorted by address
+			std::vector<TSource_Line> mLines;
+			// source file names
+			std::vector<std::string> mFiles;
+
+		public:
+			CSymbol_Index() = default;
+
+			// builds the index from metadata sections of given object file; the file does not have to contain any
+			bool Load(const SObj::CSObj_Mapped_File& file);
+			// parses symbol table section payload
+			bool Load_Symbol_Table(std::span<const uint8_t> payload);
+			// parses line table section payload
+			bool Load_Line_Table(std::span<const uint8_t> payload);
+			// clears the index
+			void Clear();
+
+			// is there anything to look up?
+			bool Is_Empty() const {
+				return mSymbols.empty() && mLines.empty();
+			}
+
+			// finds a symbol spanning given address; nullptr if there is none
+			const TSymbol* Find_Symbol(uint32_t address) const;
+			// finds a source line that generated given address; nullptr if there is none
+			const TSource_Line* Find_Line(uint32_t address) const;
+
+			// retrieves source file name of given line record
+			const std::string& Get_File_Name(const TSource_Line& line) const;
+
+			// formats address relative to a symbol (e.g., "$irqhandler+0x8"); empty, if there is no such symbol
+			std::string Format_Symbol(uint32_t address) const;
+			// formats source location (e.g., "main.s:42"); empty, if there is no such line
+			std::string Format_Line(uint32_t address) const;
+
+			// serializes symbols to symbol table section payload
+			static std::vector<uint8_t> Serialize_Symbol_Table(std::vector<TSymbol> symbols);
+			// serializes source lines to line table section payload
+			static std::vector<uint8_t> Serialize_Line_Table(std::vector<TSource_Line> lines, const std::vector<std::string>& files);
+	};
+
+}
@@ -0,0 +1,130 @@
+#include "trace.h"
+
+#include <map>
+#include <iomanip>
+
+namespace sarch32 {
+
+	CTrace_Buffer::CTrace_Buffer(size_t capacity) : mRecords(capacity > 0 ? capacity : 1) {
+		//
+	}
+
+	void CTrace_Buffer::Record(int32_t svcNum, uint64_t cycle, uint32_t pc, uint32_t value) {
+
+		// overwrite the oldest record, if the buffer is full
+		if (mCount == mRecords.size()) {
+			mDropped++;
+		}
+		else {
+			mCount++;
+		}
+
+		mRecords[mHead] = {
+			cycle,
+			pc,
+			value,
+			static_cast<uint16_t>(svcNum & Trace_Svc_Id_Mask),
+			static_cast<NTrace_Record_Type>((svcNum >> 12) & 0xF)
+		};
+
+		mHead = (mHead + 1) % mRecords.size();
+	}
+
+	void CTrace_Buffer::Clear() {
+		mHead = 0;
+		mCount = 0;
+		mDropped = 0;
+	}
+
+	std::vector<TTrace_Record> CTrace_Buffer::Get_Records() const {
+
+		std::vector<TTrace_Record> result;
+		result.reserve(mCount);
+
+		// the oldest record is right after the head, if the buffer wrapped around
+		const size_t start = (mHead + mRecords.size() - mCount) % mRecords.size();
+		for (size_t i = 0; i < mCount; i++) {
+			result.push_back(mRecords[(start + i) % mRecords.size()]);
+		}
+
+		return result;
+	}
+
+	void CTrace_Buffer::Dump(std::ostream& os, const CSymbol_Index* symbols) const {
+
+		// per-region statistics
+		struct TRegion_Stats {
+			std::vector<uint64_t> openCycles;	// stack of begin cycles (regions may nest/recurse)
+			uint64_t count = 0;
+			uint64_t total = 0;
+			uint64_t min = UINT64_MAX;
+			uint64_t max = 0;
+		};
+
+		std::map<uint16_t, TRegion_Stats> regions;
+
+		os << "; cycle, pc, type, id, value" << std::endl;
+
+		for (const auto& r : Get_Records()) {
+
+			os << std::dec << r.cycle << ", 0x" << std::hex << std::setw(8) << std::setfill('0') << r.pc << ", ";
+
+			switch (r.type) {
+				case NTrace_Record_Type::Region_Begin:
+					os << "begin";
+					regions[r.id].openCycles.push_back(r.cycle);
+					break;
+				case NTrace_Record_Type::Region_End:
+				{
+					os << "end";
+					auto& reg = regions[r.id];
+					// unpaired end (e.g., the begin record was overwritten) - nothing to measure
+					if (!reg.openCycles.empty()) {
+						const uint64_t duration = r.cycle - reg.openCycles.back();
+						reg.openCycles.pop_back();
+						reg.count++;
+						reg.total += duration;
+						reg.min = std::min(reg.min, duration);
+						reg.max = std::max(reg.max, duration);
+					}
+					break;
+				}
+				case NTrace_Record_Type::Counter:
+					os << "counter";
+					break;
+				case NTrace_Record_Type::Marker:
+				default:
+					os << "marker";
+					break;
+			}
+
+			os << ", " << std::dec << r.id << ", " << r.value;
+
+			// the record holds address of the instruction following the marker
+			if (symbols) {
+				if (const auto sym = symbols->Format_Symbol(r.pc - 4); !sym.empty()) {
+					os << " ; " << sym;
+				}
+			}
+
+			os << std::endl;
+		}
+
+		os << std::dec;
+
+		if (mDropped > 0) {
+			os << "; " << mDropped << " records dropped due to buffer overflow" << std::endl;
+		}
+
+		// region summary - count, total, mean, min and max cycles
+		for (const auto& reg : regions) {
+			if (reg.second.count == 0) {
+				continue;
+			}
+
+			os << "; region " << reg.first << ": count " << reg.second.count << ", total " << reg.second.total
+				<< ", mean " << (reg.second.total / reg.second.count) << ", min " << reg.second.min << ", max " << reg.second.max << " cycles" << std::endl;
+		}
+	}
+
+}
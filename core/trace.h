@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <ostream>
+
+#include "symbols.h"
+
+namespace sarch32 {
+
+	/*
+	 * Type of a guest-emitted trace record
+	 */
+	enum class NTrace_Record_Type {
+		Region_Begin = 0,	// start of a measured region
+		Region_End = 1,		// end of a measured region
+		Counter = 2,		// counter sample (value = contents of R0)
+		Marker = 3,			// single point-in-time marker (value = contents of R0)
+
+		count
+	};
+
+	/*
+	 * Supervisor call numbers reserved for trace markers
+	 *
+	 * The number is encoded as 0x7F<type:4><id:12>, e.g.:
+	 *    svc #0x7F0005    ; begin region 5
+	 *    svc #0x7F1005    ; end region 5
+	 *    svc #0x7F2001    ; sample counter 1 with value in R0
+	 *
+	 * These calls are handled by the emulator inline and are never vectored through the IVT
+	 */
+	constexpr int32_t Trace_Svc_Base = 0x7F0000;
+	// mask of the trace ID part of the supervisor call number
+	constexpr int32_t Trace_Svc_Id_Mask = 0xFFF;
+	// default capacity of the trace buffer (records)
+	constexpr size_t Default_Trace_Buffer_Capacity = 64 * 1024;
+
+	// is the given supervisor call number a trace marker?
+	inline constexpr bool Is_Trace_Svc_Number(int32_t svcNum) {
+		return svcNum >= Trace_Svc_Base && svcNum < Trace_Svc_Base + (static_cast<int32_t>(NTrace_Record_Type::count) << 12);
+	}
+
+	// builds supervisor call number for given trace record type and ID
+	inline constexpr int32_t Get_Trace_Svc_Number(NTrace_Record_Type type, uint16_t id) {
+		return Trace_Svc_Base | (static_cast<int32_t>(type) << 12) | (id & Trace_Svc_Id_Mask);
+	}
+
+	// single record in trace buffer
+	struct TTrace_Record {
+		uint64_t cycle;				// cycle count at the moment of recording
+		uint32_t pc;				// address of the instruction following the marker
+		uint32_t value;				// R0 contents at the moment of recording
+		uint16_t id;				// region/counter ID
+		NTrace_Record_Type type;	// record type
+	};
+
+	/*
+	 * Host trace buffer - a ring buffer of guest trace records
+	 *
+	 * When the buffer is full, the oldest records are overwritten
+	 */
+	class CTrace_Buffer {
+
+		private:
+			// record storage
+			std::vector<TTrace_Record> mRecords;
+			// index of the next record to be written
+			size_t mHead = 0;
+			// number of valid records
+			size_t mCount = 0;
+			// number of records overwritten due to buffer overflow
+			uint64_t mDropped = 0;
+
+		public:
+			CTrace_Buffer(size_t capacity = Default_Trace_Buffer_Capacity);
+
+			// records a trace event decoded from supervisor call number
+			void Record(int32_t svcNum, uint64_t cycle, uint32_t pc, uint32_t value);
+			// clears the buffer
+			void Clear();
+
+			// retrieves records in chronological order
+			std::vector<TTrace_Record> Get_Records() const;
+
+			// retrieves the number of records lost due to buffer overflow
+			uint64_t Get_Dropped_Count() const {
+				return mDropped;
+			}
+
+			// dumps all records and paired region durations in a textual form; records are annotated by symbols, if available
+			void Dump(std::ostream& os, const CSymbol_Index* symbols = nullptr) const;
+	};
+
+}
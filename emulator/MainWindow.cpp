@@ -6,11 +6,19 @@
 #include <QtWidgets/QMessageBox>
 #include <QtWidgets/QStatusBar>
 #include <QtWidgets/QMenuBar>
+#include <QtWidgets/QFileDialog>
+#include <QtWidgets/QAction>
+#include <QtCore/QFileInfo>
 #include <QtGui/QTextBlock>
 #include <QtGui/QTextLayout>
 #include <QtGui/QAbstractTextDocumentLayout>
 
 #include <iostream>
+#include <fstream>
+
+// number of instructions executed by the run thread at once - the machine state is published and the widgets are refreshed
+// once per batch, not after every single instruction
+constexpr size_t Run_Batch_Steps = 1024;
 
 CMain_Window::CMain_Window()
 	: QMainWindow() {
@@ -23,7 +31,7 @@ bool CMain_Window::Setup_Machine(const CConfig& config) {
 
 	// create machine
 	if (config.Get_Machine_Name() == "default" || config.Get_Machine_Name() == "sarch32_001") {
-		mMachine = std::make_unique<sarch32::CMachine>(config.Get_Memory_Size());
+		mMachine = std::make_unique<sarch32::CMachine>(config.Get_Memory_Size(), config.Is_Memory_Guarded() ? sarch32::NMemory_Mode::Guarded : sarch32::NMemory_Mode::Checked);
 	}
 	else {
 		QMessageBox::critical(nullptr, "Error", tr("Unknown machine type: {}").arg(QString::fromStdString(config.Get_Machine_Name())));
@@ -32,8 +40,17 @@ bool CMain_Window::Setup_Machine(const CConfig& config) {
 
 	mMachine->Reset(false);
 
+	if (config.Get_Engine() == "predecoded") {
+		mMachine->Set_Execution_Engine(sarch32::NExecution_Engine::Predecoded);
+	}
+
+	// export the machine state for external monitors (before the memory is initialized, the export discards it)
+	if (!config.Get_Shared_State().empty() && !mMachine->Enable_State_Export(config.Get_Shared_State())) {
+		QMessageBox::warning(nullptr, "Warning", "Could not export machine state to shared memory");
+	}
+
 	// init memory from given file
-	if (!mMachine->Init_Memory_From_File(config.Get_Memory_Image())) {
+	if (!mMachine->Init_Memory_From_File(config.Get_Memory_Image(), true)) {
 		QMessageBox::critical(nullptr, "Error", "Could not load memory object file");
 	}
 
@@ -118,9 +135,15 @@ void CMain_Window::On_Refresh_Disassembly() {
 	std::vector<SObj::TSection> sorted;
 
 	for (auto& s : sec) {
-		sorted.push_back(s.second);
+		// metadata sections are not present in memory
+		if (!SObj::Has_Flag(s.second.flags, SObj::NSection_Flag::Metadata)) {
+			sorted.push_back(s.second);
+		}
 	}
 
+	// symbols and source lines (if the object file contains them)
+	const auto& symbols = mMachine->Get_Symbol_Index();
+
 	std::sort(sorted.begin(), sorted.end(), [](const SObj::TSection& a, const SObj::TSection& b) { return a.startAddr < b.startAddr; });
 
 	// format the outputs to stringstream
@@ -154,6 +177,13 @@ void CMain_Window::On_Refresh_Disassembly() {
 		// create section break at current line
 		mSection_Breaks.push_back({ s.startAddr, lineIndex });
 
+		// zero-filled sections hold no code, just indicate the reserved space
+		if (SObj::Has_Flag(s.flags, SObj::NSection_Flag::Zero_Fill)) {
+			oss << formatAddr(s.startAddr) << (mIs_Hexa ? "     " : "   ") << "(zero-filled, " << s.size << " bytes)" << lineBreak();
+			oss << "..." << lineBreak();
+			continue;
+		}
+
 		// go through the section assembly with a step of 4 bytes
 		for (cur = 0; cur < s.size; cur += 4) {
 
@@ -173,6 +203,23 @@ void CMain_Window::On_Refresh_Disassembly() {
 				oss << "???";
 			}
 
+			// annotate the line with symbol and source location
+			if (!symbols.Is_Empty()) {
+				const uint32_t addr = s.startAddr + static_cast<uint32_t>(cur);
+				const auto* sym = symbols.Find_Symbol(addr);
+				const auto line = symbols.Format_Line(addr);
+
+				if ((sym && sym->address == addr) || !line.empty()) {
+					oss << "\t\t;";
+				}
+				if (sym && sym->address == addr) {
+					oss << " <$" << sym->name << ">";
+				}
+				if (!line.empty()) {
+					oss << " " << line;
+				}
+			}
+
 			oss << lineBreak();
 		}
 
@@ -339,7 +386,7 @@ void CMain_Window::Run_Thread_Fnc() {
 
 		pcPrev = mMachine->Get_CPU_Context().Reg(NRegister::PC);
 
-		mMachine->Step(1, true);
+		mMachine->Step(Run_Batch_Steps, true);
 
 		// request display update
 		if (mDisplay && mDisplay->Is_Memory_Changed()) {
@@ -356,7 +403,7 @@ void CMain_Window::Run_Thread_Fnc() {
 			emit Request_UART_Repaint();
 		}
 
-		// detect stalling - an infinite loop
+		// detect stalling - an infinite loop (the CPU ends every batch at the same place)
 		if (mMachine->Get_CPU_Context().Reg(NRegister::PC) == pcPrev)
 			std::this_thread::sleep_for(std::chrono::milliseconds(1));
 	}
@@ -391,12 +438,51 @@ void CMain_Window::Setup_GUI() {
 		// "File" menu
 		QMenu* fileMenu = new QMenu("&File", menuBar);
 		{
+			auto reloadAction = fileMenu->addAction("&Reload image");
+			reloadAction->setShortcut(QKeySequence("Ctrl+R"));
+			connect(reloadAction, SIGNAL(triggered()), this, SLOT(On_Reload_Image_Clicked()));
+
+			auto reloadResetAction = fileMenu->addAction("Reload image and reset &CPU");
+			reloadResetAction->setShortcut(QKeySequence("Ctrl+Shift+R"));
+			connect(reloadResetAction, SIGNAL(triggered()), this, SLOT(On_Reload_Image_Reset_Clicked()));
+
+			fileMenu->addSeparator();
+
 			auto quitAction = fileMenu->addAction("&Exit");
 			connect(quitAction, SIGNAL(triggered()), qApp, SLOT(quit()));
 		}
 
 		menuBar->addMenu(fileMenu);
 
+		// "Debug" menu
+		QMenu* debugMenu = new QMenu("&Debug", menuBar);
+		{
+			auto traceAction = debugMenu->addAction("Export &trace markers...");
+			connect(traceAction, SIGNAL(triggered()), this, SLOT(On_Export_Trace_Clicked()));
+
+			debugMenu->addSeparator();
+
+			auto coverageAction = debugMenu->addAction("Record &coverage");
+			coverageAction->setCheckable(true);
+			coverageAction->setChecked(mMachine->Is_Coverage_Enabled());
+			connect(coverageAction, SIGNAL(toggled(bool)), this, SLOT(On_Coverage_Toggled(bool)));
+
+			auto exportCoverageAction = debugMenu->addAction("Export c&overage...");
+			connect(exportCoverageAction, SIGNAL(triggered()), this, SLOT(On_Export_Coverage_Clicked()));
+
+			debugMenu->addSeparator();
+
+			auto profileAction = debugMenu->addAction("Record &profile");
+			profileAction->setCheckable(true);
+			profileAction->setChecked(mMachine->Is_Profiling_Enabled());
+			connect(profileAction, SIGNAL(toggled(bool)), this, SLOT(On_Profile_Toggled(bool)));
+
+			auto exportProfileAction = debugMenu->addAction("Export p&rofile...");
+			connect(exportProfileAction, SIGNAL(triggered()), this, SLOT(On_Export_Profile_Clicked()));
+		}
+
+		menuBar->addMenu(debugMenu);
+
 		// "Help" menu
 		QMenu* helpMenu = new QMenu("&Help", menuBar);
 		{
@@ -596,6 +682,11 @@ void CMain_Window::Setup_GUI() {
 	connect(this, SIGNAL(Request_GPIO_Repaint()), this, SLOT(On_Request_GPIO_Repaint()));
 	connect(this, SIGNAL(Request_UART_Repaint()), this, SLOT(On_Request_UART_Repaint()));
 
+	// watch the memory image - the reload is offered whenever it is rebuilt
+	mImage_Watcher = new QFileSystemWatcher(this);
+	mImage_Watcher->addPath(QString::fromStdString(mObject_File));
+	connect(mImage_Watcher, SIGNAL(fileChanged(const QString&)), this, SLOT(On_Image_File_Changed(const QString&)));
+
 	statusBar()->setStyleSheet("QStatusBar{ border-top: 1px outset grey; }");
 	statusBar()->showMessage(tr("Ready"));
 
@@ -605,6 +696,178 @@ void CMain_Window::Setup_GUI() {
 	emit Request_Update_Button_State();
 }
 
+void CMain_Window::Reload_Image(bool resetCpu) {
+
+	// the machine must not be stepped during the reload
+	const bool wasRunning = mIs_Running;
+	if (mRun_Thread && mRun_Thread->joinable()) {
+		mIs_Running = false;
+		mRun_Thread->join();
+	}
+
+	sarch32::TReload_Stats stats;
+	if (!mMachine->Reload_Image(mObject_File, resetCpu, &stats)) {
+		QMessageBox::critical(this, "Error", "Could not reload memory object file");
+	}
+	else {
+		statusBar()->showMessage(tr("Image reloaded: %1 section(s) changed, %2 dropped, %3 byte(s) patched")
+			.arg(stats.changedSections).arg(stats.droppedSections).arg(stats.patchedBytes));
+	}
+
+	emit Refresh_Disassembly();
+	emit Refresh_Registers();
+
+	if (wasRunning) {
+		On_Run_Requested();
+	}
+	else {
+		emit Request_Update_Button_State();
+	}
+}
+
+void CMain_Window::On_Reload_Image_Clicked() {
+	Reload_Image(false);
+}
+
+void CMain_Window::On_Reload_Image_Reset_Clicked() {
+	Reload_Image(true);
+}
+
+void CMain_Window::On_Image_File_Changed(const QString& path) {
+
+	// the image is usually replaced by a new file (renamed over the old one), which drops it from the watch list
+	if (!mImage_Watcher->files().contains(path) && QFileInfo::exists(path)) {
+		mImage_Watcher->addPath(path);
+	}
+
+	// a rebuild may fire several notifications - ask just once
+	if (mReload_Prompt_Open || !QFileInfo::exists(path)) {
+		return;
+	}
+
+	mReload_Prompt_Open = true;
+
+	QMessageBox box(QMessageBox::Question, "Image changed", "The memory image has been rebuilt. Reload it into the running machine?", QMessageBox::NoButton, this);
+	auto reloadButton = box.addButton("Reload", QMessageBox::AcceptRole);
+	auto resetButton = box.addButton("Reload and reset CPU", QMessageBox::AcceptRole);
+	box.addButton("Ignore", QMessageBox::RejectRole);
+	box.exec();
+
+	mReload_Prompt_Open = false;
+
+	if (box.clickedButton() == reloadButton) {
+		Reload_Image(false);
+	}
+	else if (box.clickedButton() == resetButton) {
+		Reload_Image(true);
+	}
+}
+
+void CMain_Window::On_Export_Trace_Clicked() {
+
+	// the trace buffer is written by the run thread
+	if (mIs_Running) {
+		QMessageBox::warning(this, "Export trace", "Pause the machine before exporting the trace");
+		return;
+	}
+
+	const QString path = QFileDialog::getSaveFileName(this, "Export trace markers", "", "Trace files (*.trace);;All files (*)");
+	if (path.isEmpty()) {
+		return;
+	}
+
+	std::ofstream ofs(path.toStdString());
+	if (!ofs.is_open()) {
+		QMessageBox::critical(this, "Error", "Could not open output file");
+		return;
+	}
+
+	mMachine->Get_Trace_Buffer().Dump(ofs, &mMachine->Get_Symbol_Index());
+
+	statusBar()->showMessage(tr("Trace exported"));
+}
+
+void CMain_Window::On_Coverage_Toggled(bool checked) {
+
+	// coverage is a machine plugin - plugins can't be attached while the run thread steps the machine
+	if (mIs_Running) {
+		if (auto action = qobject_cast<QAction*>(sender())) {
+			QSignalBlocker blocker(action);
+			action->setChecked(!checked);
+		}
+		QMessageBox::warning(this, "Record coverage", "Pause the machine before toggling the coverage recording");
+		return;
+	}
+
+	mMachine->Set_Coverage_Enabled(checked);
+}
+
+void CMain_Window::On_Export_Coverage_Clicked() {
+
+	// the coverage map is written by the run thread
+	if (mIs_Running) {
+		QMessageBox::warning(this, "Export coverage", "Pause the machine before exporting the coverage");
+		return;
+	}
+
+	const QString path = QFileDialog::getSaveFileName(this, "Export coverage", "", "Coverage files (*.cov);;All files (*)");
+	if (path.isEmpty()) {
+		return;
+	}
+
+	std::ofstream ofs(path.toStdString());
+	if (!ofs.is_open()) {
+		QMessageBox::critical(this, "Error", "Could not open output file");
+		return;
+	}
+
+	// textual section-relative map, raw edge map is stored alongside
+	mMachine->Dump_Coverage(ofs);
+	mMachine->Get_Coverage().Save_Edge_Map(path.toStdString() + ".edges");
+
+	statusBar()->showMessage(tr("Coverage exported"));
+}
+
+void CMain_Window::On_Profile_Toggled(bool checked) {
+
+	// profile is a machine plugin - plugins can't be attached while the run thread steps the machine
+	if (mIs_Running) {
+		if (auto action = qobject_cast<QAction*>(sender())) {
+			QSignalBlocker blocker(action);
+			action->setChecked(!checked);
+		}
+		QMessageBox::warning(this, "Record profile", "Pause the machine before toggling the profile recording");
+		return;
+	}
+
+	mMachine->Set_Profiling_Enabled(checked);
+}
+
+void CMain_Window::On_Export_Profile_Clicked() {
+
+	// the profile is written by the run thread
+	if (mIs_Running) {
+		QMessageBox::warning(this, "Export profile", "Pause the machine before exporting the profile");
+		return;
+	}
+
+	const QString path = QFileDialog::getSaveFileName(this, "Export profile", "", "Profile files (*.prof);;All files (*)");
+	if (path.isEmpty()) {
+		return;
+	}
+
+	std::ofstream ofs(path.toStdString());
+	if (!ofs.is_open()) {
+		QMessageBox::critical(this, "Error", "Could not open output file");
+		return;
+	}
+
+	// counts per address and per symbol - the assembler takes it with -profile
+	mMachine->Dump_Profile(ofs);
+
+	statusBar()->showMessage(tr("Profile exported"));
+}
+
 void CMain_Window::On_About_Clicked() {
 	QMessageBox::about(this, "About", tr(	"<b>SArch32 emulator</b><br>Created by: Martin Ubl (<a href='mailto:martinubl@seznam.cz'>martinubl@seznam.cz</a>)<br><br>"
 											"Experimental ISA, assembler and emulator, created for educational purposes.<br><br>"
@@ -9,6 +9,7 @@
 #include <QtWidgets/QTextEdit>
 #include <QtWidgets/QWidget>
 #include <QtWidgets/QRadioButton>
+#include <QtCore/QFileSystemWatcher>
 
 #include <array>
 #include <memory>
@@ -87,9 +88,16 @@ class CMain_Window : public QMainWindow {
 		// run thread for free running
 		std::unique_ptr<std::thread> mRun_Thread;
 
+		// watcher of the memory object file (to offer reload when it is rebuilt)
+		QFileSystemWatcher* mImage_Watcher = nullptr;
+		// is the reload question being shown?
+		bool mReload_Prompt_Open = false;
+
 	protected:
 		void Run_Thread_Fnc();
 		void Update_Button_State();
+		// reloads the memory object file into the machine (pauses the machine for the time of reload)
+		void Reload_Image(bool resetCpu);
 
 	signals:
 		void Refresh_Registers();
@@ -119,6 +127,18 @@ class CMain_Window : public QMainWindow {
 		void On_Decimal_Fmt_Selected();
 		void On_Hexadecimal_Fmt_Selected();
 
+		// image reload slots
+		void On_Reload_Image_Clicked();
+		void On_Reload_Image_Reset_Clicked();
+		void On_Image_File_Changed(const QString& path);
+
+		// debug slots
+		void On_Export_Trace_Clicked();
+		void On_Coverage_Toggled(bool checked);
+		void On_Export_Coverage_Clicked();
+		void On_Profile_Toggled(bool checked);
+		void On_Export_Profile_Clicked();
+
 		// misc slots
 		void On_About_Clicked();
 
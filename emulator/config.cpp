@@ -78,6 +78,24 @@ bool CConfig::Load_From_File(const std::string& path, std::string& error) {
 			else if (key == "image") {
 				mMemory_Image = value;
 			}
+			else if (key == "memory_mode") {
+				if (value != "checked" && value != "guarded") {
+					error = "Unknown memory mode: " + value;
+					return false;
+				}
+				mMemory_Guarded = (value == "guarded");
+			}
+			else if (key == "engine") {
+				if (value != "interpreter" && value != "predecoded") {
+					error = "Unknown execution engine: " + value;
+					return false;
+				}
+				mEngine = value;
+			}
+			else if (key == "shared_state") {
+				// POSIX shared memory object names start with a slash
+				mShared_State = value.starts_with("/") ? value : ("/" + value);
+			}
 			else {
 				error = "Unknown key in config: " + key;
 				return false;
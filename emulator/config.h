@@ -19,6 +19,12 @@ class CConfig {
 		std::string mMemory_Image{};
 		// connected peripherals
 		std::map<std::string, std::string> mPeripherals;
+		// execution engine name
+		std::string mEngine = "interpreter";
+		// guard the main memory by host guard region instead of checking every access
+		bool mMemory_Guarded = false;
+		// name of shared memory object to export the machine state to (empty = no export)
+		std::string mShared_State{};
 
 	public:
 		CConfig();
@@ -42,6 +48,21 @@ class CConfig {
 			return mMemory_Image;
 		}
 
+		// retrieve main memory guarding setting from config
+		bool Is_Memory_Guarded() const {
+			return mMemory_Guarded;
+		}
+
+		// retrieve name of shared memory object for machine state export (empty if not requested)
+		const std::string& Get_Shared_State() const {
+			return mShared_State;
+		}
+
+		// retrieve execution engine name from config
+		const std::string& Get_Engine() const {
+			return mEngine;
+		}
+
 		// retrieve peripheral map from config
 		const std::map<std::string, std::string>& Get_Peripherals() const {
 			return mPeripherals;
@@ -6,8 +6,8 @@ void CDisplay_Widget::paintEvent(QPaintEvent* event)
 	QPainter painter;
 	painter.begin(this);
 
-	// fill background - default color is black
-	const QRect r(0, 0, width(), height());
+	// fill background - default color is black; just the invalidated rows are painted
+	const QRect r = event->rect();
 	painter.fillRect(r, Qt::black);
 
 	// prepare pen (white)
@@ -20,10 +20,14 @@ void CDisplay_Widget::paintEvent(QPaintEvent* event)
 
 	const size_t maxOffset = static_cast<size_t>(width()) * static_cast<size_t>(height());
 
-	// go through the video memory
-	for (size_t i = 0; i < mDisplay_Buffer.size() && i < maxOffset; i++) {
+	// bytes covering the invalidated rows
+	const size_t first = static_cast<size_t>(r.top()) * static_cast<size_t>(width()) / 8;
+	const size_t last = (static_cast<size_t>(r.bottom()) + 1) * static_cast<size_t>(width()) / 8 + 1;
 
-		const uint8_t b = mDisplay_Buffer[i];
+	// go through the video memory - it is read directly while the machine runs, the worst case is a torn frame
+	for (size_t i = first; i < last && i < mVideo_Memory.size() && i < maxOffset; i++) {
+
+		const uint8_t b = mVideo_Memory[i];
 
 		// 1 byte = 8 pixels (set = white, clear = black)
 		for (int j = 0; j < 8; j++) {
@@ -44,16 +48,21 @@ void CDisplay_Widget::paintEvent(QPaintEvent* event)
 
 void CDisplay_Widget::Trigger_Repaint(std::shared_ptr<sarch32::IDisplay>& display, sarch32::CMemory_Bus& bus) {
 
-	// TODO: solve this better, this is obviously ineffective, but serves as a starting point
-
-	if (!display->Is_Memory_Changed()) {
+	// just the range written since the last repaint is painted again
+	const auto range = display->Take_Changed_Range();
+	if (range.first >= range.second) {
 		return;
 	}
 
-	display->Clear_Memory_Changed_Flag();
+	mVideo_Memory = bus.Get_Span(sarch32::Video_Memory_Start, sarch32::Video_Memory_End - sarch32::Video_Memory_Start);
+
+	if (width() <= 0) {
+		return;
+	}
 
-	mDisplay_Buffer.resize(sarch32::Video_Memory_End - sarch32::Video_Memory_Start);
-	bus.Read(sarch32::Video_Memory_Start, &mDisplay_Buffer[0], sarch32::Video_Memory_End - sarch32::Video_Memory_Start);
+	// repaint just the rows covering the changed range
+	const int firstRow = static_cast<int>(static_cast<size_t>(range.first) * 8 / width());
+	const int lastRow = static_cast<int>((static_cast<size_t>(range.second) * 8 - 1) / width());
 
-	emit repaint();
+	update(0, firstRow, width(), lastRow - firstRow + 1);
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <span>
 #include <memory>
 
 #include <QtWidgets/QWidget>
@@ -16,8 +17,8 @@
 class CDisplay_Widget : public QWidget
 {
 	private:
-		// copy of a display buffer
-		std::vector<uint8_t> mDisplay_Buffer;
+		// view of the video memory (guest memory, no copy)
+		std::span<const uint8_t> mVideo_Memory;
 
 	public:
 		explicit CDisplay_Widget(QWidget* parent = nullptr) : QWidget(parent) {
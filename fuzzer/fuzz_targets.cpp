@@ -0,0 +1,147 @@
+#include "fuzz_targets.h"
+
+#include "../core/isa.h"
+#include "../core/machine.h"
+#include "../core/lockstep.h"
+
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// reports invariant violation and aborts (so the fuzzer records a crash)
+[[noreturn]] static void Fuzz_Fail(const std::string& what, uint32_t word) {
+	std::cout << "Invariant violation: " << what << " (word 0x" << std::hex << word << std::dec << ")" << std::endl;
+	std::abort();
+}
+
+void Fuzz_Decoder(const uint8_t* data, size_t size) {
+
+	size = std::min(size, Fuzz_Decoder_Word_Budget * sizeof(uint32_t));
+
+	for (size_t i = 0; i + sizeof(uint32_t) <= size; i += sizeof(uint32_t)) {
+
+		uint32_t word;
+		std::memcpy(&word, data + i, sizeof(uint32_t));
+
+		// 1) decode - undefined instructions are fine, crashes are not
+		auto instr = CInstruction::Build_From_Binary(word);
+		if (!instr) {
+			continue;
+		}
+
+		// 2) generate both string representations and the canonical encoding
+		const std::string str = instr->Generate_String(false);
+		const std::string strHex = instr->Generate_String(true);
+		const uint32_t binary = instr->Generate_Binary();
+
+		// 3) binary round-trip - re-decoding the canonical encoding must yield the same instruction
+		auto rebuilt = CInstruction::Build_From_Binary(binary);
+		if (!rebuilt) {
+			Fuzz_Fail("canonical encoding is not decodable", word);
+		}
+		if (rebuilt->Generate_Binary() != binary || rebuilt->Generate_String(false) != str) {
+			Fuzz_Fail("binary round-trip mismatch: " + str + " vs. " + rebuilt->Generate_String(false), word);
+		}
+
+		// 4) text round-trip - the generated string must parse back to the same encoding (in both formats)
+		for (const auto& s : { str, strHex }) {
+			std::unique_ptr<CInstruction> parsed;
+			try {
+				parsed = CInstruction::Build_From_String(s);
+			}
+			catch (const std::exception& ex) {
+				Fuzz_Fail("generated string '" + s + "' is not parseable: " + ex.what(), word);
+			}
+
+			if (!parsed || parsed->Generate_Binary() != binary) {
+				Fuzz_Fail("text round-trip mismatch: " + s, word);
+			}
+		}
+	}
+}
+
+// performs cold reset of the machine and loads the input to it - IVT first, the rest is placed at the reset vector
+static void Fuzz_Load_Image(sarch32::CMachine& machine, const uint8_t* data, size_t size) {
+
+	machine.Reset(false);
+
+	const size_t ivtSize = std::min(size, Fuzz_IVT_Size);
+	machine.Get_Memory_Bus().Load_Bytes_To(std::span<const uint8_t>(data, ivtSize), IVT_Address);
+
+	if (size > ivtSize) {
+		const size_t codeSize = std::min(size - ivtSize, static_cast<size_t>(Fuzz_Memory_Size - sarch32::Reset_Vector));
+		machine.Get_Memory_Bus().Load_Bytes_To(std::span<const uint8_t>(data + ivtSize, codeSize), sarch32::Reset_Vector);
+	}
+}
+
+void Fuzz_Machine(const uint8_t* data, size_t size) {
+
+	// persistent machine instance - cold reset is cheap enough with a small memory; random images fault almost immediately
+	// and the fault handlers are random as well, so the input ends with the first fault (an exception is thrown for every one)
+	static std::unique_ptr<sarch32::CMachine> machine = [] {
+		auto m = std::make_unique<sarch32::CMachine>(Fuzz_Memory_Size);
+		m->Set_Stop_On_Fault(true);
+		return m;
+	}();
+
+	Fuzz_Load_Image(*machine, data, size);
+
+	machine->Step(Fuzz_Step_Budget, true);
+}
+
+void Fuzz_Lockstep(const uint8_t* data, size_t size) {
+
+	// persistent machine instances - the predecoded cache of the candidate survives between inputs on purpose,
+	// so the validation of stale cache entries is exercised too; the candidate also uses guarded memory
+	static std::unique_ptr<sarch32::CMachine> reference = [] {
+		auto m = std::make_unique<sarch32::CMachine>(Fuzz_Memory_Size);
+		m->Set_Stop_On_Fault(true);
+		return m;
+	}();
+	static std::unique_ptr<sarch32::CMachine> candidate = [] {
+		auto m = std::make_unique<sarch32::CMachine>(Fuzz_Memory_Size, sarch32::NMemory_Mode::Guarded);
+		m->Set_Execution_Engine(sarch32::NExecution_Engine::Predecoded);
+		m->Set_Stop_On_Fault(true);
+		return m;
+	}();
+
+	Fuzz_Load_Image(*reference, data, size);
+	// the memory is copied from the reference, no need to clear it
+	candidate->Reset(true);
+
+	sarch32::CLockstep_Runner runner(*reference, *candidate);
+	if (!runner.Synchronize()) {
+		Fuzz_Fail("could not synchronize lockstep machines", 0);
+	}
+
+	if (!runner.Step(Fuzz_Step_Budget, true)) {
+		std::cout << runner.Get_Divergence();
+		Fuzz_Fail("execution engines diverged", 0);
+	}
+}
+
+int Fuzz_One_Input(const uint8_t* data, size_t size) {
+
+	if (size < 1) {
+		return 0;
+	}
+
+	switch (static_cast<NFuzz_Mode>(data[0] % static_cast<uint8_t>(NFuzz_Mode::count))) {
+		case NFuzz_Mode::Decoder:
+			Fuzz_Decoder(data + 1, size - 1);
+			break;
+		case NFuzz_Mode::Machine:
+			Fuzz_Machine(data + 1, size - 1);
+			break;
+		case NFuzz_Mode::Lockstep:
+			Fuzz_Lockstep(data + 1, size - 1);
+			break;
+		case NFuzz_Mode::count:
+			break;
+	}
+
+	return 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "../core/isa.h"
+
+/*
+ * Fuzzing mode - selected by the first byte of the input
+ */
+enum class NFuzz_Mode {
+	Decoder = 0,	// instruction decoder/encoder/printer/parser round-trips
+	Machine = 1,	// random memory image executed by the machine
+	Lockstep = 2,	// random memory image executed by the interpreter and the predecoded engine (with guarded memory) in lockstep
+
+	count
+};
+
+// memory size of the fuzzed machine - small enough to allow fast cold reset
+constexpr uint32_t Fuzz_Memory_Size = 64 * 1024;
+// size of the IVT part of the machine input
+constexpr size_t Fuzz_IVT_Size = Get_IVT_Vector_Address(NIVT_Entry::Supervisor_Call) + sizeof(uint32_t) - IVT_Address;
+// maximum number of steps executed per single machine input
+constexpr size_t Fuzz_Step_Budget = 1024;
+// maximum number of instruction words checked per single decoder input (the rest of the input is ignored) - every word
+// takes a couple of microseconds, short inputs keep the exec rate high
+constexpr size_t Fuzz_Decoder_Word_Budget = 16;
+
+// runs a single fuzzing input; returns 0 (libFuzzer convention), aborts on invariant violation
+int Fuzz_One_Input(const uint8_t* data, size_t size);
+
+// runs decoder round-trips on given bytes (interpreted as instruction words)
+void Fuzz_Decoder(const uint8_t* data, size_t size);
+// loads given bytes as a memory image and runs the machine for a bounded number of steps, or until the first fault
+void Fuzz_Machine(const uint8_t* data, size_t size);
+// loads given bytes as a memory image and runs it on both execution engines in lockstep until the first fault; aborts on divergence
+void Fuzz_Lockstep(const uint8_t* data, size_t size);
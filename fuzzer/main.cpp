@@ -0,0 +1,119 @@
+#include "fuzz_targets.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+
+#ifdef SARCH32_LIBFUZZER
+
+/*
+ * libFuzzer entry point - libFuzzer provides its own main and runs in persistent mode
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	return Fuzz_One_Input(data, size);
+}
+
+extern "C" int LLVMFuzzerInitialize(int* /*argc*/, char*** /*argv*/) {
+	// silence the diagnostics of the emulated machine, they would dominate the run time
+	std::cerr.rdbuf(nullptr);
+	return 0;
+}
+
+#else
+
+/*
+ * Standalone driver - replays given input files, or generates random inputs when no file is given
+ */
+int main(int argc, char** argv) {
+
+	size_t runs = 100000;
+	uint32_t seed = std::random_device{}();
+	int mode = -1;
+	std::vector<std::string> files;
+
+	// parse command line
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+
+		if (arg == "-runs" && i + 1 < argc) {
+			runs = std::stoull(argv[++i]);
+		}
+		else if (arg == "-seed" && i + 1 < argc) {
+			seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "-decoder") {
+			mode = static_cast<int>(NFuzz_Mode::Decoder);
+		}
+		else if (arg == "-machine") {
+			mode = static_cast<int>(NFuzz_Mode::Machine);
+		}
+		else if (arg == "-lockstep") {
+			mode = static_cast<int>(NFuzz_Mode::Lockstep);
+		}
+		else if (arg.starts_with("-")) {
+			std::cerr << "Usage: " << argv[0] << " [-decoder|-machine|-lockstep] [-runs N] [-seed S] [input files...]" << std::endl;
+			return 1;
+		}
+		else {
+			files.push_back(arg);
+		}
+	}
+
+	// replay mode - run every given file once (e.g., to reproduce a crash found by libFuzzer)
+	if (!files.empty()) {
+		for (auto& f : files) {
+			std::ifstream ifs(f, std::ios::in | std::ios::binary);
+			if (!ifs.is_open()) {
+				std::cerr << "Could not open input file " << f << std::endl;
+				return 2;
+			}
+
+			std::vector<uint8_t> input{ std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>() };
+
+			std::cout << "Running " << f << " (" << input.size() << " bytes)" << std::endl;
+			Fuzz_One_Input(input.data(), input.size());
+		}
+
+		return 0;
+	}
+
+	std::cout << "Random fuzzing with seed " << seed << ", " << runs << " runs" << std::endl;
+
+	// silence the diagnostics of the emulated machine, they would dominate the run time
+	auto* cerrBuf = std::cerr.rdbuf(nullptr);
+
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<size_t> lenDist(1, 1024);
+	std::uniform_int_distribution<int> byteDist(0, 255);
+
+	std::vector<uint8_t> input;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for (size_t r = 0; r < runs; r++) {
+		input.resize(lenDist(rng));
+		for (auto& b : input) {
+			b = static_cast<uint8_t>(byteDist(rng));
+		}
+
+		// force the mode, if requested
+		if (mode >= 0) {
+			input[0] = static_cast<uint8_t>(mode);
+		}
+
+		Fuzz_One_Input(input.data(), input.size());
+	}
+
+	const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::cerr.rdbuf(cerrBuf);
+
+	std::cout << "Done: " << runs << " runs in " << elapsed << " s (" << static_cast<size_t>(runs / (elapsed > 0 ? elapsed : 1)) << " execs/s)" << std::endl;
+
+	return 0;
+}
+
+#endif
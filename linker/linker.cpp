@@ -0,0 +1,286 @@
+#include "linker.h"
+
+#include "../core/symbols.h"
+
+#include <algorithm>
+
+CLinker::CLinker(TLink_Input& input)
+	: mInput(input) {
+	//
+}
+
+sarch32::TString_Id CLinker::Intern_Section(const std::string& name) {
+
+	const auto id = mSection_Names.Intern(name);
+	mSections.resize(mSection_Names.Size());
+	mSection_Defs.resize(mSection_Names.Size(), nullptr);
+	return id;
+}
+
+void CLinker::Merge_Object(sarch32::TRelocatable_Object& object) {
+
+	// start of the object sections within the merged sections
+	std::vector<std::pair<sarch32::TString_Id, uint32_t>> bases;
+
+	for (auto& s : object.sections) {
+
+		const auto id = Intern_Section(s.name);
+		auto& merged = mSections[id];
+		merged.present = true;
+		bases.push_back({ id, merged.size });
+
+		if (s.zeroFill) {
+			if (!merged.zeroFill) {
+				merged.data.resize(merged.size + s.size, 0);
+			}
+		}
+		else {
+			// once there are some data, the reserved space has to be materialized
+			if (merged.zeroFill) {
+				merged.data.assign(merged.size, 0);
+				merged.zeroFill = false;
+			}
+			merged.data.insert(merged.data.end(), s.data.begin(), s.data.end());
+		}
+
+		merged.size += s.size;
+	}
+
+	// symbols may also be defined in sections the object has no contents in
+	auto baseOf = [this, &bases](sarch32::TString_Id section) -> uint32_t {
+		for (auto& b : bases) {
+			if (b.first == section) {
+				return b.second;
+			}
+		}
+		return mSections[section].size;
+	};
+
+	// later symbol definition overrides the previous one, just like when the sources are assembled at once
+	for (auto& sym : object.symbols) {
+		const auto section = Intern_Section(sym.section);
+		const uint32_t offset = sym.offset + baseOf(section);
+		Log(NLog_Level::Full, "Symbol", sym.name, "at offset", offset, "in section", sym.section);
+
+		const auto id = mSymbol_Names.Intern(sym.name);
+		mSymbols.resize(mSymbol_Names.Size());
+		mSymbols[id] = { section, offset, true };
+	}
+
+	for (auto& rel : object.relocations) {
+		const auto section = Intern_Section(rel.section);
+		mRelocations.push_back({ mSymbol_Names.Intern(rel.symbol), section, rel.offset + baseOf(section), rel.kind });
+	}
+	mSymbols.resize(mSymbol_Names.Size());
+
+	const uint32_t fileBase = static_cast<uint32_t>(mSource_Files.size());
+	for (auto& line : object.lines) {
+		const auto section = Intern_Section(line.section);
+		mLines.push_back({ section, line.offset + baseOf(section), line.size, line.line, line.fileIndex + fileBase });
+	}
+
+	mSource_Files.insert(mSource_Files.end(), object.files.begin(), object.files.end());
+}
+
+bool CLinker::Resolve_Relocations() {
+
+	Log(NLog_Level::Basic, "Resolving symbols...");
+
+	for (auto& rel : mRelocations) {
+
+		const auto& name = mSymbol_Names.Get(rel.symbol);
+
+		// find the symbol definition
+		const auto& sym = mSymbols[rel.symbol];
+		if (!sym.defined) {
+			std::cerr << "Unresolved symbol: " << name << std::endl;
+			return false;
+		}
+
+		// find a section in which the symbol resides
+		const auto* slink = Get_Section_Def(sym.section);
+		if (!slink) {
+			std::cerr << "Unknown section '" << mSection_Names.Get(sym.section) << "' for symbol: " << name << std::endl;
+			return false;
+		}
+
+		// actual address = section starting address + symbol offset
+		const auto addr = static_cast<int32_t>(slink->startAddr + sym.offset);
+
+		Log(NLog_Level::Extended, "Resolving symbol", name, "to", addr);
+
+		// the relocated field must lie within the section data
+		auto& sec = mSections[rel.section];
+		const uint32_t size = Get_Relocation_Size(rel.kind);
+		if (sec.zeroFill || size == 0 || rel.offset > sec.data.size() || sec.data.size() - rel.offset < size) {
+			std::cerr << "Invalid relocation of symbol " << name << " at offset " << rel.offset << " of section " << mSection_Names.Get(rel.section) << std::endl;
+			return false;
+		}
+
+		try {
+			Apply_Relocation(rel.kind, std::span<uint8_t>(sec.data).subspan(rel.offset, size), addr);
+		}
+		catch (const std::exception& ex) {
+			std::cerr << "Exception: " << ex.what() << " (symbol " << name << ")" << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool CLinker::Generate_Binary() {
+
+	Log(NLog_Level::Basic, "Generating output...");
+
+	// create object file
+	SObj::CSObj_File output;
+
+	// put all sections
+	for (sarch32::TString_Id i = 0; i < mSections.size(); i++) {
+
+		const auto& s = mSections[i];
+		if (!s.present) {
+			continue;
+		}
+
+		if (s.zeroFill) {
+			Log(NLog_Level::Extended, "Section", mSection_Names.Get(i), "is zero-filled,", s.size, "bytes");
+
+			output.Put_Zero_Fill_To_Section(mSection_Names.Get(i), s.size);
+			continue;
+		}
+
+		output.Put_To_Section(mSection_Names.Get(i), s.data);
+	}
+
+	// relocate all sections (just set starting address to allow loader to put it to a correct place in memory)
+	for (auto& sr : mLinker_Section_Defs) {
+		output.Relocate_Section(sr.second.section, sr.second.startAddr);
+
+		uint32_t flags = sr.second.flags;
+		// keep the flags given by the contents (zero-filled sections)
+		if (auto itr = output.Get_Sections().find(sr.second.section); itr != output.Get_Sections().end()) {
+			flags |= itr->second.flags;
+		}
+		if (mInput.Compressed_Sections.contains(sr.second.section)) {
+			flags |= static_cast<uint32_t>(SObj::NSection_Flag::Compressed);
+		}
+
+		output.Set_Section_Flags(sr.second.section, flags);
+	}
+
+	if (mInput.Debug_Info) {
+		// v1 has no section flags, the tables would be loaded to memory
+		if (mInput.Output_Version == SObj::NVersion::V1) {
+			std::cerr << "Debug info is not supported by SObj v1 format, skipping" << std::endl;
+		}
+		else {
+			Generate_Debug_Info(output);
+		}
+	}
+
+	return output.Save_To_File(mInput.Output_File, mInput.Output_Version);
+}
+
+void CLinker::Generate_Debug_Info(SObj::CSObj_File& output) {
+
+	Log(NLog_Level::Extended, "Generating debug info...");
+
+	// symbols sorted to sections by offset - every symbol spans up to the next one (or to the end of section)
+	std::vector<std::vector<sarch32::TString_Id>> sectionSymbols(mSections.size());
+	for (sarch32::TString_Id i = 0; i < mSymbols.size(); i++) {
+		if (mSymbols[i].defined) {
+			sectionSymbols[mSymbols[i].section].push_back(i);
+		}
+	}
+
+	// the symbol table is emitted in the order of section and symbol names, regardless of the order the names were interned in
+	std::vector<sarch32::TString_Id> sectionOrder(mSections.size());
+	for (sarch32::TString_Id i = 0; i < sectionOrder.size(); i++) {
+		sectionOrder[i] = i;
+	}
+	std::sort(sectionOrder.begin(), sectionOrder.end(), [this](auto a, auto b) { return mSection_Names.Get(a) < mSection_Names.Get(b); });
+
+	std::vector<sarch32::TSymbol> symbols;
+
+	for (const auto section : sectionOrder) {
+
+		// symbols in sections not placed by the linker file have no address
+		const auto* slink = Get_Section_Def(section);
+		if (!slink) {
+			continue;
+		}
+
+		auto& syms = sectionSymbols[section];
+		std::sort(syms.begin(), syms.end(), [this](auto a, auto b) {
+			return (mSymbols[a].offset != mSymbols[b].offset) ? (mSymbols[a].offset < mSymbols[b].offset) : (mSymbol_Names.Get(a) < mSymbol_Names.Get(b));
+		});
+
+		const uint32_t sectionEnd = mSections[section].size;
+
+		for (size_t i = 0; i < syms.size(); i++) {
+			const uint32_t offset = mSymbols[syms[i]].offset;
+			const uint32_t end = (i + 1 < syms.size()) ? mSymbols[syms[i + 1]].offset : sectionEnd;
+
+			symbols.push_back({ slink->startAddr + offset, end - offset, mSymbol_Names.Get(syms[i]) });
+		}
+	}
+
+	std::vector<sarch32::TSource_Line> lines;
+
+	for (auto& line : mLines) {
+		if (const auto* slink = Get_Section_Def(line.section)) {
+			lines.push_back({ slink->startAddr + line.offset, line.size, line.line, line.fileIndex });
+		}
+	}
+
+	Log(NLog_Level::Extended, "Emitting", symbols.size(), "symbols and", lines.size(), "line records");
+
+	const uint32_t flags = static_cast<uint32_t>(SObj::NSection_Flag::Metadata);
+
+	output.Put_To_Section(SObj::Symbol_Table_Section, sarch32::CSymbol_Index::Serialize_Symbol_Table(std::move(symbols)));
+	output.Set_Section_Flags(SObj::Symbol_Table_Section, flags);
+
+	output.Put_To_Section(SObj::Line_Table_Section, sarch32::CSymbol_Index::Serialize_Line_Table(std::move(lines), mSource_Files));
+	output.Set_Section_Flags(SObj::Line_Table_Section, flags);
+}
+
+bool CLinker::Link() {
+
+	// 1) load linker file
+	if (!sarch32::Load_Linker_File(mInput.Linker_File, mLinker_Section_Defs)) {
+		std::cerr << "Could not load linker file" << std::endl;
+		return false;
+	}
+
+	for (auto& sd : mLinker_Section_Defs) {
+		mSection_Defs[Intern_Section(sd.first)] = &sd.second;
+	}
+
+	// 2) load all objects and concatenate their sections
+	for (auto& inputFile : mInput.Input_Files) {
+
+		Log(NLog_Level::Basic, "Loading", inputFile, "...");
+
+		sarch32::TRelocatable_Object object;
+		if (!sarch32::Load_Relocatable_Object(inputFile, object)) {
+			std::cerr << "Could not load relocatable object: " << inputFile << std::endl;
+			return false;
+		}
+
+		Merge_Object(object);
+	}
+
+	// 3) resolve all symbols
+	if (!Resolve_Relocations()) {
+		return false;
+	}
+
+	// 4) generate output binary
+	if (!Generate_Binary()) {
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <iostream>
+
+#include "../core/sobjfile.h"
+#include "../core/linker_file.h"
+#include "../core/relocatable.h"
+#include "../core/string_pool.h"
+
+/*
+ * Log level of linker
+ */
+enum class NLog_Level {
+	None,
+	Basic,
+	Extended,
+	Full,
+};
+
+/*
+ * Structure representing inputs to the linker process
+ */
+struct TLink_Input {
+	// relocatable objects to be linked (in this order)
+	std::vector<std::string> Input_Files;
+	// linker file for section relocation
+	std::string Linker_File;
+	// output binary object file
+	std::string Output_File;
+	// desired log level
+	NLog_Level Log_Level = NLog_Level::Basic;
+	// output object file format version
+	SObj::NVersion Output_Version = SObj::NVersion::V2;
+	// sections to be compressed in the output file
+	std::set<std::string> Compressed_Sections;
+	// emit symbol and line tables to the output file
+	bool Debug_Info = false;
+};
+
+/*
+ * The main linker class
+ *
+ * Concatenates sections of relocatable objects in the order of input files, resolves the symbols and patches
+ * the relocated fields; the result is the same as if the sources were assembled at once (given every source starts
+ * with a section directive)
+ */
+class CLinker {
+
+	private:
+		// input parameters
+		TLink_Input mInput;
+
+		// merged section
+		struct TMerged_Section {
+			// size of the section
+			uint32_t size = 0;
+			// the section consists of reserved space only (data are not materialized)
+			bool zeroFill = true;
+			// some object has contents in the section (the section is then present in the output)
+			bool present = false;
+			std::vector<uint8_t> data;
+		};
+
+		// symbol definition (offset relative to merged section)
+		struct TLinked_Symbol {
+			sarch32::TString_Id section = 0;
+			uint32_t offset = 0;
+			// the symbol may be just referenced, not defined
+			bool defined = false;
+		};
+
+		// relocation (offset relative to merged section)
+		struct TLinked_Relocation {
+			sarch32::TString_Id symbol = 0;
+			sarch32::TString_Id section = 0;
+			uint32_t offset = 0;
+			NRelocation_Kind kind = NRelocation_Kind::None;
+		};
+
+		// source line record (offset relative to merged section, file index refers to mSource_Files)
+		struct TLinked_Line {
+			sarch32::TString_Id section = 0;
+			uint32_t offset = 0;
+			uint32_t size = 0;
+			uint32_t line = 0;
+			uint32_t fileIndex = 0;
+		};
+
+		// interned section names; section IDs index mSections and mSection_Defs
+		sarch32::CString_Pool mSection_Names;
+		// interned symbol names; symbol IDs index mSymbols
+		sarch32::CString_Pool mSymbol_Names;
+
+		// merged sections
+		std::vector<TMerged_Section> mSections;
+		// symbol definitions
+		std::vector<TLinked_Symbol> mSymbols;
+		// relocations
+		std::vector<TLinked_Relocation> mRelocations;
+		// source lines
+		std::vector<TLinked_Line> mLines;
+		// source files of all objects
+		std::vector<std::string> mSource_Files;
+
+		// stored linker sections from linker file
+		std::map<std::string, sarch32::TLinker_Section_Def> mLinker_Section_Defs;
+		// linker section definitions indexed by section ID (null for sections not placed by the linker file)
+		std::vector<const sarch32::TLinker_Section_Def*> mSection_Defs;
+
+		// interns section name, the per-section tables grow along
+		sarch32::TString_Id Intern_Section(const std::string& name);
+		// retrieves linker section definition of given section; null if the section is not placed by the linker file
+		const sarch32::TLinker_Section_Def* Get_Section_Def(sarch32::TString_Id section) const {
+			return (section < mSection_Defs.size()) ? mSection_Defs[section] : nullptr;
+		}
+
+	protected:
+		// appends contents of given object to the merged sections
+		void Merge_Object(sarch32::TRelocatable_Object& object);
+
+		// resolves symbols and patches all relocated fields
+		bool Resolve_Relocations();
+
+		// generates output binary
+		bool Generate_Binary();
+		// puts symbol and line tables to the output object file
+		void Generate_Debug_Info(SObj::CSObj_File& output);
+
+	protected:
+		// internal log method - single parameter output
+		template<typename T1>
+		void Log_Internal(const T1& val) {
+			std::cout << val << " ";
+		}
+
+		// internal log method - variadic template
+		template<typename T1, typename... TArgs>
+		void Log_Internal(const T1& val, TArgs... args) {
+			Log_Internal(val);
+			Log_Internal(args...);
+		}
+
+		// log entry method
+		template<typename... Args>
+		void Log(NLog_Level ll, Args... args) {
+
+			if (static_cast<int>(ll) > static_cast<int>(mInput.Log_Level))
+				return;
+
+			Log_Internal(args...);
+			std::cout << std::endl;
+		}
+
+	public:
+		CLinker(TLink_Input& input);
+		virtual ~CLinker() = default;
+
+		// link given inputs into output binary
+		bool Link();
+};
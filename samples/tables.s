@@ -0,0 +1,38 @@
+; lookup table example - the table is referred to only by its first label and read past its interior labels
+; assemble with -gc to see the unused data dropped while the whole table is kept (labels nothing refers to are taken
+; as interior labels of the data before them)
+
+.section data				; data section
+$unused_word:				; never referred to, removed with -gc
+	dw #0xDEADBEEF
+$squares:					; table of squares, indexed from its first label
+	dw #0
+	dw #1
+	dw #4
+	dw #9
+$squares_high:				; interior label, not referred to by the code
+	dw #16
+	dw #25
+	dw #36
+	dw #49
+$cubes:						; another table, referred to only by the code never executed - removed with -gc
+	dw #0
+	dw #1
+	dw #8
+	dw #27
+
+.section text
+$start:
+	movi sp, #0x1000		; move stack pointer to 0x1000
+	fw $squares				; fetches $squares address to r0
+	movi r1, #6				; r1 = 6, index to the table
+	sli r1, #2				; r1 = r1 * 4 (size of table entry)
+	add r0, r1				; r0 = address of the entry
+	lw r2, r0				; r2 = memory[r0] - 6 squared, stored past the interior label
+$hang:
+	bi $hang				; hang indefinitely
+$cube_of_r1:				; nothing calls this routine, removed with -gc
+	fw $cubes
+	add r0, r1
+	lw r2, r0
+	mov pc, ra
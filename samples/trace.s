@@ -0,0 +1,23 @@
+; example of guest-side trace markers
+; the routine below is measured by the emulator - export the trace via Debug menu to see the cycle counts
+
+.section text
+$start:
+	movi sp, #0x1000		; move stack pointer to 0x1000
+	movi r5, #0				; iteration counter
+$repeat:
+	svc #0x7F0001			; begin region 1
+	movi r1, #100			; spin for a while
+$spin:
+	subi r1, #1
+	cmpi r1, #0
+	bi.gt $spin
+	svc #0x7F1001			; end region 1
+
+	addi r5, #1				; increment iteration counter
+	mov r0, r5				; counter value is passed in r0
+	svc #0x7F2001			; sample counter 1
+	cmpi r5, #10			; repeat 10 times
+	bi.lt $repeat
+$hang:
+	bi $hang				; hang indefinitely